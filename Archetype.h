@@ -0,0 +1,90 @@
+#pragma once
+#include "MemoryTracker.h"
+
+//
+// Storage of the entities sharing one set of components. Each component
+// type is a dense table over the rows of the archetype, so a system walks
+// only the tables it reads, and a component only costs memory in the
+// archetypes that have it. Queries are checked at compile time: asking an
+// archetype for a component it does not have does not compile. The tables
+// are accounted to memoryEntities.
+//
+
+template <typename Component>
+using ComponentTable = TrackedVector<Component, memoryEntities>;
+
+template <typename Component, typename... Components>
+struct ArchetypeHas : std::false_type
+{
+};
+
+template <typename Component, typename First, typename... Rest>
+struct ArchetypeHas<Component, First, Rest...>
+	: std::integral_constant<bool, std::is_same<Component, First>::value || ArchetypeHas<Component, Rest...>::value>
+{
+};
+
+template <typename... Components>
+class Archetype
+{
+public:
+	template <typename Component>
+	static constexpr bool Has() { return ArchetypeHas<Component, Components...>::value; }
+
+	std::size_t GetCount() const { return m_count; }
+
+	// Appends a row of default components and returns it. Setup only.
+	std::size_t Add()
+	{
+		int expand[] = { (std::get<ComponentTable<Components>>(m_tables).emplace_back(), 0)... };
+		(void)expand;
+		return m_count++;
+	}
+
+	void Reserve(std::size_t count)
+	{
+		int expand[] = { (std::get<ComponentTable<Components>>(m_tables).reserve(count), 0)... };
+		(void)expand;
+	}
+
+	template <typename Component>
+	ComponentTable<Component>& Get()
+	{
+		static_assert(Has<Component>(), "this archetype has no such component");
+		return std::get<ComponentTable<Component>>(m_tables);
+	}
+
+	template <typename Component>
+	const ComponentTable<Component>& Get() const
+	{
+		static_assert(Has<Component>(), "this archetype has no such component");
+		return std::get<ComponentTable<Component>>(m_tables);
+	}
+
+	// function(row, components...) for every row, with the components
+	// listed in Read, in that order.
+	template <typename... Read, typename Function>
+	void ForEach(Function function)
+	{
+		Iterate(function, Get<Read>().data()...);
+	}
+
+	template <typename... Read, typename Function>
+	void ForEach(Function function) const
+	{
+		Iterate(function, Get<Read>().data()...);
+	}
+
+private:
+	template <typename Function, typename... Tables>
+	void Iterate(Function& function, Tables... tables) const
+	{
+		for (std::size_t i = 0; i < m_count; i++)
+		{
+			function(i, tables[i]...);
+		}
+	}
+
+	std::size_t m_count = 0;
+	std::tuple<ComponentTable<Components>...> m_tables;
+};
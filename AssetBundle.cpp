@@ -0,0 +1,348 @@
+#include "pch.h"
+#include "AssetBundle.h"
+#include "Checksum.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+AssetBundle::AssetBundle()
+{
+}
+
+AssetBundle::~AssetBundle()
+{
+}
+
+bool AssetBundle::Open(const std::string& path)
+{
+	Close();
+
+	if (m_file.Open(path) == false)
+	{
+		return false;
+	}
+
+	const unsigned char* data = m_file.GetData();
+	std::size_t size = m_file.GetSize();
+
+	if (size < sizeof(AssetBundleHeader))
+	{
+		Close();
+		return false;
+	}
+
+	const AssetBundleHeader* header = reinterpret_cast<const AssetBundleHeader*>(data);
+	if (std::memcmp(header->m_magic, ASSET_BUNDLE_MAGIC, 4) != 0 || header->m_version != ASSET_BUNDLE_VERSION)
+	{
+		Close();
+		return false;
+	}
+
+	std::size_t indexSize = header->m_count * sizeof(AssetBundleEntry);
+	if (size - sizeof(AssetBundleHeader) < indexSize)
+	{
+		Close();
+		return false;
+	}
+
+	const AssetBundleEntry* entries = reinterpret_cast<const AssetBundleEntry*>(data + sizeof(AssetBundleHeader));
+	if (Fnv1a32(entries, indexSize) != header->m_indexChecksum)
+	{
+		Close();
+		return false;
+	}
+
+	for (std::uint32_t i = 0; i < header->m_count; i++)
+	{
+		const AssetBundleEntry& entry = entries[i];
+		if (entry.m_name[ASSET_BUNDLE_NAME_SIZE - 1] != '\0' || entry.m_offset > size || entry.m_size > size - entry.m_offset)
+		{
+			Close();
+			return false;
+		}
+	}
+
+	m_entries = entries;
+	m_count = header->m_count;
+	return true;
+}
+
+void AssetBundle::Close()
+{
+	m_file.Close();
+	m_entries = nullptr;
+	m_count = 0;
+}
+
+bool AssetBundle::Verify() const
+{
+	if (IsOpen() == false)
+	{
+		return false;
+	}
+
+	for (std::uint32_t i = 0; i < m_count; i++)
+	{
+		const AssetBundleEntry& entry = m_entries[i];
+		if (Fnv1a32(m_file.GetData() + entry.m_offset, entry.m_size) != entry.m_checksum)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool AssetBundle::Find(const std::string& name, const void*& data, std::size_t& size) const
+{
+	// The index is written sorted by name.
+	const AssetBundleEntry* first = m_entries;
+	const AssetBundleEntry* last = m_entries + m_count;
+	const AssetBundleEntry* it = std::lower_bound(first, last, name, [](const AssetBundleEntry& entry, const std::string& value) {
+		return std::strcmp(entry.m_name, value.c_str()) < 0;
+	});
+
+	if (it == last || name != it->m_name)
+	{
+		return false;
+	}
+
+	data = m_file.GetData() + it->m_offset;
+	size = it->m_size;
+	return true;
+}
+
+bool AssetBundle::LoadTexture(sf::Texture& texture, const std::string& name) const
+{
+	const void* data;
+	std::size_t size;
+	if (Find(name, data, size) == true)
+	{
+		return texture.loadFromMemory(data, size);
+	}
+
+	return texture.loadFromFile("Media/" + name);
+}
+
+bool AssetBundle::LoadImage(sf::Image& image, const std::string& name) const
+{
+	const void* data;
+	std::size_t size;
+	if (Find(name, data, size) == true)
+	{
+		return image.loadFromMemory(data, size);
+	}
+
+	return image.loadFromFile("Media/" + name);
+}
+
+bool AssetBundle::LoadFont(sf::Font& font, const std::string& name) const
+{
+	// sf::Font streams glyphs from the buffer for its whole lifetime,
+	// so the bundle must outlive the font.
+	const void* data;
+	std::size_t size;
+	if (Find(name, data, size) == true)
+	{
+		return font.loadFromMemory(data, size);
+	}
+
+	return font.loadFromFile("Media/" + name);
+}
+
+bool AssetBundle::LoadSoundBuffer(sf::SoundBuffer& buffer, const std::string& name) const
+{
+	const void* data;
+	std::size_t size;
+	if (Find(name, data, size) == true)
+	{
+		return buffer.loadFromMemory(data, size);
+	}
+
+	std::ifstream file("Media/" + name, std::ios::binary);
+	if (file.is_open() == false)
+	{
+		return false;
+	}
+	file.close();
+
+	return buffer.loadFromFile("Media/" + name);
+}
+
+//
+// Packer
+//
+
+// Fails on a directory that cannot be read, at any depth, so that a bundle
+// never silently misses a part of the tree.
+static bool ListFiles(const std::string& directory, const std::string& prefix, std::vector<std::string>& names)
+{
+#ifdef _WIN32
+	WIN32_FIND_DATAA data;
+	HANDLE find = FindFirstFileA((directory + "/*").c_str(), &data);
+	if (find == INVALID_HANDLE_VALUE)
+	{
+		std::cerr << "Cannot list " << directory << std::endl;
+		return false;
+	}
+
+	do
+	{
+		std::string name = data.cFileName;
+		if (name == "." || name == "..")
+		{
+			continue;
+		}
+
+		if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
+		{
+			if (ListFiles(directory + "/" + name, prefix + name + "/", names) == false)
+			{
+				FindClose(find);
+				return false;
+			}
+		}
+		else
+		{
+			names.push_back(prefix + name);
+		}
+	} while (FindNextFileA(find, &data) != FALSE);
+
+	FindClose(find);
+	return true;
+#else
+	DIR* dir = opendir(directory.c_str());
+	if (dir == nullptr)
+	{
+		std::cerr << "Cannot list " << directory << std::endl;
+		return false;
+	}
+
+	while (dirent* entry = readdir(dir))
+	{
+		std::string name = entry->d_name;
+		if (name == "." || name == "..")
+		{
+			continue;
+		}
+
+		struct stat st;
+		std::string path = directory + "/" + name;
+		if (stat(path.c_str(), &st) != 0)
+		{
+			std::cerr << "Cannot read " << path << std::endl;
+			closedir(dir);
+			return false;
+		}
+
+		if (S_ISDIR(st.st_mode))
+		{
+			if (ListFiles(path, prefix + name + "/", names) == false)
+			{
+				closedir(dir);
+				return false;
+			}
+		}
+		else
+		{
+			names.push_back(prefix + name);
+		}
+	}
+
+	closedir(dir);
+	return true;
+#endif
+}
+
+bool AssetBundle::Pack(const std::string& directory, const std::string& output)
+{
+	std::vector<std::string> names;
+	if (ListFiles(directory, "", names) == false)
+	{
+		return false;
+	}
+
+	if (names.empty() == true)
+	{
+		std::cerr << "No files in " << directory << std::endl;
+		return false;
+	}
+	std::sort(names.begin(), names.end());
+
+	std::vector<AssetBundleEntry> entries(names.size());
+	std::vector<std::vector<char>> blobs(names.size());
+
+	std::size_t offset = sizeof(AssetBundleHeader) + entries.size() * sizeof(AssetBundleEntry);
+
+	for (std::size_t i = 0; i < names.size(); i++)
+	{
+		if (names[i].size() >= ASSET_BUNDLE_NAME_SIZE)
+		{
+			std::cerr << "Asset name too long: " << names[i] << std::endl;
+			return false;
+		}
+
+		std::ifstream file(directory + "/" + names[i], std::ios::binary);
+		if (file.is_open() == false)
+		{
+			std::cerr << "Cannot read " << names[i] << std::endl;
+			return false;
+		}
+
+		blobs[i].assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+		offset = (offset + ASSET_BUNDLE_ALIGNMENT - 1) & ~static_cast<std::size_t>(ASSET_BUNDLE_ALIGNMENT - 1);
+		if (offset + blobs[i].size() > UINT32_MAX)
+		{
+			std::cerr << "Bundle too large" << std::endl;
+			return false;
+		}
+
+		AssetBundleEntry& entry = entries[i];
+		std::memset(&entry, 0, sizeof(entry));
+		std::memcpy(entry.m_name, names[i].c_str(), names[i].size());
+		entry.m_offset = static_cast<std::uint32_t>(offset);
+		entry.m_size = static_cast<std::uint32_t>(blobs[i].size());
+		entry.m_checksum = Fnv1a32(blobs[i].data(), blobs[i].size());
+
+		offset += blobs[i].size();
+	}
+
+	AssetBundleHeader header;
+	std::memcpy(header.m_magic, ASSET_BUNDLE_MAGIC, 4);
+	header.m_version = ASSET_BUNDLE_VERSION;
+	header.m_count = static_cast<std::uint32_t>(entries.size());
+	header.m_indexChecksum = Fnv1a32(entries.data(), entries.size() * sizeof(AssetBundleEntry));
+
+	std::ofstream out(output, std::ios::binary | std::ios::trunc);
+	if (out.is_open() == false)
+	{
+		std::cerr << "Cannot write " << output << std::endl;
+		return false;
+	}
+
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(AssetBundleEntry));
+
+	std::size_t position = sizeof(AssetBundleHeader) + entries.size() * sizeof(AssetBundleEntry);
+	for (std::size_t i = 0; i < entries.size(); i++)
+	{
+		static const char padding[ASSET_BUNDLE_ALIGNMENT] = { 0 };
+		out.write(padding, entries[i].m_offset - position);
+		out.write(blobs[i].data(), blobs[i].size());
+		position = entries[i].m_offset + blobs[i].size();
+	}
+
+	if (out.good() == false)
+	{
+		std::cerr << "Cannot write " << output << std::endl;
+		return false;
+	}
+
+	std::cout << "Packed " << entries.size() << " assets into " << output << " (" << position << " bytes)" << std::endl;
+	return true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "MappedFile.h"
+
+//
+// Packed asset bundle: a header, an index of fixed-size entries and then
+// the raw file blobs, each one aligned on ASSET_BUNDLE_ALIGNMENT bytes.
+// The bundle is memory mapped and the blobs are handed to SFML's
+// loadFromMemory() straight from the mapping, so nothing is copied.
+//
+
+#define ASSET_BUNDLE_MAGIC "SIAB"
+#define ASSET_BUNDLE_VERSION 1
+#define ASSET_BUNDLE_ALIGNMENT 16
+#define ASSET_BUNDLE_NAME_SIZE 48
+
+struct AssetBundleHeader
+{
+	char m_magic[4];
+	std::uint32_t m_version;
+	std::uint32_t m_count;
+	std::uint32_t m_indexChecksum;
+};
+
+struct AssetBundleEntry
+{
+	char m_name[ASSET_BUNDLE_NAME_SIZE];
+	std::uint32_t m_offset;
+	std::uint32_t m_size;
+	std::uint32_t m_checksum;
+	std::uint32_t m_reserved;
+};
+
+class AssetBundle
+{
+public:
+	AssetBundle();
+	~AssetBundle();
+
+public:
+	bool Open(const std::string& path);
+	void Close();
+	bool IsOpen() const { return m_entries != nullptr; }
+
+	// Checks every blob against its checksum.
+	bool Verify() const;
+
+	// Names are relative to the packed directory, with '/' separators,
+	// e.g. "Textures/SI_Player.png".
+	bool Find(const std::string& name, const void*& data, std::size_t& size) const;
+
+	bool LoadTexture(sf::Texture& texture, const std::string& name) const;
+	bool LoadImage(sf::Image& image, const std::string& name) const;
+	bool LoadFont(sf::Font& font, const std::string& name) const;
+
+	// Optional asset: false, without an error message, when it is missing.
+	bool LoadSoundBuffer(sf::SoundBuffer& buffer, const std::string& name) const;
+
+	// Bundles every file under directory. Fails, without writing output,
+	// when a directory cannot be listed or there is no file at all.
+	static bool Pack(const std::string& directory, const std::string& output);
+
+private:
+	MappedFile m_file;
+	const AssetBundleEntry* m_entries = nullptr;
+	std::uint32_t m_count = 0;
+};
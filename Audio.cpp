@@ -0,0 +1,385 @@
+#include "pch.h"
+#include "Audio.h"
+#include "AssetBundle.h"
+#include "Bot.h"
+#include "MemoryTracker.h"
+
+static const char* SoundNames[soundCount] = { "Shoot", "Explosion", "PlayerHit", "March0", "March1", "March2", "March3", "Ufo" };
+
+// Who may steal whose voice: a sound only takes a voice of equal or lower priority.
+static const int SoundPriorities[soundCount] = { 1, 3, 4, 2, 2, 2, 2, 2 };
+
+static const float Pi = 3.14159265f;
+
+//
+// Synthesized sounds, in the spirit of the discrete circuits of the
+// original cabinet; used when the bundle has no recording.
+//
+
+static float Square(float phase)
+{
+	return phase - std::floor(phase) < 0.5f ? 1.f : -1.f;
+}
+
+static void Synthesize(SoundEffect sound, std::vector<sf::Int16>& samples)
+{
+	static const float MarchFrequencies[] = { 110.f, 98.f, 87.f, 82.f };
+	static const float Durations[soundCount] = { 0.12f, 0.35f, 0.8f, 0.09f, 0.09f, 0.09f, 0.09f, 0.5f };
+
+	Random random(static_cast<std::uint64_t>(sound) + 1);
+	std::size_t count = static_cast<std::size_t>(Durations[sound] * AUDIO_SAMPLE_RATE);
+	samples.resize(count);
+
+	float phase = 0.f;
+	for (std::size_t i = 0; i < count; i++)
+	{
+		float t = static_cast<float>(i) / AUDIO_SAMPLE_RATE;
+		float progress = static_cast<float>(i) / count;
+		float noise = random.NextInt(2001) / 1000.f - 1.f;
+		float value = 0.f;
+
+		switch (sound)
+		{
+		case soundShoot:
+			// Falling zap
+			phase += (1200.f - 900.f * progress) / AUDIO_SAMPLE_RATE;
+			value = Square(phase) * (1.f - progress) * 0.5f;
+			break;
+		case soundExplosion:
+			value = noise * std::exp(-6.f * progress) * 0.7f;
+			break;
+		case soundPlayerHit:
+			phase += (90.f - 40.f * progress) / AUDIO_SAMPLE_RATE;
+			value = (noise * 0.6f + Square(phase) * 0.4f) * (1.f - progress) * 0.8f;
+			break;
+		case soundUfo:
+			// Warble, a whole number of cycles so the loop is seamless
+			phase += (600.f + 200.f * std::sin(2.f * Pi * 8.f * t)) / AUDIO_SAMPLE_RATE;
+			value = std::sin(2.f * Pi * phase) * 0.3f;
+			break;
+		default:
+			phase += MarchFrequencies[sound - soundMarch0] / AUDIO_SAMPLE_RATE;
+			value = Square(phase) * std::min(1.f, (1.f - progress) * 4.f) * 0.6f;
+			break;
+		}
+
+		samples[i] = static_cast<sf::Int16>(value * 32767.f);
+	}
+}
+
+//
+// SfmlAudioBackend
+//
+
+bool SfmlAudioBackend::Load(SoundEffect sound, const AssetBundle& assets, const std::string& name)
+{
+	MemoryTracker::Free(memoryAudio, GetBufferBytes(sound));
+	bool ok = assets.LoadSoundBuffer(m_buffers[sound], name);
+	MemoryTracker::Allocate(memoryAudio, GetBufferBytes(sound));
+	return ok;
+}
+
+bool SfmlAudioBackend::Load(SoundEffect sound, const std::vector<sf::Int16>& samples, unsigned sampleRate)
+{
+	MemoryTracker::Free(memoryAudio, GetBufferBytes(sound));
+	bool ok = m_buffers[sound].loadFromSamples(samples.data(), samples.size(), 1, sampleRate);
+	MemoryTracker::Allocate(memoryAudio, GetBufferBytes(sound));
+	return ok;
+}
+
+void SfmlAudioBackend::Play(int voice, SoundEffect sound, bool loop)
+{
+	sf::Sound& source = m_voices[voice];
+	source.setBuffer(m_buffers[sound]);
+	source.setLoop(loop);
+	source.play();
+}
+
+void SfmlAudioBackend::Stop(int voice)
+{
+	m_voices[voice].stop();
+}
+
+bool SfmlAudioBackend::IsPlaying(int voice) const
+{
+	return m_voices[voice].getStatus() == sf::Sound::Playing;
+}
+
+//
+// NullAudioBackend
+//
+
+NullAudioBackend::NullAudioBackend(std::size_t maxPlays)
+{
+	m_playTimes.reserve(maxPlays);
+}
+
+bool NullAudioBackend::Load(SoundEffect sound, const AssetBundle& assets, const std::string& name)
+{
+	// Nothing to decode with, the synthesized sounds stand in.
+	return false;
+}
+
+bool NullAudioBackend::Load(SoundEffect sound, const std::vector<sf::Int16>& samples, unsigned sampleRate)
+{
+	m_durations[sound] = sf::seconds(static_cast<float>(samples.size()) / sampleRate);
+	return true;
+}
+
+void NullAudioBackend::Play(int voice, SoundEffect sound, bool loop)
+{
+	if (m_playTimes.size() < m_playTimes.capacity())
+	{
+		m_playTimes.push_back(m_clock.getElapsedTime());
+	}
+
+	Voice& state = m_voices[voice];
+	state.m_start = m_time;
+	state.m_duration = m_durations[sound];
+	state.m_loop = loop;
+	state.m_playing = true;
+}
+
+void NullAudioBackend::Stop(int voice)
+{
+	m_voices[voice].m_playing = false;
+}
+
+bool NullAudioBackend::IsPlaying(int voice) const
+{
+	const Voice& state = m_voices[voice];
+	return state.m_playing == true && (state.m_loop == true || m_time - state.m_start < state.m_duration);
+}
+
+//
+// AudioSystem
+//
+
+void AudioSystem::Init(AudioBackend& backend, const AssetBundle& assets)
+{
+	m_backend = &backend;
+
+	std::vector<sf::Int16> samples;
+	for (int i = 0; i < soundCount; i++)
+	{
+		SoundEffect sound = static_cast<SoundEffect>(i);
+		if (backend.Load(sound, assets, std::string("Sounds/") + SoundNames[i] + ".wav") == true)
+		{
+			continue;
+		}
+
+		Synthesize(sound, samples);
+		backend.Load(sound, samples, AUDIO_SAMPLE_RATE);
+	}
+}
+
+int AudioSystem::Trigger(SoundEffect sound, bool loop)
+{
+	int priority = SoundPriorities[sound];
+	int chosen = -1;
+
+	for (int i = 0; i < AUDIO_VOICES; i++)
+	{
+		if (m_voices[i].m_active == false || m_backend->IsPlaying(i) == false)
+		{
+			chosen = i;
+			break;
+		}
+	}
+
+	if (chosen < 0)
+	{
+		// Steal the least important voice, the oldest among equals
+		for (int i = 0; i < AUDIO_VOICES; i++)
+		{
+			const Voice& voice = m_voices[i];
+			if (voice.m_priority > priority)
+			{
+				continue;
+			}
+
+			if (chosen < 0 || voice.m_priority < m_voices[chosen].m_priority ||
+				(voice.m_priority == m_voices[chosen].m_priority && voice.m_started < m_voices[chosen].m_started))
+			{
+				chosen = i;
+			}
+		}
+
+		if (chosen < 0)
+		{
+			m_dropped++;
+			return -1;
+		}
+
+		m_stolen++;
+		if (chosen == m_ufoVoice)
+		{
+			m_ufoVoice = -1;
+		}
+	}
+
+	Voice& voice = m_voices[chosen];
+	voice.m_priority = priority;
+	voice.m_started = m_triggers++;
+	voice.m_active = true;
+
+	m_backend->Play(chosen, sound, loop);
+	m_triggered[sound]++;
+	return chosen;
+}
+
+void AudioSystem::StopAll()
+{
+	for (int i = 0; i < AUDIO_VOICES; i++)
+	{
+		if (m_voices[i].m_active == true)
+		{
+			m_backend->Stop(i);
+			m_voices[i].m_active = false;
+		}
+	}
+
+	m_ufoVoice = -1;
+}
+
+void AudioSystem::Update(const Simulation& simulation)
+{
+	// Nothing new when a netplay tick stalled
+	if (m_backend == nullptr || simulation.GetTick() == m_lastTick)
+	{
+		return;
+	}
+	m_lastTick = simulation.GetTick();
+
+	for (const GameEvent& event : simulation.GetEvents())
+	{
+		switch (event.m_type)
+		{
+		case GameEventType::playerFired:
+			Trigger(soundShoot);
+			break;
+		case GameEventType::enemyKilled:
+		case GameEventType::enemyMasterKilled:
+			Trigger(soundExplosion);
+			break;
+		case GameEventType::playerHit:
+			Trigger(soundPlayerHit);
+			break;
+		case GameEventType::levelStarted:
+			m_enemiesAtStart = 0;
+			m_marchCountdown = 0;
+			break;
+		default:
+			break;
+		}
+	}
+
+	//
+	// March and UFO follow the state
+	//
+
+	int enemies = 0;
+	bool master = simulation.GetEntities().Get<EntityType::enemyMaster>().Get<Collider>()[0].m_enabled;
+	for (const Collider& collider : simulation.GetEntities().Get<EntityType::enemy>().Get<Collider>())
+	{
+		enemies += collider.m_enabled == true ? 1 : 0;
+	}
+	m_enemiesAtStart = std::max(m_enemiesAtStart, enemies);
+
+	bool playing = simulation.IsGameOver() == false;
+	if (playing == true && enemies > 0 && --m_marchCountdown <= 0)
+	{
+		Trigger(static_cast<SoundEffect>(soundMarch0 + m_marchNote));
+		m_marchNote = (m_marchNote + 1) % 4;
+
+		// About a note a second for a full wave, seven for the last enemy
+		m_marchCountdown = 20 + 130 * enemies / m_enemiesAtStart;
+	}
+
+	if (playing == true && master == true && m_ufoVoice < 0)
+	{
+		m_ufoVoice = Trigger(soundUfo, true);
+	}
+	else if ((playing == false || master == false) && m_ufoVoice >= 0)
+	{
+		m_backend->Stop(m_ufoVoice);
+		m_voices[m_ufoVoice].m_active = false;
+		m_ufoVoice = -1;
+	}
+}
+
+bool AudioSystem::RunLatencyTest(const GameSettings& settings, int ticks)
+{
+	AssetBundle assets;
+	assets.Open("Media.bundle");
+
+	LevelSet levels;
+	levels.Load(assets, settings.m_levelFile);
+
+	SimulationAssets media;
+	if (media.Load(assets) == false)
+	{
+		std::cerr << "Audio: missing textures" << std::endl;
+		return false;
+	}
+
+	GameSettings onePlayer = settings;
+	onePlayer.m_players = 1;
+	onePlayer.m_netplay = false;
+
+	BotEnvironment environment;
+	environment.Init(onePlayer, levels, media);
+
+	// A handful of triggers a tick at most
+	std::size_t maxPlays = static_cast<std::size_t>(ticks) * 8;
+	NullAudioBackend backend(maxPlays);
+	AudioSystem audio;
+	audio.Init(backend, assets);
+
+	std::vector<sf::Int64> latencies;
+	latencies.reserve(maxPlays);
+	BotObservation observation;
+
+	for (int tick = 0; tick < ticks; tick++)
+	{
+		environment.Observe(observation);
+		environment.Step(BotEnvironment::ScriptedPolicy(observation));
+		backend.SetTime(sf::seconds(static_cast<float>(tick) / Simulation::TicksPerSecond));
+
+		// The events exist from the end of Step(), which is the trigger time
+		std::size_t first = backend.GetPlayTimes().size();
+		sf::Time triggered = backend.GetClock().getElapsedTime();
+		audio.Update(environment.GetSimulation());
+
+		for (std::size_t i = first; i < backend.GetPlayTimes().size(); i++)
+		{
+			latencies.push_back((backend.GetPlayTimes()[i] - triggered).asMicroseconds());
+		}
+
+		if (environment.IsDone() == true)
+		{
+			audio.StopAll();
+			environment.Reset();
+		}
+	}
+
+	if (latencies.empty() == true)
+	{
+		std::cout << "Audio: no sound triggered" << std::endl;
+		return false;
+	}
+
+	std::sort(latencies.begin(), latencies.end());
+	sf::Int64 p50 = latencies[latencies.size() / 2];
+	sf::Int64 p99 = latencies[latencies.size() * 99 / 100];
+	sf::Int64 worst = latencies.back();
+
+	std::cout << "Audio: " << ticks << " ticks, " << latencies.size() << " triggers (";
+	for (int i = 0; i < soundCount; i++)
+	{
+		std::cout << (i > 0 ? ", " : "") << SoundNames[i] << " " << audio.GetTriggered(static_cast<SoundEffect>(i));
+	}
+	std::cout << "), " << audio.GetStolen() << " stolen, " << audio.GetDropped() << " dropped" << std::endl;
+	std::cout << "Trigger to backend: p50 " << p50 << "us, p99 " << p99 << "us, max " << worst << "us" << std::endl;
+	return true;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+class AssetBundle;
+class Simulation;
+struct GameSettings;
+
+//
+// Sound effects, played from the events of each tick. Every buffer is
+// loaded or synthesized by Init(); after that a trigger only picks one of
+// a fixed set of voices and starts it, without allocation or file I/O.
+// When every voice is busy the least important, oldest one is stolen.
+//
+
+#define AUDIO_VOICES 16
+#define AUDIO_SAMPLE_RATE 22050
+
+enum SoundEffect
+{
+	soundShoot,
+	soundExplosion,
+	soundPlayerHit,
+	soundMarch0,		// four notes of the enemy march, played in turn
+	soundMarch1,
+	soundMarch2,
+	soundMarch3,
+	soundUfo,			// loops while the master is on screen
+	soundCount
+};
+
+// Where voices are played. Voices are numbered 0 to AUDIO_VOICES - 1.
+class AudioBackend
+{
+public:
+	virtual ~AudioBackend() { }
+
+	// A sound file of the bundle, e.g. a replacement recording.
+	virtual bool Load(SoundEffect sound, const AssetBundle& assets, const std::string& name) = 0;
+
+	// 16-bit mono samples.
+	virtual bool Load(SoundEffect sound, const std::vector<sf::Int16>& samples, unsigned sampleRate) = 0;
+
+	virtual void Play(int voice, SoundEffect sound, bool loop) = 0;
+	virtual void Stop(int voice) = 0;
+	virtual bool IsPlaying(int voice) const = 0;
+};
+
+// OpenAL through sf::Sound, one per voice.
+class SfmlAudioBackend : public AudioBackend
+{
+public:
+	bool Load(SoundEffect sound, const AssetBundle& assets, const std::string& name) override;
+	bool Load(SoundEffect sound, const std::vector<sf::Int16>& samples, unsigned sampleRate) override;
+
+	void Play(int voice, SoundEffect sound, bool loop) override;
+	void Stop(int voice) override;
+	bool IsPlaying(int voice) const override;
+
+private:
+	// Accounted to memoryAudio as they are loaded.
+	std::size_t GetBufferBytes(SoundEffect sound) const { return static_cast<std::size_t>(m_buffers[sound].getSampleCount()) * sizeof(sf::Int16); }
+
+	sf::SoundBuffer m_buffers[soundCount];
+	sf::Sound m_voices[AUDIO_VOICES];
+};
+
+// No device: keeps the sound lengths and plays voices against a time set
+// by the caller, and timestamps every Play() on a real clock so a harness
+// can measure how long triggers take to reach the backend.
+class NullAudioBackend : public AudioBackend
+{
+public:
+	explicit NullAudioBackend(std::size_t maxPlays);
+
+	bool Load(SoundEffect sound, const AssetBundle& assets, const std::string& name) override;
+	bool Load(SoundEffect sound, const std::vector<sf::Int16>& samples, unsigned sampleRate) override;
+
+	void Play(int voice, SoundEffect sound, bool loop) override;
+	void Stop(int voice) override;
+	bool IsPlaying(int voice) const override;
+
+	// Playback time, e.g. the simulated time of a headless run.
+	void SetTime(sf::Time time) { m_time = time; }
+
+	const sf::Clock& GetClock() const { return m_clock; }
+	const std::vector<sf::Time>& GetPlayTimes() const { return m_playTimes; }
+
+private:
+	struct Voice
+	{
+		sf::Time m_start;
+		sf::Time m_duration;
+		bool m_loop = false;
+		bool m_playing = false;
+	};
+
+	sf::Time m_durations[soundCount];
+	Voice m_voices[AUDIO_VOICES];
+	sf::Time m_time;
+	sf::Clock m_clock;
+	std::vector<sf::Time> m_playTimes;	// by m_clock, up to the capacity given
+};
+
+class AudioSystem
+{
+public:
+	// Loads Sounds/<name>.wav from the bundle where present and synthesizes
+	// the other sounds. The backend must outlive this.
+	void Init(AudioBackend& backend, const AssetBundle& assets);
+
+	// Game thread, once per tick after Simulation::Step().
+	void Update(const Simulation& simulation);
+
+	void StopAll();
+
+	std::size_t GetTriggered(SoundEffect sound) const { return m_triggered[sound]; }
+	std::size_t GetStolen() const { return m_stolen; }
+	std::size_t GetDropped() const { return m_dropped; }
+
+	// SpaceInvaders1978 --audio-latency: plays a headless bot game into the
+	// null backend and prints trigger to backend latencies. There is no
+	// device: the device buffer comes on top, and is not measured here.
+	static bool RunLatencyTest(const GameSettings& settings, int ticks);
+
+private:
+	// Returns the voice, -1 when every voice is more important.
+	int Trigger(SoundEffect sound, bool loop = false);
+
+private:
+	struct Voice
+	{
+		int m_priority = 0;
+		std::uint64_t m_started = 0;
+		bool m_active = false;
+	};
+
+	AudioBackend* m_backend = nullptr;
+	Voice m_voices[AUDIO_VOICES];
+	std::uint64_t m_triggers = 0;		// orders the voices by age
+	int m_ufoVoice = -1;
+
+	// March tempo follows the enemies left, like the original.
+	int m_marchNote = 0;
+	int m_marchCountdown = 0;
+	int m_enemiesAtStart = 0;
+	std::uint64_t m_lastTick = 0;
+
+	std::size_t m_triggered[soundCount] = { };
+	std::size_t m_stolen = 0;
+	std::size_t m_dropped = 0;
+};
@@ -0,0 +1,288 @@
+#include "pch.h"
+#include "Bot.h"
+#include "AssetBundle.h"
+
+static const float CellSize = 40.f;
+
+// Seeds of a batch are consecutive, so the games of one environment step
+// by a large odd constant to stay apart from those of the others.
+static const std::uint64_t EpisodeSeedStep = 0x9E3779B97F4A7C15ull;
+
+//
+// BotEnvironment
+//
+
+void BotEnvironment::Init(const GameSettings& settings, const LevelSet& levels, const SimulationAssets& assets)
+{
+	m_Simulation.Init(settings, levels, assets);
+	m_Simulation.SaveState(m_InitialState);
+	m_Seed = settings.m_seed;
+	m_Episode = 0;
+
+	const Simulation& simulation = m_Simulation;
+	m_Bullets.reserve(simulation.GetEnemyWeapons().GetCapacity() + simulation.GetEnemyMasterWeapons().GetCapacity());
+	m_LevelsCleared = 0;
+}
+
+void BotEnvironment::Reset()
+{
+	m_Simulation.LoadState(m_InitialState);
+
+	// Loading restores the generator of the first game.
+	m_Episode++;
+	m_Simulation.Reseed(m_Seed + m_Episode * EpisodeSeedStep);
+	m_LevelsCleared = 0;
+}
+
+int BotEnvironment::Step(PlayerInput action)
+{
+	int score = m_Simulation.GetScore(0);
+	std::size_t level = m_Simulation.GetLevel();
+
+	PlayerInput inputs[MAX_PLAYERS];
+	inputs[0] = action;
+	m_Simulation.Step(inputs);
+
+	if (m_Simulation.GetLevel() != level)
+	{
+		m_LevelsCleared++;
+	}
+
+	return m_Simulation.GetScore(0) - score;
+}
+
+void BotEnvironment::Observe(BotObservation& observation) const
+{
+	Observe(m_Simulation, observation, m_Bullets);
+}
+
+void BotEnvironment::Observe(const Simulation& simulation, BotObservation& observation, std::vector<sf::Vector2f>& bullets)
+{
+	float* values = observation.m_values;
+	std::fill(values, values + BOT_OBSERVATION_SIZE, 0.f);
+
+	//
+	// Enemy grid
+	//
+
+	auto mark = [values](std::size_t, const Transform& transform, const Collider& collider) {
+		if (collider.m_enabled == false)
+		{
+			return;
+		}
+
+		int column = static_cast<int>((transform.m_position.x + collider.m_size.x / 2) / CellSize);
+		int row = static_cast<int>((transform.m_position.y + collider.m_size.y / 2) / CellSize);
+		if (column >= 0 && column < BOT_GRID_COLUMNS && row >= 0 && row < BOT_GRID_ROWS)
+		{
+			values[BOT_OBSERVATION_GRID + row * BOT_GRID_COLUMNS + column] = 1.f;
+		}
+	};
+	simulation.GetEntities().Get<EntityType::enemyMaster>().ForEach<Transform, Collider>(mark);
+	simulation.GetEntities().Get<EntityType::enemy>().ForEach<Transform, Collider>(mark);
+
+	//
+	// Enemy projectiles, the lowest ones first
+	//
+
+	bullets.clear();
+	const ProjectilePool* pools[] = { &simulation.GetEnemyWeapons(), &simulation.GetEnemyMasterWeapons() };
+	for (const ProjectilePool* pool : pools)
+	{
+		for (std::size_t i = 0; i < pool->GetCount(); i++)
+		{
+			// Not those already out of the field, on their last move
+			if (pool->GetY(i) < Simulation::FieldHeight)
+			{
+				bullets.push_back(sf::Vector2f(pool->GetX(i), pool->GetY(i)));
+			}
+		}
+	}
+
+	std::size_t count = std::min<std::size_t>(bullets.size(), BOT_BULLETS);
+	std::partial_sort(bullets.begin(), bullets.begin() + count, bullets.end(),
+		[](const sf::Vector2f& a, const sf::Vector2f& b) { return a.y > b.y; });
+
+	for (std::size_t i = 0; i < count; i++)
+	{
+		values[BOT_OBSERVATION_BULLETS + i * 2] = std::max(0.f, std::min(1.f, bullets[i].x / Simulation::FieldWidth));
+		values[BOT_OBSERVATION_BULLETS + i * 2 + 1] = std::max(0.f, std::min(1.f, bullets[i].y / Simulation::FieldHeight));
+	}
+
+	//
+	// Player
+	//
+
+	const EntityManager& entities = simulation.GetEntities();
+	int player = entities.FindPlayer(0);
+	if (player >= 0)
+	{
+		const BasicArchetype& players = entities.Get<EntityType::player>();
+		float x = players.Get<Transform>()[player].m_position.x + players.Get<Collider>()[player].m_size.x / 2;
+		values[BOT_OBSERVATION_PLAYER] = std::max(0.f, std::min(1.f, x / Simulation::FieldWidth));
+	}
+}
+
+PlayerInput BotEnvironment::ScriptedPolicy(const BotObservation& observation)
+{
+	const float* values = observation.m_values;
+	float x = values[BOT_OBSERVATION_PLAYER] * Simulation::FieldWidth;
+
+	PlayerInput input;
+	input.m_buttons = PlayerInput::Fire;
+
+	// Dodge the lowest projectile falling on the player
+	for (int i = 0; i < BOT_BULLETS; i++)
+	{
+		float bx = values[BOT_OBSERVATION_BULLETS + i * 2] * Simulation::FieldWidth;
+		float by = values[BOT_OBSERVATION_BULLETS + i * 2 + 1] * Simulation::FieldHeight;
+		if (by == 0.f)
+		{
+			break;
+		}
+
+		if (by > 380.f && std::abs(bx - x) < 24.f)
+		{
+			bool toRight = bx < x ? x < Simulation::FieldWidth - 40.f : x < 40.f;
+			input.m_buttons |= toRight ? PlayerInput::Right : PlayerInput::Left;
+			return input;
+		}
+	}
+
+	// Otherwise go under the closest column of the lowest enemy row
+	for (int row = BOT_GRID_ROWS - 1; row >= 0; row--)
+	{
+		float target = -1.f;
+		for (int column = 0; column < BOT_GRID_COLUMNS; column++)
+		{
+			if (values[BOT_OBSERVATION_GRID + row * BOT_GRID_COLUMNS + column] == 0.f)
+			{
+				continue;
+			}
+
+			float centre = (column + 0.5f) * CellSize;
+			if (target < 0.f || std::abs(centre - x) < std::abs(target - x))
+			{
+				target = centre;
+			}
+		}
+
+		if (target >= 0.f)
+		{
+			if (target > x + 4.f)
+				input.m_buttons |= PlayerInput::Right;
+			else if (target < x - 4.f)
+				input.m_buttons |= PlayerInput::Left;
+			break;
+		}
+	}
+
+	return input;
+}
+
+//
+// BotBatch
+//
+
+void BotBatch::Init(std::size_t count, const GameSettings& settings, const LevelSet& levels, const SimulationAssets& assets)
+{
+	m_Environments.resize(count);
+	m_Stats = BotEpisodeStats();
+
+	for (std::size_t i = 0; i < count; i++)
+	{
+		GameSettings environment = settings;
+		environment.m_seed = settings.m_seed + i;
+		m_Environments[i].Init(environment, levels, assets);
+	}
+}
+
+void BotBatch::Step(const PlayerInput* actions, BotObservation* observations, float* rewards, bool* dones)
+{
+	for (std::size_t i = 0; i < m_Environments.size(); i++)
+	{
+		BotEnvironment& environment = m_Environments[i];
+		int reward = environment.Step(actions[i]);
+		bool done = environment.IsDone();
+
+		if (done == true)
+		{
+			const Simulation& simulation = environment.GetSimulation();
+			m_Stats.m_episodes++;
+			m_Stats.m_ticks += simulation.GetTick();
+			m_Stats.m_score += simulation.GetScore(0);
+			m_Stats.m_levels += environment.GetLevelsCleared();
+			environment.Reset();
+		}
+
+		environment.Observe(observations[i]);
+		if (rewards != nullptr)
+			rewards[i] = static_cast<float>(reward);
+		if (dones != nullptr)
+			dones[i] = done;
+	}
+}
+
+void BotBatch::Observe(BotObservation* observations) const
+{
+	for (std::size_t i = 0; i < m_Environments.size(); i++)
+	{
+		m_Environments[i].Observe(observations[i]);
+	}
+}
+
+bool BotBatch::RunBenchmark(const GameSettings& settings, std::size_t environments, std::uint64_t steps)
+{
+	AssetBundle assets;
+	assets.Open("Media.bundle");
+
+	LevelSet levels;
+	levels.Load(assets, settings.m_levelFile);
+
+	SimulationAssets media;
+	if (media.Load(assets) == false)
+	{
+		std::cerr << "Bot: missing textures" << std::endl;
+		return false;
+	}
+
+	GameSettings onePlayer = settings;
+	onePlayer.m_players = 1;
+	onePlayer.m_netplay = false;
+
+	environments = std::max<std::size_t>(environments, 1);
+	BotBatch batch;
+	batch.Init(environments, onePlayer, levels, media);
+
+	std::vector<BotObservation> observations(environments);
+	std::vector<PlayerInput> actions(environments);
+	batch.Observe(observations.data());
+
+	std::uint64_t rounds = std::max<std::uint64_t>(steps / environments, 1);
+	sf::Clock clock;
+	for (std::uint64_t round = 0; round < rounds; round++)
+	{
+		for (std::size_t i = 0; i < environments; i++)
+		{
+			actions[i] = BotEnvironment::ScriptedPolicy(observations[i]);
+		}
+		batch.Step(actions.data(), observations.data(), nullptr, nullptr);
+	}
+	sf::Time elapsed = clock.getElapsedTime();
+
+	std::uint64_t total = rounds * environments;
+	const BotEpisodeStats& stats = batch.GetStats();
+	std::cout << environments << " environments, " << total << " steps in " << elapsed.asMilliseconds() << "ms: "
+		<< static_cast<std::uint64_t>(total / std::max(elapsed.asSeconds(), 1e-6f)) << " steps/s (policy included)" << std::endl;
+
+	if (stats.m_episodes == 0)
+	{
+		std::cout << "no game finished" << std::endl;
+		return true;
+	}
+
+	std::cout << stats.m_episodes << " games: score " << stats.m_score / static_cast<std::int64_t>(stats.m_episodes)
+		<< ", levels cleared " << static_cast<double>(stats.m_levels) / stats.m_episodes
+		<< ", length " << stats.m_ticks / stats.m_episodes / Simulation::TicksPerSecond << "s (averages)" << std::endl;
+	return true;
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include "Simulation.h"
+
+//
+// Programmatic players. A BotEnvironment wraps one headless simulation:
+// Observe() fills a flat vector of floats, Step() applies an action (the
+// same PlayerInput the keyboard produces) for one fixed tick. BotBatch runs
+// many environments side by side and resets each one when its game ends,
+// which is the shape training code and balance tests want.
+//
+
+#define BOT_GRID_COLUMNS 21		// 40 x 40 cells over the 840 x 600 playfield
+#define BOT_GRID_ROWS 15
+#define BOT_BULLETS 16			// enemy projectiles closest to the player
+
+// Offsets into BotObservation::m_values, every value in [0, 1]:
+//   grid     1 where an enemy centre lies in the cell, row by row
+//   bullets  x, y of the lowest enemy projectiles, lowest first, (0, 0) padding
+//   player   x of the player
+#define BOT_OBSERVATION_GRID 0
+#define BOT_OBSERVATION_BULLETS (BOT_GRID_COLUMNS * BOT_GRID_ROWS)
+#define BOT_OBSERVATION_PLAYER (BOT_OBSERVATION_BULLETS + BOT_BULLETS * 2)
+#define BOT_OBSERVATION_SIZE (BOT_OBSERVATION_PLAYER + 1)
+
+struct BotObservation
+{
+	float m_values[BOT_OBSERVATION_SIZE];
+};
+
+class BotEnvironment
+{
+public:
+	// Player 0 is the bot; the level set must outlive this.
+	void Init(const GameSettings& settings, const LevelSet& levels, const SimulationAssets& assets);
+
+	// Back to the first tick of the first level, with the random generator
+	// seeded from the seed of the settings and the number of the episode,
+	// so that each game differs.
+	void Reset();
+
+	// Advances one tick; returns the score gained in it.
+	int Step(PlayerInput action);
+
+	void Observe(BotObservation& observation) const;
+
+	// Same view of any simulation, e.g. the one of the window; bullets is
+	// scratch space, reserved by the caller to keep this allocation free.
+	static void Observe(const Simulation& simulation, BotObservation& observation, std::vector<sf::Vector2f>& bullets);
+
+	bool IsDone() const { return m_Simulation.IsGameOver(); }
+	std::size_t GetLevelsCleared() const { return m_LevelsCleared; }
+	const Simulation& GetSimulation() const { return m_Simulation; }
+
+	// Hand-written player: stays under the lowest enemies, dodges what falls
+	// on it and fires whenever it can. A baseline for balance checks.
+	static PlayerInput ScriptedPolicy(const BotObservation& observation);
+
+private:
+	Simulation m_Simulation;
+	std::vector<unsigned char> m_InitialState;
+	std::uint64_t m_Seed = 0;
+	std::uint64_t m_Episode = 0;			// games started since Init()
+	std::size_t m_LevelsCleared = 0;
+	mutable std::vector<sf::Vector2f> m_Bullets;	// scratch of Observe()
+};
+
+// Per-game results of a batch, for balance tests.
+struct BotEpisodeStats
+{
+	std::size_t m_episodes = 0;
+	std::uint64_t m_ticks = 0;
+	std::int64_t m_score = 0;
+	std::size_t m_levels = 0;		// levels cleared, summed over episodes
+};
+
+class BotBatch
+{
+public:
+	// Environment i plays with seed settings.m_seed + i.
+	void Init(std::size_t count, const GameSettings& settings, const LevelSet& levels, const SimulationAssets& assets);
+
+	// One tick of every environment: actions and observations hold one entry
+	// per environment, rewards and dones may be nullptr. A finished game is
+	// recorded and reset, and its observation is the first of the new game.
+	void Step(const PlayerInput* actions, BotObservation* observations, float* rewards, bool* dones);
+
+	void Observe(BotObservation* observations) const;
+
+	std::size_t GetCount() const { return m_Environments.size(); }
+	const BotEpisodeStats& GetStats() const { return m_Stats; }
+
+	// SpaceInvaders1978 --bot-bench: runs the scripted policy over a batch
+	// and prints steps per second and the balance figures.
+	static bool RunBenchmark(const GameSettings& settings, std::size_t environments, std::uint64_t steps);
+
+private:
+	std::vector<BotEnvironment> m_Environments;
+	BotEpisodeStats m_Stats;
+};
@@ -0,0 +1,14 @@
+#pragma once
+
+// FNV-1a, 32 bits. Cheap enough to run over every asset at startup and
+// good enough to catch truncated or corrupted data files.
+inline std::uint32_t Fnv1a32(const void* data, std::size_t size, std::uint32_t hash = 2166136261u)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (std::size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "Entity.h"
+
+//
+// Which entity types collide, fixed at compile time. Rows are the moving
+// side (a projectile pool, or the enemies for the invasion), columns what
+// they run into. Simulation::DetectCollisions<A, B>() is instantiated once
+// per pair of the matrix and only walks the entities of type B, so its
+// loops carry no type test; instantiating it for a pair the matrix does
+// not list fails to compile.
+//
+
+#define ENTITY_TYPE_COUNT (EntityType::block + 1)
+
+enum CollisionTest
+{
+	collisionNone,
+	collisionBounds,	// projectiles against entity rectangles
+	collisionShield,	// projectiles against the pixels left of the shields
+	collisionInvasion	// enemies against block rectangles
+};
+
+constexpr CollisionTest CollisionMatrix[ENTITY_TYPE_COUNT][ENTITY_TYPE_COUNT] =
+{
+	//				player				weapon			enemyWeapon		enemyMasterWeapon	enemy				enemyMaster			block
+	/* player */	{ collisionNone,	collisionNone,	collisionNone,	collisionNone,		collisionNone,		collisionNone,		collisionNone },
+	/* weapon */	{ collisionBounds,	collisionNone,	collisionNone,	collisionNone,		collisionBounds,	collisionBounds,	collisionShield },
+	/* enemyW. */	{ collisionBounds,	collisionNone,	collisionNone,	collisionNone,		collisionNone,		collisionNone,		collisionShield },
+	/* masterW. */	{ collisionBounds,	collisionNone,	collisionNone,	collisionNone,		collisionNone,		collisionNone,		collisionShield },
+	/* enemy */		{ collisionNone,	collisionNone,	collisionNone,	collisionNone,		collisionNone,		collisionNone,		collisionInvasion },
+	/* master */	{ collisionNone,	collisionNone,	collisionNone,	collisionNone,		collisionNone,		collisionNone,		collisionNone },
+	/* block */		{ collisionNone,	collisionNone,	collisionNone,	collisionNone,		collisionNone,		collisionNone,		collisionNone }
+};
+
+constexpr CollisionTest GetCollisionTest(EntityType a, EntityType b)
+{
+	return CollisionMatrix[a][b];
+}
+
+constexpr int CountCollisionPairs()
+{
+	int count = 0;
+	for (int a = 0; a < ENTITY_TYPE_COUNT; a++)
+	{
+		for (int b = 0; b < ENTITY_TYPE_COUNT; b++)
+		{
+			if (CollisionMatrix[a][b] != collisionNone)
+				count++;
+		}
+	}
+	return count;
+}
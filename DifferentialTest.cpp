@@ -0,0 +1,378 @@
+#include "pch.h"
+#include "DifferentialTest.h"
+#include "AssetBundle.h"
+#include "GameState.h"
+#include "Checksum.h"
+
+// Written on a failure, in the working directory.
+static const char* FailurePath = "diff-failure.txt";
+
+// Runs of a case spent on shrinking one failure at most.
+static const std::size_t ShrinkRuns = 400;
+
+//
+// DifferentialCase
+//
+
+bool DifferentialCase::Save(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::trunc);
+	file << m_seed << ' ' << m_players << ' ' << (m_versus ? 1 : 0) << ' ' << GetTicks() << '\n';
+
+	static const char* Digits = "0123456789abcdef";
+	for (std::size_t tick = 0; tick < GetTicks(); tick++)
+	{
+		for (int player = 0; player < m_players; player++)
+		{
+			unsigned char buttons = m_inputs[tick * m_players + player];
+			file << (player > 0 ? " " : "") << Digits[buttons >> 4] << Digits[buttons & 15];
+		}
+		file << '\n';
+	}
+	return file.good();
+}
+
+bool DifferentialCase::Load(const std::string& path)
+{
+	std::ifstream file(path);
+	int versus = 0;
+	std::size_t ticks = 0;
+	file >> m_seed >> m_players >> versus >> ticks;
+	if (file.fail() == true || m_players < 1 || m_players > MAX_PLAYERS)
+	{
+		return false;
+	}
+
+	m_versus = versus != 0;
+	m_inputs.resize(ticks * m_players);
+	for (unsigned char& buttons : m_inputs)
+	{
+		unsigned value = 0;
+		file >> std::hex >> value;
+		if (file.fail() == true)
+		{
+			return false;
+		}
+		buttons = static_cast<unsigned char>(value);
+	}
+	return true;
+}
+
+//
+// DifferentialTest
+//
+
+bool DifferentialTest::Init(const GameSettings& settings)
+{
+	AssetBundle assets;
+	assets.Open("Media.bundle");
+	m_Levels.Load(assets, settings.m_levelFile);
+
+	if (m_Assets.Load(assets) == false)
+	{
+		std::cerr << "Differential test: missing textures" << std::endl;
+		return false;
+	}
+
+	m_Settings = settings;
+	m_Settings.m_netplay = false;
+	m_Settings.m_bot = false;
+	return true;
+}
+
+GameSettings DifferentialTest::GetSettings(const GameSettings& settings, const DifferentialCase& test)
+{
+	GameSettings game = settings;
+	game.m_seed = test.m_seed;
+	game.m_players = test.m_players;
+	game.m_versus = test.m_versus;
+	return game;
+}
+
+void DifferentialTest::Play(const DifferentialCase& test, std::vector<std::uint32_t>& hashes)
+{
+	m_Simulation.Init(GetSettings(m_Settings, test), m_Levels, m_Assets);
+
+	hashes.clear();
+	hashes.push_back(Hash(m_Simulation));
+
+	PlayerInput inputs[MAX_PLAYERS];
+	for (std::size_t tick = 0; tick < test.GetTicks(); tick++)
+	{
+		for (int player = 0; player < test.m_players; player++)
+		{
+			inputs[player].m_buttons = test.m_inputs[tick * test.m_players + player];
+		}
+		m_Simulation.Step(inputs);
+		hashes.push_back(Hash(m_Simulation));
+	}
+}
+
+void DifferentialTest::PlayReference(const DifferentialCase& test, std::vector<std::uint32_t>& hashes)
+{
+	m_Reference.Init(GetSettings(m_Settings, test), m_Levels, m_Assets);
+
+	hashes.clear();
+	hashes.push_back(Hash(m_Reference));
+
+	PlayerInput inputs[MAX_PLAYERS];
+	for (std::size_t tick = 0; tick < test.GetTicks(); tick++)
+	{
+		for (int player = 0; player < test.m_players; player++)
+		{
+			inputs[player].m_buttons = test.m_inputs[tick * test.m_players + player];
+		}
+		m_Reference.Step(inputs);
+		hashes.push_back(Hash(m_Reference));
+	}
+}
+
+int DifferentialTest::Compare(const DifferentialCase& test)
+{
+	Play(test, m_Hashes);
+	PlayReference(test, m_ReferenceHashes);
+	m_Runs++;
+
+	for (std::size_t i = 0; i < m_Hashes.size(); i++)
+	{
+		if (m_Hashes[i] != m_ReferenceHashes[i])
+		{
+			return static_cast<int>(i);
+		}
+	}
+	return -1;
+}
+
+void DifferentialTest::Shrink(DifferentialCase& test)
+{
+	std::size_t runs = m_Runs + ShrinkRuns;
+	int divergence = Compare(test);
+	if (divergence < 0)
+	{
+		return;
+	}
+
+	// Nothing after the divergence matters. Hash 0 is the initial state:
+	// a divergence there needs no input at all.
+	test.m_inputs.resize(static_cast<std::size_t>(divergence) * test.m_players);
+
+	// Then runs of ticks, halving in length: first dropped, then emptied.
+	for (int pass = 0; pass < 2; pass++)
+	{
+		for (std::size_t length = test.GetTicks() / 2; length > 0 && m_Runs < runs; length /= 2)
+		{
+			std::size_t tick = 0;
+			while (tick + length <= test.GetTicks() && m_Runs < runs)
+			{
+				DifferentialCase candidate = test;
+				std::vector<unsigned char>::iterator first = candidate.m_inputs.begin() + tick * test.m_players;
+				std::vector<unsigned char>::iterator last = first + length * test.m_players;
+
+				bool changed = true;
+				if (pass == 0)
+				{
+					candidate.m_inputs.erase(first, last);
+				}
+				else
+				{
+					changed = std::any_of(first, last, [](unsigned char buttons) { return buttons != 0; });
+					std::fill(first, last, static_cast<unsigned char>(0));
+				}
+
+				divergence = changed == true ? Compare(candidate) : -1;
+				if (divergence >= 0)
+				{
+					candidate.m_inputs.resize(std::min(candidate.m_inputs.size(), static_cast<std::size_t>(divergence) * test.m_players));
+					test = candidate;
+					continue;
+				}
+				tick += length;
+			}
+		}
+	}
+}
+
+void DifferentialTest::Generate(Random& random, int ticks, DifferentialCase& test)
+{
+	test.m_seed = random.Next();
+	test.m_players = 1 + random.NextInt(MAX_PLAYERS);
+	test.m_versus = test.m_players > 1 && random.NextInt(2) == 0;
+	test.m_inputs.resize(static_cast<std::size_t>(ticks) * test.m_players);
+
+	// Buttons held for a while, as a player would, each player on its own.
+	for (int player = 0; player < test.m_players; player++)
+	{
+		int tick = 0;
+		while (tick < ticks)
+		{
+			unsigned char buttons = static_cast<unsigned char>(random.NextInt(32));
+			int hold = 1 + random.NextInt(Simulation::TicksPerSecond);
+			for (int end = std::min(ticks, tick + hold); tick < end; tick++)
+			{
+				test.m_inputs[static_cast<std::size_t>(tick) * test.m_players + player] = buttons;
+			}
+		}
+	}
+}
+
+// Counters, lives and scores, then the sums of the entities and of each
+// projectile pool, then the shields.
+template <typename SimulationType>
+static std::uint32_t HashState(SimulationType& simulation, std::uint32_t entities, const std::uint32_t* projectiles)
+{
+	std::uint32_t counters[4] = {
+		static_cast<std::uint32_t>(simulation.GetTick()),
+		static_cast<std::uint32_t>(simulation.GetLevel()),
+		simulation.IsGameOver() ? 1u : 0u,
+		static_cast<std::uint32_t>(simulation.GetPlayerCount())
+	};
+	std::uint32_t hash = Fnv1a32(counters, sizeof(counters));
+
+	for (int player = 0; player < simulation.GetPlayerCount(); player++)
+	{
+		std::int32_t values[2] = { simulation.GetLives(player), simulation.GetScore(player) };
+		hash = Fnv1a32(values, sizeof(values), hash);
+	}
+
+	hash = Fnv1a32(&entities, sizeof(entities), hash);
+	for (int pool = 0; pool < 3; pool++)
+	{
+		hash = Fnv1a32(&projectiles[pool], sizeof(projectiles[pool]), hash);
+	}
+
+	std::vector<unsigned char> shields;
+	StateWriter writer(shields);
+	for (std::size_t i = 0; i < simulation.GetShieldCount(); i++)
+	{
+		simulation.GetShield(i).Save(writer);
+	}
+	return Fnv1a32(shields.data(), shields.size(), hash);
+}
+
+static std::uint32_t HashEntity(EntityType type, const sf::Vector2f& position)
+{
+	float values[3] = { static_cast<float>(type), position.x, position.y };
+	return Fnv1a32(values, sizeof(values));
+}
+
+static std::uint32_t HashProjectile(float x, float y)
+{
+	float values[2] = { x, y };
+	return Fnv1a32(values, sizeof(values));
+}
+
+std::uint32_t DifferentialTest::Hash(Simulation& simulation)
+{
+	// Order-free sums over entities and projectiles
+	std::uint32_t entities = 0;
+	simulation.GetEntities().ForEach([&entities](std::size_t, const Transform& transform, const Collider& collider, const Renderable& renderable) {
+		if (collider.m_enabled == true)
+		{
+			entities += HashEntity(renderable.m_type, transform.m_position);
+		}
+	});
+
+	std::uint32_t projectiles[3] = {};
+	const ProjectilePool* pools[] = { &simulation.GetPlayerWeapons(), &simulation.GetEnemyWeapons(), &simulation.GetEnemyMasterWeapons() };
+	for (int pool = 0; pool < 3; pool++)
+	{
+		for (std::size_t i = 0; i < pools[pool]->GetCount(); i++)
+		{
+			projectiles[pool] += HashProjectile(pools[pool]->GetX(i), pools[pool]->GetY(i));
+		}
+	}
+
+	return HashState(simulation, entities, projectiles);
+}
+
+std::uint32_t DifferentialTest::Hash(const ReferenceSimulation& reference)
+{
+	std::uint32_t entities = 0;
+	for (const ReferenceEntity& entity : reference.GetEntities())
+	{
+		if (entity.m_enabled == true)
+		{
+			entities += HashEntity(entity.m_type, entity.m_position);
+		}
+	}
+
+	std::uint32_t projectiles[3] = {};
+	EntityType types[] = { EntityType::weapon, EntityType::enemyWeapon, EntityType::enemyMasterWeapon };
+	for (int pool = 0; pool < 3; pool++)
+	{
+		for (const ReferenceProjectile& projectile : reference.GetProjectiles(types[pool]))
+		{
+			projectiles[pool] += HashProjectile(projectile.m_x, projectile.m_y);
+		}
+	}
+
+	return HashState(reference, entities, projectiles);
+}
+
+bool DifferentialTest::RunCase(const GameSettings& settings, const std::string& path)
+{
+	DifferentialCase test;
+	if (test.Load(path) == false)
+	{
+		std::cerr << "Differential test: cannot read " << path << std::endl;
+		return false;
+	}
+
+	std::unique_ptr<DifferentialTest> harness(new DifferentialTest());
+	if (harness->Init(settings) == false)
+	{
+		return false;
+	}
+
+	int divergence = harness->Compare(test);
+	std::size_t last = divergence < 0 ? harness->m_Hashes.size() - 1 : static_cast<std::size_t>(divergence);
+	std::cout << std::hex;
+	for (std::size_t i = 0; i <= last; i++)
+	{
+		std::cout << harness->m_Hashes[i] << ' ' << harness->m_ReferenceHashes[i] << '\n';
+	}
+	std::cout << std::dec;
+
+	if (divergence >= 0)
+	{
+		std::cout << "diverges at tick " << divergence << std::endl;
+		return false;
+	}
+	std::cout << test.GetTicks() << " ticks match the reference" << std::endl;
+	return true;
+}
+
+bool DifferentialTest::Run(const GameSettings& settings, int cases, int ticks)
+{
+	std::unique_ptr<DifferentialTest> harness(new DifferentialTest());
+	if (harness->Init(settings) == false)
+	{
+		return false;
+	}
+
+	Random random(settings.m_seed);
+	DifferentialCase test;
+	for (int i = 0; i < cases; i++)
+	{
+		Generate(random, ticks, test);
+
+		int divergence = harness->Compare(test);
+		if (divergence < 0)
+		{
+			continue;
+		}
+
+		std::cout << "case " << i << " (seed " << test.m_seed << ", " << test.m_players << " players"
+			<< (test.m_versus ? ", versus" : "") << ") diverges at tick " << divergence << std::endl;
+
+		harness->Shrink(test);
+		divergence = harness->Compare(test);
+		test.Save(FailurePath);
+		std::cout << "shrunk to " << test.GetTicks() << " ticks, diverging at tick " << divergence << ": " << FailurePath
+			<< " (replay with --diff-run)" << std::endl;
+		return false;
+	}
+
+	std::cout << cases << " cases of " << ticks << " ticks match the reference" << std::endl;
+	return true;
+}
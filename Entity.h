@@ -11,21 +11,39 @@ enum EntityType
 	block
 };
 
-class Entity
+//
+// Components. Plain data, so the tables of an archetype copy with one
+// memcpy each; see Archetype.h. Projectiles are not entities: ProjectilePool
+// keeps their positions and owners in tables of its own.
+//
+
+struct Transform
 {
-public:
-	Entity() { };
-	~Entity() { };
+	sf::Vector2f m_position;
+};
 
-public:
-	sf::Sprite m_sprite;
+// Disabled entities are out of the game: they neither collide nor draw.
+struct Collider
+{
 	sf::Vector2u m_size;
-	sf::Vector2f m_position;
-	EntityType m_type;
 	bool m_enabled = true;
 
-	// Enemy only
+	sf::FloatRect GetBounds(const Transform& transform) const { return sf::FloatRect(transform.m_position, sf::Vector2f(m_size)); }
+};
+
+// What Game draws: the animation of the type, tinted by the index, which
+// is the enemy type for enemies, the shield for blocks and the player
+// number for players.
+struct Renderable
+{
+	EntityType m_type = EntityType::player;
+	int m_index = 0;
+};
+
+// March of the enemies and the master.
+struct EnemyAI
+{
 	bool m_bLeftToRight = true;
 	int m_times = 0;
+	int m_score = 0;
 };
-
@@ -1,7 +1,9 @@
 #include "pch.h"
 #include "EntityManager.h"
 
-std::vector<std::shared_ptr<Entity>> EntityManager::m_Entities;
+static_assert(std::is_trivially_copyable<Transform>::value && std::is_trivially_copyable<Collider>::value &&
+	std::is_trivially_copyable<Renderable>::value && std::is_trivially_copyable<EnemyAI>::value,
+	"components must stay memcpy-able for snapshots");
 
 EntityManager::EntityManager()
 {
@@ -12,33 +14,33 @@ EntityManager::~EntityManager()
 {
 }
 
-std::shared_ptr<Entity> EntityManager::GetPlayer()
+std::size_t EntityManager::GetCount() const
 {
-	for (std::shared_ptr<Entity> entity : EntityManager::m_Entities)
-	{
-		if (entity->m_enabled == false)
-		{
-			continue;
-		}
+	return Get<EntityType::player>().GetCount() + Get<EntityType::enemyMaster>().GetCount() +
+		Get<EntityType::enemy>().GetCount() + Get<EntityType::block>().GetCount();
+}
 
-		if (entity->m_type == EntityType::player)
+int EntityManager::FindPlayer(int player) const
+{
+	const ComponentTable<Renderable>& players = Get<EntityType::player>().Get<Renderable>();
+	for (std::size_t i = 0; i < players.size(); i++)
+	{
+		if (players[i].m_index == player)
 		{
-			return entity;
+			return static_cast<int>(i);
 		}
 	}
 
-	return nullptr;
+	return -1;
 }
 
-std::shared_ptr<Entity> EntityManager::GetEnemyMaster()
+void EntityManager::SaveSnapshot()
 {
-	for (std::shared_ptr<Entity> entity : EntityManager::m_Entities)
-	{
-		if (entity->m_type == EntityType::enemyMaster)
-		{
-			return entity;
-		}
-	}
+	m_Snapshot = m_Archetypes;
+}
 
-	return nullptr;
+void EntityManager::RestoreSnapshot()
+{
+	// The tables never grow after Simulation::Init(), so this copies in place.
+	m_Archetypes = m_Snapshot;
 }
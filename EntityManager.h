@@ -1,5 +1,19 @@
 #pragma once
 #include "Entity.h"
+#include "Archetype.h"
+
+typedef Archetype<Transform, Collider, Renderable> BasicArchetype;
+typedef Archetype<Transform, Collider, Renderable, EnemyAI> EnemyArchetype;
+
+// Archetype of each entity type, by its slot in EntityManager. Projectile
+// types have none, so Get<EntityType::weapon>() does not compile.
+constexpr std::size_t GetArchetypeSlot(EntityType type)
+{
+	return type == EntityType::player ? 0 :
+		type == EntityType::enemyMaster ? 1 :
+		type == EntityType::enemy ? 2 :
+		type == EntityType::block ? 3 : 4;
+}
 
 class EntityManager
 {
@@ -8,8 +22,37 @@ public:
 	~EntityManager();
 
 public:
-	static std::vector<std::shared_ptr<Entity>> m_Entities;
-	static std::shared_ptr<Entity> GetPlayer();
-	static std::shared_ptr<Entity> GetEnemyMaster();
-};
+	typedef std::tuple<BasicArchetype, EnemyArchetype, EnemyArchetype, BasicArchetype> Archetypes;
+
+	template <EntityType Type>
+	typename std::tuple_element<GetArchetypeSlot(Type), Archetypes>::type& Get() { return std::get<GetArchetypeSlot(Type)>(m_Archetypes); }
+
+	template <EntityType Type>
+	const typename std::tuple_element<GetArchetypeSlot(Type), Archetypes>::type& Get() const { return std::get<GetArchetypeSlot(Type)>(m_Archetypes); }
 
+	void Clear() { m_Archetypes = Archetypes(); }
+	std::size_t GetCount() const;
+
+	// function(row, transform, collider, renderable) for every entity:
+	// players, master, enemies, then blocks.
+	template <typename Function>
+	void ForEach(Function function) const
+	{
+		Get<EntityType::player>().ForEach<Transform, Collider, Renderable>(function);
+		Get<EntityType::enemyMaster>().ForEach<Transform, Collider, Renderable>(function);
+		Get<EntityType::enemy>().ForEach<Transform, Collider, Renderable>(function);
+		Get<EntityType::block>().ForEach<Transform, Collider, Renderable>(function);
+	}
+
+	// Row of a player by number, -1 if there is none.
+	int FindPlayer(int player) const;
+
+	// Level snapshot: the archetypes as they were when the level was
+	// loaded. Restoring it is one bulk copy per table.
+	void SaveSnapshot();
+	void RestoreSnapshot();
+
+private:
+	Archetypes m_Archetypes;
+	Archetypes m_Snapshot;
+};
@@ -0,0 +1,84 @@
+#include "pch.h"
+#include "Formation.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Index of the lowest set bit; mask must not be 0.
+static int CountTrailingZeros(std::uint64_t mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, mask);
+	return static_cast<int>(index);
+#else
+	return __builtin_ctzll(mask);
+#endif
+}
+
+void Formation::Create(const LevelSet& levels)
+{
+	std::size_t columns = 0;
+	std::size_t cells = 0;
+	for (std::size_t i = 0; i < levels.GetCount(); i++)
+	{
+		const LevelDefinition& level = levels.Get(i);
+		columns = std::max(columns, static_cast<std::size_t>(level.m_columns));
+		cells = std::max(cells, level.m_grid.size());
+	}
+
+	m_alive.reserve(columns);
+	m_cells.reserve(cells);
+	m_enemyCells.assign(levels.GetMaxEnemies(), -1);
+}
+
+void Formation::Reset(const LevelDefinition& level)
+{
+	m_columns = level.m_columns;
+	m_rows = level.m_rows;
+	m_alive.assign(m_columns, 0);
+	m_cells.assign(m_columns * m_rows, -1);
+	std::fill(m_enemyCells.begin(), m_enemyCells.end(), -1);
+}
+
+void Formation::Place(std::size_t enemy, int column, int row)
+{
+	// Bottom row in bit 0
+	int cell = column * m_rows + (m_rows - 1 - row);
+	m_cells[cell] = static_cast<int>(enemy);
+	m_enemyCells[enemy] = cell;
+}
+
+void Formation::Rebuild(const ComponentTable<Collider>& enemies)
+{
+	std::fill(m_alive.begin(), m_alive.end(), 0);
+	for (std::size_t enemy = 0; enemy < m_enemyCells.size(); enemy++)
+	{
+		int cell = m_enemyCells[enemy];
+		if (cell >= 0 && enemies[enemy].m_enabled == true)
+		{
+			m_alive[cell / m_rows] |= std::uint64_t(1) << (cell % m_rows);
+		}
+	}
+}
+
+void Formation::Kill(std::size_t enemy)
+{
+	int cell = m_enemyCells[enemy];
+	if (cell >= 0)
+	{
+		m_alive[cell / m_rows] &= ~(std::uint64_t(1) << (cell % m_rows));
+	}
+}
+
+int Formation::GetShooter(int column) const
+{
+	std::uint64_t mask = m_alive[column];
+	if (mask == 0)
+	{
+		return -1;
+	}
+
+	return m_cells[column * m_rows + CountTrailingZeros(mask)];
+}
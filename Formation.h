@@ -0,0 +1,42 @@
+#pragma once
+#include "Level.h"
+#include "Entity.h"
+#include "Archetype.h"
+
+//
+// Which enemies of the wave are still alive, column by column, for the
+// firing rule of the original: only the bottom-most live enemy of a column
+// may shoot. Each column is a 64-bit mask with the bottom row in bit 0,
+// so the shooter of a column is one count-trailing-zeros away and picking
+// shooters costs O(columns) whatever the size of the wave.
+//
+// Derived state: it is rebuilt from the enemies after a level load, a
+// wave reset or a state load, and kept up to date on kills in between.
+//
+
+class Formation
+{
+public:
+	// Storage for the largest level of the set; nothing allocates later.
+	void Create(const LevelSet& levels);
+
+	// Empties the grid for a level; the enemies are then placed one by one.
+	void Reset(const LevelDefinition& level);
+	void Place(std::size_t enemy, int column, int row);
+
+	// Live masks from the enabled flags of the enemies.
+	void Rebuild(const ComponentTable<Collider>& enemies);
+	void Kill(std::size_t enemy);
+
+	int GetColumns() const { return m_columns; }
+
+	// Row of the bottom-most live enemy of a column, -1 when it is empty.
+	int GetShooter(int column) const;
+
+private:
+	int m_columns = 0;
+	int m_rows = 0;
+	std::vector<std::uint64_t> m_alive;		// per column
+	std::vector<int> m_cells;				// enemy of each cell, column by column, -1 if none
+	std::vector<int> m_enemyCells;			// cell of each enemy, -1 if unused this level
+};
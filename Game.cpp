@@ -1,121 +1,121 @@
 #include "pch.h"
 #include "StringHelpers.h"
 #include "Game.h"
-#include "EntityManager.h"
+#include "GameState.h"
+#include "Trace.h"
+#include "MemoryTracker.h"
 
-const float Game::PlayerSpeed = 100.f;
-const sf::Time Game::TimePerFrame = sf::seconds(1.f / 60.f);
+// One simulation tick per update.
+const sf::Time Game::TimePerFrame = sf::seconds(1.f / Simulation::TicksPerSecond);
 
-Game::Game()
-	: mWindow(sf::VideoMode(840, 600), "Space Invaders 1978", sf::Style::Close)
-	, mTexture()
-	, mPlayer()
+Game::Game(const GameSettings& settings)
+	: mWindow(settings.m_fullscreen ? sf::VideoMode::getDesktopMode() : sf::VideoMode(settings.m_windowWidth, settings.m_windowHeight),
+		"Space Invaders 1978", settings.m_fullscreen ? sf::Style::Fullscreen : sf::Style::Default)
 	, mFont()
 	, mStatisticsText()
 	, mStatisticsUpdateTime()
 	, mStatisticsNumFrames(0)
-	, mIsMovingUp(false)
-	, mIsMovingDown(false)
-	, mIsMovingRight(false)
-	, mIsMovingLeft(false)
+	, _Settings(settings)
 {
 	mWindow.setFramerateLimit(160);
 
-	_TextureWeapon.loadFromFile("Media/Textures/SI_WeaponGreen.png");
-	_TextureWeaponEnemy.loadFromFile("Media/Textures/SI_WeaponYellow.png");
-	_TextureWeaponEnemyMaster.loadFromFile("Media/Textures/SI_WeaponRed.png");
-	mTexture.loadFromFile("Media/Textures/SI_Player.png");
-	_TextureEnemyMaster.loadFromFile("Media/Textures/SI_EnemyMaster.png");
-	_TextureEnemy.loadFromFile("Media/Textures/SI_Enemy.png");
-	_TextureBlock.loadFromFile("Media/Textures/SI_Block.png");
-	mFont.loadFromFile("Media/Sansation.ttf");
+	// Falls back to the loose files under Media/ when there is no bundle.
+	_Assets.Open("Media.bundle");
 
+	_Assets.LoadTexture(_TextureWeapon, "Textures/SI_WeaponGreen.png");
+	_Assets.LoadTexture(_TextureWeaponEnemy, "Textures/SI_WeaponYellow.png");
+	_Assets.LoadTexture(_TextureWeaponEnemyMaster, "Textures/SI_WeaponRed.png");
+	_Assets.LoadImage(_ImagePlayer, "Textures/SI_Player.png");
+	_Assets.LoadImage(_ImageEnemyMaster, "Textures/SI_EnemyMaster.png");
+	_Assets.LoadImage(_ImageEnemy, "Textures/SI_Enemy.png");
+	_Assets.LoadImage(_ImageBlock, "Textures/SI_Block.png");
+	_Assets.LoadFont(mFont, "Sansation.ttf");
+	_Audio.Init(_AudioBackend, _Assets);
+
+	if (_Settings.m_netplay == true)
+	{
+		_Settings.m_players = 2;
+	}
+
+	_Levels.Load(_Assets, _Settings.m_levelFile);
+	_Particles.Create(65536);
+	InitRendering();
 	InitSprites();
-}
+	_IsReady = InitNetplay();
+	AccountTextures();
 
-void Game::ResetSprites()
-{
-	_IsGameOver = false;
-	_IsEnemyWeaponFired = false;
-	_IsPlayerWeaponFired = false;
-	_IsEnemyMasterWeaponFired = false;
+	if (_Settings.m_stateRecordFile.empty() == false)
+	{
+		_StateRecord.open(_Settings.m_stateRecordFile, std::ios::binary | std::ios::trunc);
+	}
+
+	if (_Settings.m_telemetryPort != 0)
+	{
+		_Telemetry.Start(_Settings.m_telemetryPort, _Sim);
+	}
+
+	if (_Settings.m_traceFile.empty() == false && Tracer::Start(_Settings.m_traceFile) == false)
+	{
+		_IsReady = false;
+	}
 
-	for (std::shared_ptr<Entity> entity : EntityManager::m_Entities)
+	if (_Settings.m_highScoreFile.empty() == false)
 	{
-		entity->m_enabled = true;
+		_HighScores.Open(_Settings.m_highScoreFile);
 	}
+
+	GameStateFile::InstallCrashHandler("crash.sav");
+}
+
+Game::~Game()
+{
+	// The published state lives in _CurrentState and _PreviousState.
+	GameStateFile::UninstallCrashHandler();
 }
 
 void Game::InitSprites()
 {
-	_lives = 3;
-	_score = 0;
-	_IsGameOver = false;
-	_IsEnemyWeaponFired = false;
-	_IsPlayerWeaponFired = false;
-	_IsEnemyMasterWeaponFired = false;
+	SimulationAssets assets;
+	assets.m_player = _ImagePlayer.getSize();
+	assets.m_enemy = _ImageEnemy.getSize();
+	assets.m_enemyMaster = _ImageEnemyMaster.getSize();
+	assets.m_weapon = _TextureWeapon.getSize();
+	assets.m_enemyWeapon = _TextureWeaponEnemy.getSize();
+	assets.m_enemyMasterWeapon = _TextureWeaponEnemyMaster.getSize();
+	assets.m_block = _ImageBlock;
+
+	_Sim.Init(_Settings, _Levels, assets);
 
 	//
-	// Player
+	// Players, enemies and master
 	//
 
-	mPlayer.setTexture(mTexture);
-	mPlayer.setPosition(100.f, 500.f);
-	std::shared_ptr<Entity> player = std::make_shared<Entity>();
-	player->m_sprite = mPlayer;
-	player->m_type = EntityType::player;
-	player->m_size = mTexture.getSize();
-	player->m_position = mPlayer.getPosition();
-	EntityManager::m_Entities.push_back(player);
+	// Two-frame march, as in the original
+	SpriteAtlas::MakeMarchFrame(_ImageEnemy, _ImageEnemyMarch);
 
-	//
-	// Enemy Master
-	//
+	std::fill(std::begin(_Animations), std::end(_Animations), -1);
+	_Animations[EntityType::player] = _Atlas.Add({ &_ImagePlayer }, 1);
+	_Animations[EntityType::enemy] = _Atlas.Add({ &_ImageEnemy, &_ImageEnemyMarch }, Simulation::TicksPerSecond / 3);
+	_Animations[EntityType::enemyMaster] = _Atlas.Add({ &_ImageEnemyMaster }, 1);
+	_Atlas.Build();
 
-	_EnemyMaster.setTexture(_TextureEnemyMaster);
-	_EnemyMaster.setPosition(100.f + 50.f, 1.f);
-	std::shared_ptr<Entity> sem = std::make_shared<Entity>();
-	sem->m_sprite = _EnemyMaster;
-	sem->m_type = EntityType::enemyMaster;
-	sem->m_size = _TextureEnemyMaster.getSize();
-	sem->m_position = _EnemyMaster.getPosition();
-	EntityManager::m_Entities.push_back(sem);
+	// Reserve the full vertex storage once; resize() in render() then never allocates.
+	_EntityVertices.setPrimitiveType(sf::Quads);
+	_EntityVertices.resize(_Sim.GetEntities().GetCount() * 4);
+	_EntityVertices.clear();
 
 	//
-	// Enemies
+	// Blocks, one texture per shield
 	//
 
-	for (int i = 0; i < SPRITE_COUNT_X; i++)
+	_ShieldTextures.resize(_Levels.GetMaxShields());
+	for (sf::Texture& texture : _ShieldTextures)
 	{
-		for (int j = 0; j < SPRITE_COUNT_Y; j++)
-		{
-			_Enemy[i][j].setTexture(_TextureEnemy);
-			_Enemy[i][j].setPosition(100.f + 50.f * (i + 1), 10.f + 50.f * (j + 1));
-
-			std::shared_ptr<Entity> se = std::make_shared<Entity>();
-			se->m_sprite = _Enemy[i][j];
-			se->m_type = EntityType::enemy;
-			se->m_size = _TextureEnemy.getSize();
-			se->m_position = _Enemy[i][j].getPosition();
-			EntityManager::m_Entities.push_back(se);
-		}
+		texture.create(_ImageBlock.getSize().x, _ImageBlock.getSize().y);
 	}
-
-	//
-	// Blocks
-	//
-
-	for (int i = 0; i < BLOCK_COUNT; i++)
+	if (_ShieldTextures.empty() == false)
 	{
-		_Block[i].setTexture(_TextureBlock);
-		_Block[i].setPosition(0.f + 150.f * (i + 1), 10 + 350.f);
-
-		std::shared_ptr<Entity> sb = std::make_shared<Entity>();
-		sb->m_sprite = _Block[i];
-		sb->m_type = EntityType::block;
-		sb->m_size = _TextureBlock.getSize();
-		sb->m_position = _Block[i].getPosition();
-		EntityManager::m_Entities.push_back(sb);
+		_SpriteBlock.setTexture(_ShieldTextures[0]);
 	}
 
 	mStatisticsText.setFont(mFont);
@@ -130,7 +130,6 @@ void Game::InitSprites()
 	_LivesText.setFont(mFont);
 	_LivesText.setPosition(10.f, 50.f);
 	_LivesText.setCharacterSize(20);
-	_LivesText.setString(std::to_string(_lives));
 
 	//
 	// Text
@@ -140,861 +139,611 @@ void Game::InitSprites()
 	_ScoreText.setFont(mFont);
 	_ScoreText.setPosition(10.f, 100.f);
 	_ScoreText.setCharacterSize(20);
-	_ScoreText.setString(std::to_string(_score));
+
+	HandleTexts();
 }
 
-void Game::run()
+// Scanlines, an aperture-grille mask and a vignette, at the logical
+// resolution so the cost does not depend on the window size.
+static const char* CrtShaderSource =
+	"uniform sampler2D texture;\n"
+	"uniform vec2 resolution;\n"
+	"void main()\n"
+	"{\n"
+	"	vec2 uv = gl_TexCoord[0].xy;\n"
+	"	vec3 color = texture2D(texture, uv).rgb;\n"
+	"	color *= 0.7 + 0.3 * mod(floor(uv.y * resolution.y), 2.0);\n"
+	"	float column = mod(floor(uv.x * resolution.x), 3.0);\n"
+	"	color *= vec3(column == 0.0 ? 1.0 : 0.85, column == 1.0 ? 1.0 : 0.85, column == 2.0 ? 1.0 : 0.85);\n"
+	"	vec2 centred = uv - 0.5;\n"
+	"	color *= 1.0 - dot(centred, centred) * 0.6;\n"
+	"	gl_FragColor = vec4(color, 1.0);\n"
+	"}\n";
+
+void Game::InitRendering()
 {
-	sf::Clock clock;
-	sf::Time timeSinceLastUpdate = sf::Time::Zero;
-	while (mWindow.isOpen())
+	unsigned width = static_cast<unsigned>(Simulation::FieldWidth);
+	unsigned height = static_cast<unsigned>(Simulation::FieldHeight);
+	_Playfield.create(width, height);
+
+	if (_Settings.m_crt == true)
 	{
-		sf::Time elapsedTime = clock.restart();
-		timeSinceLastUpdate += elapsedTime;
-		while (timeSinceLastUpdate > TimePerFrame)
-		{
-			timeSinceLastUpdate -= TimePerFrame;
+		_IsCrtEnabled = sf::Shader::isAvailable() == true &&
+			_CrtShader.loadFromMemory(CrtShaderSource, sf::Shader::Fragment) == true &&
+			_PostProcess.create(width, height) == true;
 
-			processEvents();
-			update(TimePerFrame);
+		if (_IsCrtEnabled == false)
+		{
+			std::cerr << "CRT shader not available, drawing without it" << std::endl;
 		}
-
-		updateStatistics(elapsedTime);
-		render();
-	}
-}
-
-void Game::processEvents()
-{
-	sf::Event event;
-	while (mWindow.pollEvent(event))
-	{
-		switch (event.type)
+		else
 		{
-		case sf::Event::KeyPressed:
-			handlePlayerInput(event.key.code, true);
-			break;
-
-		case sf::Event::KeyReleased:
-			handlePlayerInput(event.key.code, false);
-			break;
-
-		case sf::Event::Closed:
-			mWindow.close();
-			break;
+			_CrtShader.setUniform("texture", sf::Shader::CurrentTexture);
+			_CrtShader.setUniform("resolution", sf::Glsl::Vec2(Simulation::FieldWidth, Simulation::FieldHeight));
 		}
 	}
+
+	UpdateView();
 }
 
-void Game::update(sf::Time elapsedTime)
+// SFML and the driver own the pixels; they are accounted by size, at 32
+// bits a pixel.
+static std::size_t GetPixelBytes(const sf::Vector2u& size)
 {
-	sf::Vector2f movement(0.f, 0.f);
-	if (mIsMovingUp)
-		movement.y -= PlayerSpeed;
-	if (mIsMovingDown)
-		movement.y += PlayerSpeed;
-	if (mIsMovingLeft)
-		movement.x -= PlayerSpeed;
-	if (mIsMovingRight)
-		movement.x += PlayerSpeed;
-
-	for (std::shared_ptr<Entity> entity : EntityManager::m_Entities)
-	{
-		if (entity->m_enabled == false)
-		{
-			continue;
-		}
+	return static_cast<std::size_t>(size.x) * size.y * 4;
+}
 
-		if (entity->m_type != EntityType::player)
+void Game::AccountTextures()
+{
+	// Created once, kept for the whole game
+	const sf::Texture* textures[] = { &_TextureWeapon, &_TextureWeaponEnemy, &_TextureWeaponEnemyMaster, &_Atlas.GetTexture(),
+		&_Playfield.getTexture(), &_PostProcess.getTexture() };
+	for (const sf::Texture* texture : textures)
+	{
+		if (texture->getSize().x > 0)
 		{
-			continue;
+			MemoryTracker::Allocate(memoryTextures, GetPixelBytes(texture->getSize()));
 		}
+	}
+	for (const sf::Texture& texture : _ShieldTextures)
+	{
+		MemoryTracker::Allocate(memoryTextures, GetPixelBytes(texture.getSize()));
+	}
 
-		entity->m_sprite.move(movement * elapsedTime.asSeconds());
+	// The images the atlas and the shields are made from stay in memory too.
+	const sf::Image* images[] = { &_ImagePlayer, &_ImageEnemy, &_ImageEnemyMarch, &_ImageEnemyMaster, &_ImageBlock };
+	for (const sf::Image* image : images)
+	{
+		MemoryTracker::Allocate(memoryTextures, GetPixelBytes(image->getSize()));
 	}
 }
 
-void Game::render()
+void Game::AccountHud()
 {
-	mWindow.clear();
-
-	for (std::shared_ptr<Entity> entity : EntityManager::m_Entities)
+	// The glyph pages of the font, one per character size in use; they
+	// grow as new characters show up.
+	static const unsigned CharacterSizes[] = { 10, 20, 80 };
+	std::size_t bytes = 0;
+	for (unsigned size : CharacterSizes)
 	{
-		if (entity->m_enabled == false)
-		{
-			continue;
-		}
-
-		mWindow.draw(entity->m_sprite);
+		bytes += GetPixelBytes(mFont.getTexture(size).getSize());
 	}
-
-	mWindow.draw(mStatisticsText);
-	mWindow.draw(mText);
-	mWindow.draw(_LivesText);
-	mWindow.draw(_ScoreText);
-	mWindow.display();
+	MemoryTracker::SetCurrent(memoryHud, bytes);
 }
 
-void Game::updateStatistics(sf::Time elapsedTime)
+void Game::UpdateView()
 {
-	mStatisticsUpdateTime += elapsedTime;
-	mStatisticsNumFrames += 1;
+	// Largest rectangle of the playfield's aspect ratio, centred in the window
+	sf::Vector2u size = mWindow.getSize();
+	float windowRatio = static_cast<float>(size.x) / std::max(size.y, 1u);
+	float fieldRatio = Simulation::FieldWidth / Simulation::FieldHeight;
 
-	if (mStatisticsUpdateTime >= sf::seconds(1.0f))
+	sf::FloatRect viewport(0.f, 0.f, 1.f, 1.f);
+	if (windowRatio > fieldRatio)
 	{
-		mStatisticsText.setString(
-			"Frames / Second = " + toString(mStatisticsNumFrames) + "\n" +
-			"Time / Update = " + toString(mStatisticsUpdateTime.asMicroseconds() / mStatisticsNumFrames) + "us");
-
-		mStatisticsUpdateTime -= sf::seconds(1.0f);
-		mStatisticsNumFrames = 0;
+		viewport.width = fieldRatio / windowRatio;
+		viewport.left = (1.f - viewport.width) / 2.f;
 	}
-
-	//
-	// Handle collisions
-	//
-
-	if (mStatisticsUpdateTime >= sf::seconds(0.050f))
+	else
 	{
-		if (_IsGameOver == true)
-			return;
-
-		HandleTexts();
-		HandleGameOver();
-		HandleCollisionWeaponEnemy();
-		HandleCollisionWeaponPlayer();
-		HandleCollisionWeaponBlock();
-		HandleCollisionEnemyWeaponBlock();
-		HandleCollisionEnemyMasterWeaponBlock();
-		HandleCollisionEnemyMasterWeaponPlayer();
-		HandleCollisionBlockEnemy();
-		HandleCollisionWeaponEnemyMaster();
-		HanldeWeaponMoves();
-		HanldeEnemyWeaponMoves();
-		HanldeEnemyMasterWeaponMoves();
-		HandleEnemyMoves();
-		HandleEnemyMasterMove();
-		HandleEnemyWeaponFiring();
-		HandleEnemyMasterWeaponFiring();
+		viewport.height = windowRatio / fieldRatio;
+		viewport.top = (1.f - viewport.height) / 2.f;
 	}
-}
 
-void Game::HandleTexts()
-{
-	std::string lives = "Lives: " + std::to_string(_lives);
-	_LivesText.setString(lives);
-	std::string score = "Score: " + std::to_string(_score);
-	_ScoreText.setString(score);
-	return;
+	_OutputView.reset(sf::FloatRect(0.f, 0.f, Simulation::FieldWidth, Simulation::FieldHeight));
+	_OutputView.setViewport(viewport);
+	mWindow.setView(_OutputView);
 }
 
-void Game::HandleCollisionEnemyMasterWeaponPlayer()
+bool Game::InitNetplay()
 {
-	for (std::shared_ptr<Entity> weapon : EntityManager::m_Entities)
+	if (_Settings.m_netplay == false)
 	{
-		if (weapon->m_enabled == false)
-		{
-			continue;
-		}
-
-		if (weapon->m_type != EntityType::enemyMasterWeapon)
-		{
-			continue;
-		}
-
-		sf::FloatRect boundWeapon;
-		boundWeapon = weapon->m_sprite.getGlobalBounds();
-
-		sf::FloatRect boundPlayer;
-		boundPlayer = EntityManager::GetPlayer()->m_sprite.getGlobalBounds();
+		return true;
+	}
 
-		if (boundWeapon.intersects(boundPlayer) == true)
-		{
-			weapon->m_enabled = false;
-			_IsEnemyMasterWeaponFired = false; 
-			_lives--;
-			//break;
-			goto end;
-		}
+	_Transport.reset(new UdpTransport());
+	if (_Transport->Bind(_Settings.m_localPort) == false)
+	{
+		_Transport.reset();
+		return false;
+	}
+	if (_Settings.m_remoteAddress.empty() == false)
+	{
+		_Transport->SetRemote(sf::IpAddress(_Settings.m_remoteAddress), _Settings.m_remotePort);
 	}
 
-end:
-	//nop
-	return;
+	_Session.reset(new RollbackSession(_Sim, *_Transport, _Settings.m_localPlayer, _Settings.m_inputDelay));
+	return true;
 }
 
-void Game::HanldeEnemyMasterWeaponMoves()
+bool Game::run()
 {
-	for (std::shared_ptr<Entity> entity : EntityManager::m_Entities)
+	if (_IsReady == false)
 	{
-		if (entity->m_enabled == false)
-		{
-			continue;
-		}
-
-		if (entity->m_type != EntityType::enemyMasterWeapon)
-		{
-			continue;
-		}
-
-		float x, y;
-		x = entity->m_sprite.getPosition().x;
-		y = entity->m_sprite.getPosition().y;
-		y++;
-
-		if (y >= 600)
-		{
-			entity->m_enabled = false;
-			_IsEnemyMasterWeaponFired = false;
-		}
-
-		entity->m_sprite.setPosition(x, y);
+		return false;
 	}
-}
-
-void Game::HandleEnemyMasterWeaponFiring()
-{
-	if (_IsEnemyMasterWeaponFired == true)
-		return;
 
-	if (EntityManager::GetEnemyMaster()->m_enabled == false)
-		return;
-
-	// a little random...
-	int r = rand() % 50;
-	if (r != 10)
-		return;
-
-	float x, y;
-	x = EntityManager::GetEnemyMaster()->m_sprite.getPosition().x;
-	y = EntityManager::GetEnemyMaster()->m_sprite.getPosition().y;
-	y--;
-
-	std::shared_ptr<Entity> sw = std::make_shared<Entity>();
-	sw->m_sprite.setTexture(_TextureWeaponEnemyMaster);
-
-	sw->m_sprite.setPosition(
-		x + _TextureEnemyMaster.getSize().x / 2,
-		y + _TextureEnemyMaster.getSize().y);
-	sw->m_type = EntityType::enemyMasterWeapon;
-	sw->m_size = _TextureWeaponEnemyMaster.getSize();
-	EntityManager::m_Entities.push_back(sw);
+	if (_Settings.m_latencyReport == true)
+	{
+		_Latency.Start();
+	}
 
-	_IsEnemyMasterWeaponFired = true;
-}
+	_Clock.restart();
+	sf::Time lastFrame = sf::Time::Zero;
+	sf::Time nextTick = TimePerFrame;
 
-void Game::HandleCollisionEnemyMasterWeaponBlock()
-{
-	for (std::shared_ptr<Entity> weapon : EntityManager::m_Entities)
+	TRACE_THREAD("Game");
+	while (mWindow.isOpen())
 	{
-		if (weapon->m_enabled == false)
-		{
-			continue;
-		}
+		TRACE_ZONE("Game::run");
+		sf::Time now = _Clock.getElapsedTime();
+		sf::Time elapsedTime = now - lastFrame;
+		lastFrame = now;
 
-		if (weapon->m_type != EntityType::enemyMasterWeapon)
-		{
-			continue;
-		}
+		processEvents();
 
-		for (std::shared_ptr<Entity> block : EntityManager::m_Entities)
+		// A tick is due once its period is over, and takes the commands
+		// polled before the next one is due: whatever was polled this frame
+		// goes to the last tick of the frame.
+		while (now > nextTick)
 		{
-			if (block->m_type != EntityType::block)
-			{
-				continue;
-			}
-
-			if (block->m_enabled == false)
-			{
-				continue;
-			}
+			nextTick += TimePerFrame;
+			update(nextTick);
+		}
 
-			sf::FloatRect boundWeapon;
-			boundWeapon = weapon->m_sprite.getGlobalBounds();
+		updateStatistics(elapsedTime);
+		_Particles.Update(elapsedTime.asSeconds());
+		render();
+		_Latency.OnFrame();
+	}
 
-			sf::FloatRect boundBlock;
-			boundBlock = block->m_sprite.getGlobalBounds();
+	if (_Latency.IsRunning() == true)
+	{
+		_Latency.Report(std::cout);
+	}
 
-			if (boundWeapon.intersects(boundBlock) == true)
-			{
-				weapon->m_enabled = false;
-				_IsEnemyMasterWeaponFired = false;
-				//break;
-				goto end2;
-			}
-		}
+	if (_Settings.m_memoryReport == true)
+	{
+		MemoryTracker::Report(std::cout);
 	}
 
-end2:
-	//nop
-	return;
+	Tracer::Stop();
+	return true;
 }
 
-void Game::HandleEnemyMasterMove()
+void Game::processEvents()
 {
-	for (std::shared_ptr<Entity> entity : EntityManager::m_Entities)
+	TRACE_ZONE("Game::processEvents");
+	sf::Event event;
+	while (mWindow.pollEvent(event))
 	{
-		if (entity->m_enabled == false)
-		{
-			continue;
-		}
-
-		if (entity->m_type != EntityType::enemyMaster)
+		switch (event.type)
 		{
-			continue;
-		}
-
-		float x, y;
-		x = entity->m_sprite.getPosition().x;
-		y = entity->m_sprite.getPosition().y;
+		case sf::Event::KeyPressed:
+			handlePlayerInput(event.key.code, true);
+			break;
 
-		if (entity->m_bLeftToRight == true)
-			x = x + 0.5f;
-		else
-			x = x - 0.5f;
+		case sf::Event::KeyReleased:
+			handlePlayerInput(event.key.code, false);
+			break;
 
-		entity->m_times++;
+		case sf::Event::Resized:
+			UpdateView();
+			break;
 
-		if (x >= ((BLOCK_COUNT) * 150) || x <= 150)
-		{
-			if (entity->m_bLeftToRight == true)
-			{
-				entity->m_bLeftToRight = false;
-				entity->m_times = 0;
-			}
-			else
-			{
-				entity->m_bLeftToRight = true;
-				entity->m_times = 0;
-			}
+		case sf::Event::Closed:
+			mWindow.close();
+			break;
 		}
-
-		entity->m_sprite.setPosition(x, y);
 	}
 }
 
-void Game::HandleCollisionEnemyWeaponBlock()
+void Game::update(sf::Time deadline)
 {
-	for (std::shared_ptr<Entity> weapon : EntityManager::m_Entities)
-	{
-		if (weapon->m_enabled == false)
-		{
-			continue;
-		}
-
-		if (weapon->m_type != EntityType::enemyWeapon)
-		{
-			continue;
-		}
-
-		for (std::shared_ptr<Entity> block : EntityManager::m_Entities)
-		{
-			if (block->m_type != EntityType::block)
-			{
-				continue;
-			}
-
-			if (block->m_enabled == false)
-			{
-				continue;
-			}
-
-			sf::FloatRect boundWeapon;
-			boundWeapon = weapon->m_sprite.getGlobalBounds();
-
-			sf::FloatRect boundBlock;
-			boundBlock = block->m_sprite.getGlobalBounds();
+	TRACE_ZONE("Game::update");
+	_AppliedCommands += _InputQueue.Apply(deadline.asMicroseconds(), _Input);
+	PlayerInput input = _Input;
 
-			if (boundWeapon.intersects(boundBlock) == true)
-			{
-				weapon->m_enabled = false;
-				_IsEnemyWeaponFired = false;
-				//break;
-				goto end2;
-			}
-		}
+	if (_Settings.m_bot == true)
+	{
+		BotEnvironment::Observe(_Sim, _BotObservation, _BotBullets);
+		input = BotEnvironment::ScriptedPolicy(_BotObservation);
 	}
 
-end2:
-	//nop
-	return;
-}
-
-void Game::HandleCollisionWeaponPlayer()
-{
-	for (std::shared_ptr<Entity> weapon : EntityManager::m_Entities)
+	if (_Session)
 	{
-		if (weapon->m_enabled == false)
+		// Keeps running after a game over: a rollback may still undo it.
+		if (_Session->Advance(input) == false)
 		{
-			continue;
-		}
-
-		if (weapon->m_type != EntityType::enemyWeapon)
-		{
-			continue;
+			// Waiting for the other player; the press is kept for the next tick.
+			return;
 		}
+	}
+	else
+	{
+		if (_Sim.IsGameOver() == true)
+			return;
 
-		sf::FloatRect boundWeapon;
-		boundWeapon = weapon->m_sprite.getGlobalBounds();
+		PlayerInput inputs[MAX_PLAYERS];
+		inputs[0] = input;
+		_Sim.Step(inputs);
+	}
 
-		sf::FloatRect boundPlayer;
-		boundPlayer = EntityManager::GetPlayer()->m_sprite.getGlobalBounds();
+	_Input.m_buttons &= ~PlayerInput::Fire;
+	_Latency.OnTick(_AppliedCommands);
+	_AppliedCommands = 0;
+	_Atlas.Advance();
+	CaptureState();
+	_Telemetry.Publish(_Sim);
+	_Audio.Update(_Sim);
+	SpawnParticles();
+
+	// Rollbacks can change the score without an event of this tick.
+	if (_Sim.GetEvents().GetCount() > 0 || _Sim.IsGameOver() == true || _Session)
+	{
+		_IsHudDirty = true;
+	}
 
-		if (boundWeapon.intersects(boundPlayer) == true)
+	// A rollback may undo the game over, and with it the tick it happened at.
+	if (_Sim.IsGameOver() == false)
+	{
+		_GameOverTick = 0;
+	}
+	else if (_IsScoreSubmitted == false)
+	{
+		if (_GameOverTick == 0)
 		{
-			weapon->m_enabled = false;
-			_IsEnemyWeaponFired = false;
-			_lives--;
-			goto end;
+			_GameOverTick = _Sim.GetTick();
 		}
+		SubmitScores();
 	}
-
-end:
-	//nop
-	return;
 }
 
-void Game::HanldeEnemyWeaponMoves()
+void Game::render()
 {
-	for (std::shared_ptr<Entity> entity : EntityManager::m_Entities)
+	TRACE_ZONE("Game::render");
+	for (std::size_t i = 0; i < _Sim.GetShieldCount(); i++)
 	{
-		if (entity->m_enabled == false)
-		{
-			continue;
-		}
+		_Sim.GetShield(i).Upload(_ShieldTextures[i]);
+	}
 
-		if (entity->m_type != EntityType::enemyWeapon)
-		{
-			continue;
-		}
+	_Playfield.clear();
 
-		float x, y;
-		x = entity->m_sprite.getPosition().x;
-		y = entity->m_sprite.getPosition().y;
-		y += 1.0f;
+	const EntityManager& entities = _Sim.GetEntities();
+	_EntityVertices.resize(entities.GetCount() * 4);
+	std::size_t quads = 0;
 
-		if (y >= 600)
-		{
-			entity->m_enabled = false;
-			_IsEnemyWeaponFired = false;
-		}
-		else
+	entities.ForEach([this, &quads](std::size_t, const Transform& transform, const Collider& collider, const Renderable& renderable) {
+		if (collider.m_enabled == false)
 		{
-			entity->m_sprite.setPosition(x, y);
+			return;
 		}
-	}
-}
-
-void Game::HandleEnemyWeaponFiring()
-{
-	if (_IsEnemyWeaponFired == true)
-		return;
 
-	std::vector<std::shared_ptr<Entity>>::reverse_iterator rit = EntityManager::m_Entities.rbegin();
-	for (; rit != EntityManager::m_Entities.rend(); rit++)
-	{
-		std::shared_ptr<Entity> entity = *rit;
-
-		if (entity->m_enabled == false)
+		sf::Color color = sf::Color::White;
+		switch (renderable.m_type)
 		{
-			continue;
+		case EntityType::player:
+			color = renderable.m_index == 0 ? sf::Color::White : sf::Color(120, 200, 255);
+			break;
+		case EntityType::enemy:
+			color = _Levels.GetEnemyType(static_cast<unsigned char>(renderable.m_index)).m_color;
+			break;
+		case EntityType::block:
+			_SpriteBlock.setTexture(_ShieldTextures[renderable.m_index]);
+			_SpriteBlock.setPosition(transform.m_position);
+			_Playfield.draw(_SpriteBlock);
+			return;
+		default:
+			break;
 		}
 
-		if (entity->m_type != EntityType::enemy)
+		int animation = _Animations[renderable.m_type];
+		if (animation >= 0)
 		{
-			continue;
+			_Atlas.WriteQuad(&_EntityVertices[quads * 4], animation, transform.m_position, color);
+			quads++;
 		}
+	});
 
-		// a little random...
-		int r = rand() % 20;
-		if (r != 10)
-			continue;
-
-		float x, y;
-		x = entity->m_sprite.getPosition().x;
-		y = entity->m_sprite.getPosition().y;
-		y--;
+	_EntityVertices.resize(quads * 4);
+	_Playfield.draw(_EntityVertices, sf::RenderStates(&_Atlas.GetTexture()));
 
-		std::shared_ptr<Entity> sw = std::make_shared<Entity>();
-		sw->m_sprite.setTexture(_TextureWeaponEnemy);
-		sw->m_sprite.setPosition(
-			x + _TextureWeaponEnemy.getSize().x / 2,
-			y + _TextureWeaponEnemy.getSize().y);
+	_Sim.GetPlayerWeapons().Draw(_Playfield, _TextureWeapon);
+	_Sim.GetEnemyWeapons().Draw(_Playfield, _TextureWeaponEnemy);
+	_Sim.GetEnemyMasterWeapons().Draw(_Playfield, _TextureWeaponEnemyMaster);
+	_Particles.Draw(_Playfield, 2.f);
 
-		sw->m_sprite.setPosition(
-			entity->m_sprite.getPosition().x + _TextureEnemy.getSize().x / 2,
-			entity->m_sprite.getPosition().y - 10);
+	_Playfield.draw(mStatisticsText);
+	_Playfield.draw(mText);
+	_Playfield.draw(_RankText);
+	_Playfield.draw(_LivesText);
+	_Playfield.draw(_ScoreText);
+	_Playfield.display();
 
-		sw->m_type = EntityType::enemyWeapon;
-		sw->m_size = _TextureWeaponEnemy.getSize();
-		EntityManager::m_Entities.push_back(sw);
+	//
+	// Post-process and scale to the window
+	//
 
-		_IsEnemyWeaponFired = true;
-		break;
+	const sf::Texture* output = &_Playfield.getTexture();
+	if (_IsCrtEnabled == true)
+	{
+		_PostProcess.clear();
+		_PostProcess.draw(sf::Sprite(*output), &_CrtShader);
+		_PostProcess.display();
+		output = &_PostProcess.getTexture();
 	}
+
+	mWindow.clear();
+	mWindow.draw(sf::Sprite(*output));
+	mWindow.display();
 }
 
-void Game::HandleCollisionBlockEnemy()
+void Game::updateStatistics(sf::Time elapsedTime)
 {
-	// Handle collision ennemy blocks
+	TRACE_ZONE("Game::updateStatistics");
+	mStatisticsUpdateTime += elapsedTime;
+	mStatisticsNumFrames += 1;
 
-	for (std::shared_ptr<Entity> enemy : EntityManager::m_Entities)
+	if (mStatisticsUpdateTime >= sf::seconds(1.0f))
 	{
-		if (enemy->m_enabled == false)
+		std::size_t projectiles = _Sim.GetPlayerWeapons().GetCount() + _Sim.GetEnemyWeapons().GetCount() + _Sim.GetEnemyMasterWeapons().GetCount();
+		std::string statistics =
+			"Frames / Second = " + toString(mStatisticsNumFrames) + "\n" +
+			"Time / Update = " + toString(mStatisticsUpdateTime.asMicroseconds() / mStatisticsNumFrames) + "us\n" +
+			"Projectiles = " + toString(projectiles) + "\n" +
+			"Particles = " + toString(_Particles.GetCount()) + "\n" +
+			"State = " + toString(_CurrentState.size()) + " bytes / " + toString(_StateSaveTime.asMicroseconds()) + "us";
+
+		if (_Session)
 		{
-			continue;
+			statistics += "\nRollbacks = " + toString(_Session->GetRollbacks()) + " / " + toString(_Session->GetResimulatedTicks()) + " ticks" +
+				"\nStalls = " + toString(_Session->GetStalls()) + ", resyncs = " + toString(_Session->GetResyncs());
 		}
 
-		if (enemy->m_type != EntityType::enemy)
+		if (_Telemetry.IsRunning() == true)
 		{
-			continue;
+			statistics += "\nTelemetry dropped = " + toString(_Telemetry.GetDropped());
 		}
 
-		for (std::shared_ptr<Entity> block : EntityManager::m_Entities)
+		AccountHud();
+		for (int tag = 0; tag < memoryTagCount; tag++)
 		{
-			if (block->m_type != EntityType::block)
-			{
-				continue;
-			}
-
-			if (block->m_enabled == false)
-			{
-				continue;
-			}
-
-			sf::FloatRect boundEnemy;
-			boundEnemy = enemy->m_sprite.getGlobalBounds();
+			MemoryTag memoryTag = static_cast<MemoryTag>(tag);
+			statistics += std::string("\nMemory ") + MemoryTracker::GetName(memoryTag) + " = " + toString(MemoryTracker::GetCurrent(memoryTag) / 1024) +
+				" / " + toString(MemoryTracker::GetPeak(memoryTag) / 1024) + " KiB, " + toString(MemoryTracker::GetAllocations(memoryTag)) + " allocations" +
+				(MemoryTracker::IsOverBudget(memoryTag) ? ", over budget" : "");
+		}
 
-			sf::FloatRect boundBlock;
-			boundBlock = block->m_sprite.getGlobalBounds();
+		mStatisticsText.setString(statistics);
 
-			if (boundEnemy.intersects(boundBlock) == true)
-			{
-				EntityManager::GetPlayer()->m_enabled = false;
-				goto end3;
-			}
-		}
+		mStatisticsUpdateTime -= sf::seconds(1.0f);
+		mStatisticsNumFrames = 0;
 	}
 
-end3:
-	//nop
-	return;
+	if (_IsHudDirty == true)
+	{
+		HandleTexts();
+		_IsHudDirty = false;
+	}
 }
 
-void Game::HandleEnemyMoves()
+void Game::HandleTexts()
 {
-	//
-	// Handle Enemy moves
-	//
-
-	for (std::shared_ptr<Entity> entity : EntityManager::m_Entities)
+	TRACE_ZONE("Game::HandleTexts");
+	std::string lives = "Lives: " + std::to_string(_Sim.GetLives(0));
+	std::string score = "Score: " + std::to_string(_Sim.GetScore(0));
+	if (_Sim.GetPlayerCount() > 1)
 	{
-		if (entity->m_enabled == false)
-		{
-			continue;
-		}
-
-		if (entity->m_type != EntityType::enemy)
-		{
-			continue;
-		}
-
-		float x, y;
-		x = entity->m_sprite.getPosition().x;
-		y = entity->m_sprite.getPosition().y;
-
-		if (entity->m_bLeftToRight == true)
-			x++;
-		else
-			x--;
-		entity->m_times++;
-
-		if (entity->m_times >= 100) //0)
-		{
-			if (entity->m_bLeftToRight == true)
-			{
-				entity->m_bLeftToRight = false;
-				entity->m_times = 0;
-			}
-			else
-			{
-				entity->m_bLeftToRight = true;
-				entity->m_times = 0;
-				y += 1;
-			}
-		}
+		lives += " / " + std::to_string(_Sim.GetLives(1));
+		score += " / " + std::to_string(_Sim.GetScore(1));
+	}
+	_LivesText.setString(lives);
+	_ScoreText.setString(score);
 
-		entity->m_sprite.setPosition(x, y);
+	if (_Sim.IsGameOver() == true)
+	{
+		DisplayGameOver();
+	}
+	else
+	{
+		mText.setString("");
+		_RankText.setString("");
 	}
 }
 
-void Game::HanldeWeaponMoves()
+void Game::SubmitScores()
 {
-	//
-	// Handle Weapon moves
-	//
+	// Until the remote inputs up to the game over are in, a rollback may
+	// still undo it. The session goes on ticking after it, so only those count.
+	if (_Session && _Session->GetConfirmedTick() < _GameOverTick)
+	{
+		return;
+	}
 
-	for (std::shared_ptr<Entity> entity : EntityManager::m_Entities)
+	_IsScoreSubmitted = true;
+	if (_HighScores.IsOpen() == false || _Settings.m_bot == true)
 	{
-		if (entity->m_enabled == false)
-		{
-			continue;
-		}
+		return;
+	}
 
-		if (entity->m_type != EntityType::weapon)
+	// Netplay peers enter their own player only.
+	for (int i = 0; i < _Sim.GetPlayerCount(); i++)
+	{
+		if (_Session && i != _Settings.m_localPlayer)
 		{
 			continue;
 		}
-
-		float x, y;
-		x = entity->m_sprite.getPosition().x;
-		y = entity->m_sprite.getPosition().y;
-		y--;
-
-		if (y <= 0)
-		{
-			entity->m_enabled = false;
-			_IsPlayerWeaponFired = false;
-		}
-
-		entity->m_sprite.setPosition(x, y);
+		_Ranks[i] = _HighScores.Submit(_Sim.GetScore(i), _Sim.GetLevel());
 	}
+	_IsHudDirty = true;
 }
 
-void Game::HandleCollisionWeaponBlock()
+void Game::CaptureState()
 {
-	// Handle collision weapon blocks
+	sf::Clock clock;
+	// The state being written is not the one the crash handler holds.
+	_PreviousState.swap(_CurrentState);
+	_Sim.SaveState(_CurrentState);
+	GameStateFile::PublishCrashState(_CurrentState);
+	_StateSaveTime = clock.getElapsedTime();
 
-	for (std::shared_ptr<Entity> weapon : EntityManager::m_Entities)
+	if (_StateRecord.is_open() == false)
 	{
-		if (weapon->m_enabled == false)
-		{
-			continue;
-		}
-
-		if (weapon->m_type != EntityType::weapon)
-		{
-			continue;
-		}
-
-		for (std::shared_ptr<Entity> block : EntityManager::m_Entities)
-		{
-			if (block->m_type != EntityType::block)
-			{
-				continue;
-			}
-
-			if (block->m_enabled == false)
-			{
-				continue;
-			}
-
-			sf::FloatRect boundWeapon;
-			boundWeapon = weapon->m_sprite.getGlobalBounds();
-
-			sf::FloatRect boundBlock;
-			boundBlock = block->m_sprite.getGlobalBounds();
+		return;
+	}
 
-			if (boundWeapon.intersects(boundBlock) == true)
-			{
-				weapon->m_enabled = false;
-				_IsPlayerWeaponFired = false;
-				//break;
-				goto end2;
-			}
-		}
+	// Record: kind ('K' full state, 'D' delta from the previous record), size, bytes
+	const std::vector<unsigned char>* record = &_CurrentState;
+	char kind = 'K';
+	if (_Sim.GetTick() % 60 != 0 && _PreviousState.empty() == false)
+	{
+		GameStateFile::EncodeDelta(_PreviousState, _CurrentState, _StateDelta);
+		record = &_StateDelta;
+		kind = 'D';
 	}
 
-end2:
-	//nop
-	return;
+	std::uint32_t size = static_cast<std::uint32_t>(record->size());
+	_StateRecord.write(&kind, 1);
+	_StateRecord.write(reinterpret_cast<const char*>(&size), sizeof(size));
+	_StateRecord.write(reinterpret_cast<const char*>(record->data()), size);
 }
 
-void Game::HandleCollisionWeaponEnemy()
+void Game::SpawnParticles()
 {
-	// Handle collision weapon enemies
-
-	for (std::shared_ptr<Entity> weapon : EntityManager::m_Entities)
+	// Explosions where the kills and hits of the tick happened, debris off the shields
+	const EntityManager& entities = _Sim.GetEntities();
+	for (const GameEvent& event : _Sim.GetEvents())
 	{
-		if (weapon->m_enabled == false)
+		switch (event.m_type)
 		{
-			continue;
+		case GameEventType::enemyKilled:
+		{
+			const EnemyArchetype& enemies = entities.Get<EntityType::enemy>();
+			sf::Vector2f centre = event.m_position + sf::Vector2f(enemies.Get<Collider>()[event.m_target].m_size) / 2.f;
+			int type = enemies.Get<Renderable>()[event.m_target].m_index;
+			_Particles.Burst(centre, 48, 120.f, 0.8f, _Levels.GetEnemyType(static_cast<unsigned char>(type)).m_color);
+			break;
 		}
-
-		if (weapon->m_type != EntityType::weapon)
+		case GameEventType::enemyMasterKilled:
 		{
-			continue;
+			const EnemyArchetype& master = entities.Get<EntityType::enemyMaster>();
+			_Particles.Burst(event.m_position + sf::Vector2f(master.Get<Collider>()[event.m_target].m_size) / 2.f, 128, 160.f, 1.2f, sf::Color::Red);
+			break;
 		}
-
-		for (std::shared_ptr<Entity> enemy : EntityManager::m_Entities)
+		case GameEventType::playerHit:
 		{
-			if (enemy->m_type != EntityType::enemy)
-			{
-				continue;
-			}
-
-			if (enemy->m_enabled == false)
-			{
-				continue;
-			}
-
-			sf::FloatRect boundWeapon;
-			boundWeapon = weapon->m_sprite.getGlobalBounds();
-
-			sf::FloatRect boundEnemy;
-			boundEnemy = enemy->m_sprite.getGlobalBounds();
-
-			if (boundWeapon.intersects(boundEnemy) == true)
-			{
-				enemy->m_enabled = false;
-				weapon->m_enabled = false;
-				_IsPlayerWeaponFired = false;
-				_score += 10;
-				//break;
-				goto end;
-			}
+			const BasicArchetype& players = entities.Get<EntityType::player>();
+			_Particles.Burst(event.m_position + sf::Vector2f(players.Get<Collider>()[event.m_target].m_size) / 2.f, 64, 100.f, 1.f, sf::Color::Green);
+			break;
+		}
+		case GameEventType::shieldHit:
+			_Particles.Burst(_Sim.GetShield(event.m_target).GetPosition() + event.m_position, 6, 60.f, 0.5f, sf::Color(120, 255, 120));
+			break;
+		default:
+			break;
 		}
 	}
-
-end:
-	//nop
-	return;
 }
 
-void Game::HandleCollisionWeaponEnemyMaster()
+void Game::DisplayGameOver()
 {
-	// Handle collision weapon master enemy
+	mText.setFillColor(sf::Color::Green);
+	mText.setFont(mFont);
+	mText.setPosition(200.f, 200.f);
+	mText.setCharacterSize(80);
 
-	for (std::shared_ptr<Entity> weapon : EntityManager::m_Entities)
-	{
-		if (weapon->m_enabled == false)
-		{
-			continue;
-		}
+	mText.setString("GAME OVER");
 
-		if (weapon->m_type != EntityType::weapon)
+	std::string ranks;
+	for (int i = 0; i < _Sim.GetPlayerCount(); i++)
+	{
+		if (_Ranks[i] == 0)
 		{
 			continue;
 		}
-
-		for (std::shared_ptr<Entity> enemy : EntityManager::m_Entities)
-		{
-			if (enemy->m_type != EntityType::enemyMaster)
-			{
-				continue;
-			}
-
-			if (enemy->m_enabled == false)
-			{
-				continue;
-			}
-
-			sf::FloatRect boundWeapon;
-			boundWeapon = weapon->m_sprite.getGlobalBounds();
-
-			sf::FloatRect boundEnemy;
-			boundEnemy = enemy->m_sprite.getGlobalBounds();
-
-			if (boundWeapon.intersects(boundEnemy) == true)
-			{
-				enemy->m_enabled = false;
-				weapon->m_enabled = false;
-				_IsPlayerWeaponFired = false;
-				_score += 100;
-				//break;
-				goto end;
-			}
-		}
+		ranks += (ranks.empty() ? "Rank " : " / ") + std::to_string(_Ranks[i]);
+	}
+	if (ranks.empty() == false)
+	{
+		ranks += " of " + std::to_string(_HighScores.GetCount()) + ", best " + std::to_string(_HighScores.GetBest());
 	}
 
-end:
-	//nop
-	return;
+	_RankText.setFillColor(sf::Color::Green);
+	_RankText.setFont(mFont);
+	_RankText.setPosition(210.f, 300.f);
+	_RankText.setCharacterSize(20);
+	_RankText.setString(ranks);
 }
 
-void Game::HandleGameOver()
+void Game::handlePlayerInput(sf::Keyboard::Key key, bool isPressed)
 {
-	// Game Over ?
-	int count = std::count_if(EntityManager::m_Entities.begin(), EntityManager::m_Entities.end(), [](std::shared_ptr<Entity> element) {
-		if (element->m_type == EntityType::enemy || element->m_type == EntityType::enemyMaster)
-		{
-			if (element->m_enabled == false)
-			{
-				return true;
-			}
-		}
-		return false;
-	});
+	InputCommand command;
+	command.m_time = _Clock.getElapsedTime().asMicroseconds();
+	command.m_isPressed = isPressed;
 
-	// sprite counts + enemy master
-	//if (count >= (5))
-	if (count == ((SPRITE_COUNT_X * SPRITE_COUNT_Y) + 1))
-	{
-		DisplayGameOver();
-	}
+	if (key == sf::Keyboard::Up)
+		command.m_button = PlayerInput::Up;
+	else if (key == sf::Keyboard::Down)
+		command.m_button = PlayerInput::Down;
+	else if (key == sf::Keyboard::Left)
+		command.m_button = PlayerInput::Left;
+	else if (key == sf::Keyboard::Right)
+		command.m_button = PlayerInput::Right;
+	else if (key == sf::Keyboard::Space)
+		command.m_button = PlayerInput::Fire;
 
-	if (EntityManager::GetPlayer()->m_enabled == false)
+	if (command.m_button != 0 && _InputQueue.Push(command) == true)
 	{
-		DisplayGameOver();
+		_Latency.OnInput();
 	}
 
-	if (_lives == 0)
+	// Quick-save / quick-load, not in netplay where it would desync the peers
+	if (_Session)
 	{
-		DisplayGameOver();
+		return;
 	}
-}
 
-void Game::DisplayGameOver()
-{
-	if (_lives == 0)
+	if (key == sf::Keyboard::F5 && isPressed == true)
 	{
-		mText.setFillColor(sf::Color::Green);
-		mText.setFont(mFont);
-		mText.setPosition(200.f, 200.f);
-		mText.setCharacterSize(80);
-
-		mText.setString("GAME OVER");
-
-		_IsGameOver = true;
+		std::vector<unsigned char> state;
+		_Sim.SaveState(state);
+		GameStateFile::Save("quicksave.sav", state);
 	}
-	else
+	else if (key == sf::Keyboard::F9 && isPressed == true)
 	{
-		ResetSprites();
-	}
-}
-
-void Game::handlePlayerInput(sf::Keyboard::Key key, bool isPressed)
-{
-	if (key == sf::Keyboard::Up)
-		mIsMovingUp = isPressed;
-	else if (key == sf::Keyboard::Down)
-		mIsMovingDown = isPressed;
-	else if (key == sf::Keyboard::Left)
-		mIsMovingLeft = isPressed;
-	else if (key == sf::Keyboard::Right)
-		mIsMovingRight = isPressed;
-
-	if (key == sf::Keyboard::Space)
-	{
-		if (isPressed == false)
+		std::vector<unsigned char> state;
+		if (GameStateFile::Load("quicksave.sav", state) == true)
 		{
-			return;
-		}
-
-		if (_IsPlayerWeaponFired == true)
-		{
-			return;
+			if (_Sim.LoadState(state) == true)
+			{
+				// A running game enters the table when it ends; one saved over
+				// already did.
+				_IsScoreSubmitted = _Sim.IsGameOver();
+				_GameOverTick = 0;
+				std::fill(std::begin(_Ranks), std::end(_Ranks), 0);
+			}
+			_IsHudDirty = true;
 		}
-
-		std::shared_ptr<Entity> sw = std::make_shared<Entity>();
-		sw->m_sprite.setTexture(_TextureWeapon);
-		sw->m_sprite.setPosition(
-			EntityManager::GetPlayer()->m_sprite.getPosition().x + EntityManager::GetPlayer()->m_sprite.getTexture()->getSize().x / 2,
-			EntityManager::GetPlayer()->m_sprite.getPosition().y - 10);
-		sw->m_type = EntityType::weapon;
-		sw->m_size = _TextureWeapon.getSize();
-		EntityManager::m_Entities.push_back(sw);
-
-		_IsPlayerWeaponFired = true;
 	}
 }
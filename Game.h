@@ -1,82 +1,134 @@
 #pragma once
-#include "Weapon.h"
-
-#define SPRITE_COUNT_X 11
-#define SPRITE_COUNT_Y 5
-#define BLOCK_COUNT 4
+#include "AssetBundle.h"
+#include "GameSettings.h"
+#include "Level.h"
+#include "Simulation.h"
+#include "Transport.h"
+#include "RollbackSession.h"
+#include "Telemetry.h"
+#include "Bot.h"
+#include "Audio.h"
+#include "ParticlePool.h"
+#include "SpriteAtlas.h"
+#include "LatencyMonitor.h"
+#include "InputQueue.h"
+#include "HighScores.h"
 
 class Game
 {
 public:
-	Game();
-	~Game() { };
-	void run();
+	Game(const GameSettings& settings = GameSettings());
+	~Game();
+
+	// False when the game could not start, e.g. netplay without its port.
+	bool run();
 
 private:
 	void processEvents();
-	void update(sf::Time elapsedTime);
+	void update(sf::Time deadline);
 	void render();
 
 	void InitSprites();
-	void ResetSprites();
+	bool InitNetplay();
+	void InitRendering();
+	void AccountTextures();
+	void AccountHud();
+	void UpdateView();
 
 	void updateStatistics(sf::Time elapsedTime);
 	void HandleTexts();
-	void HandleCollisionEnemyMasterWeaponPlayer();
-	void HanldeEnemyMasterWeaponMoves();
-	void HandleEnemyMasterWeaponFiring();
-	void HandleCollisionEnemyMasterWeaponBlock();
-	void HandleEnemyMasterMove();
-	void HandleCollisionEnemyWeaponBlock();
-	void HandleCollisionWeaponPlayer();
-	void HanldeEnemyWeaponMoves();
-	void HandleEnemyWeaponFiring();
-	void HandleCollisionBlockEnemy();
-	void HandleEnemyMoves();
-	void HanldeWeaponMoves();
-	void HandleCollisionWeaponBlock();
-	void HandleCollisionWeaponEnemy();
-	void HandleCollisionWeaponEnemyMaster();
-	void HandleGameOver();
+	void CaptureState();
+	void SpawnParticles();
+	void SubmitScores();
 	void DisplayGameOver();
 	void handlePlayerInput(sf::Keyboard::Key key, bool isPressed);
 
 private:
-	static const float		PlayerSpeed;
 	static const sf::Time	TimePerFrame;
 
+	// Declared first so the mapping outlives the font streaming from it.
+	AssetBundle	_Assets;
 	sf::RenderWindow		mWindow;
-	sf::Texture	mTexture;
-	sf::Sprite	mPlayer;
+
+	// Everything is drawn at the logical size into _Playfield, optionally
+	// run through the CRT shader into _PostProcess, and the result is
+	// scaled to the window by _OutputView.
+	sf::RenderTexture	_Playfield;
+	sf::RenderTexture	_PostProcess;
+	sf::Shader			_CrtShader;
+	bool				_IsCrtEnabled = false;
+	sf::View			_OutputView;
+
 	sf::Font	mFont;
 	sf::Text	mStatisticsText;
 	sf::Time	mStatisticsUpdateTime;
 	sf::Text	mText;
 	sf::Text	_LivesText;
-	int _lives = 3;
 	sf::Text	_ScoreText;
-	int _score = 0;
+	sf::Text	_RankText;
 
 	std::size_t	mStatisticsNumFrames;
-	bool mIsMovingUp;
-	bool mIsMovingDown;
-	bool mIsMovingRight;
-	bool mIsMovingLeft;
-
-	bool _IsGameOver = false;
-	bool _IsEnemyWeaponFired = false;
-	bool _IsPlayerWeaponFired = false;
-	bool _IsEnemyMasterWeaponFired = false;
-
-	sf::Texture	_TextureEnemy;
-	sf::Sprite	_Enemy[SPRITE_COUNT_X][SPRITE_COUNT_Y];
-	sf::Texture	_TextureBlock;
-	sf::Sprite	_Block[BLOCK_COUNT];
+
+	// Keys go through _InputQueue as commands stamped on _Clock; ticks fold
+	// them into _Input. Fire stays set until a tick has taken the press.
+	sf::Clock	_Clock;
+	InputQueue	_InputQueue;
+	PlayerInput	_Input;
+	std::size_t	_AppliedCommands = 0;
+
+	// Lives and score texts need a refresh.
+	bool _IsHudDirty = true;
+
+	GameSettings	_Settings;
+	LevelSet		_Levels;
+	Simulation		_Sim;
+
+	// Netplay only
+	std::unique_ptr<UdpTransport>		_Transport;
+	std::unique_ptr<RollbackSession>	_Session;
+
+	TelemetryPublisher	_Telemetry;
+
+	// Each game enters the table once, at its game over; 0 = no rank.
+	HighScoreTable	_HighScores;
+	bool			_IsReady = true;		// everything asked for on the command line started
+	bool			_IsScoreSubmitted = false;
+	std::uint64_t	_GameOverTick = 0;		// of the game over being submitted, 0 = none
+	std::size_t		_Ranks[MAX_PLAYERS] = {};
+
+	SfmlAudioBackend	_AudioBackend;
+	AudioSystem			_Audio;
+
+	ParticlePool	_Particles;
+
+	// Latency report only
+	LatencyMonitor	_Latency;
+
+	// Bot mode only
+	BotObservation				_BotObservation;
+	std::vector<sf::Vector2f>	_BotBullets;
+
+	// State of the last two ticks, kept for crash capture and deltas.
+	std::vector<unsigned char>	_CurrentState;
+	std::vector<unsigned char>	_PreviousState;
+	std::vector<unsigned char>	_StateDelta;
+	std::ofstream	_StateRecord;
+	sf::Time		_StateSaveTime;
+
+	sf::Image	_ImageBlock;
+	std::vector<sf::Texture>	_ShieldTextures;
+	sf::Sprite	_SpriteBlock;
 	sf::Texture	_TextureWeapon;
 	sf::Texture	_TextureWeaponEnemy;
 	sf::Texture	_TextureWeaponEnemyMaster;
-	sf::Sprite	_Weapon;
-	sf::Texture	_TextureEnemyMaster;
-	sf::Sprite	_EnemyMaster;
-};
 
+	// Players, enemies and the master: one atlas, one vertex array, one
+	// draw call. Their type is their index into the animations.
+	sf::Image	_ImagePlayer;
+	sf::Image	_ImageEnemy;
+	sf::Image	_ImageEnemyMarch;
+	sf::Image	_ImageEnemyMaster;
+	SpriteAtlas	_Atlas;
+	int			_Animations[EntityType::block + 1];
+	sf::VertexArray	_EntityVertices;
+};
@@ -0,0 +1,83 @@
+#pragma once
+#include "Entity.h"
+
+//
+// What happened during one tick. The collision passes of the simulation
+// only detect: they read the entities and projectiles and push events.
+// Simulation then resolves the events in order, applying score, lives and
+// kills, and keeps those that took effect for the other consumers (HUD,
+// telemetry, audio), which read them after Step().
+//
+
+enum GameEventType
+{
+	enemyKilled,		// m_target = row in the enemies, m_value = points
+	enemyMasterKilled,	// m_target = row of the master, m_value = points
+	playerHit,			// m_target = row in the players, m_value = lives left
+	shieldHit,			// m_target = shield, m_position = crater, local to the shield
+	invaded,			// enemies reached the shields
+	levelStarted,		// m_target = level
+	playerFired			// m_player = shooter, m_position = where the shot starts
+};
+
+struct GameEvent
+{
+	GameEventType m_type = GameEventType::enemyKilled;
+
+	// The projectile that caused it, -1 if none. The index is the pool
+	// slot at detection time; resolution frees the slots afterwards.
+	EntityType m_projectileType = EntityType::weapon;
+	int m_projectile = -1;
+
+	// When in the tick the projectile made contact: 0 where it stood after
+	// the previous tick, 1 where it stands now, see ProjectilePool::Sweep().
+	float m_time = 1.f;
+
+	int m_player = -1;		// who fired, or who was hit
+	int m_target = -1;
+	int m_value = 0;
+	sf::Vector2f m_position;
+};
+
+// Fixed-capacity event list, allocated once and cleared every tick. Pushes
+// past the capacity are dropped and counted rather than growing the list.
+class GameEventBuffer
+{
+public:
+	void Reserve(std::size_t capacity)
+	{
+		m_events.resize(capacity);
+		m_count = 0;
+	}
+
+	void Clear() { m_count = 0; }
+
+	bool Push(const GameEvent& event)
+	{
+		if (m_count == m_events.size())
+		{
+			m_dropped++;
+			return false;
+		}
+
+		m_events[m_count++] = event;
+		return true;
+	}
+
+	// Keeps the first count events, for in-place filtering.
+	void Truncate(std::size_t count) { m_count = std::min(count, m_count); }
+
+	std::size_t GetCount() const { return m_count; }
+	std::size_t GetCapacity() const { return m_events.size(); }
+	std::size_t GetDropped() const { return m_dropped; }
+	GameEvent& operator[](std::size_t i) { return m_events[i]; }
+	const GameEvent& operator[](std::size_t i) const { return m_events[i]; }
+
+	const GameEvent* begin() const { return m_events.data(); }
+	const GameEvent* end() const { return m_events.data() + m_count; }
+
+private:
+	std::vector<GameEvent> m_events;
+	std::size_t m_count = 0;
+	std::size_t m_dropped = 0;
+};
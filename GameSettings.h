@@ -0,0 +1,101 @@
+#pragma once
+
+// Fire rate and bullet cap of one kind of shooter.
+struct WeaponSettings
+{
+	std::size_t m_capacity = 1;	// live projectiles at once
+	int m_cooldown = 0;			// ticks between two shots
+	int m_chance = 1;			// AI shooters fire on 1 roll out of m_chance
+	int m_shotsPerTick = 1;		// AI shots spawned per tick at most
+	float m_speed = 1.f;		// pixels per tick
+};
+
+struct GameSettings
+{
+	// Level file to load instead of Levels/Levels.txt from the assets.
+	std::string m_levelFile;
+
+	// Seed of the gameplay random generator.
+	std::uint64_t m_seed = 1978;
+
+	// When set, every tick's state is appended to this file (a full state
+	// every 60 ticks, deltas in between).
+	std::string m_stateRecordFile;
+
+	// Players in the game (1 or 2). In versus mode player shots also hit
+	// the other player.
+	int m_players = 1;
+	bool m_versus = false;
+
+	// Two-player netplay over UDP, see RollbackSession.h. The host is
+	// player 0 and learns the address of the other peer from its first
+	// datagram; both peers must run the same levels and seed.
+	bool m_netplay = false;
+	int m_localPlayer = 0;
+	unsigned short m_localPort = 0;
+	std::string m_remoteAddress;
+	unsigned short m_remotePort = 0;
+	int m_inputDelay = 2;		// ticks
+
+	// Output window; the playfield keeps its logical size and is scaled,
+	// letterboxed, to it. The CRT post-process needs shader support.
+	unsigned m_windowWidth = 840;
+	unsigned m_windowHeight = 600;
+	bool m_fullscreen = false;
+	bool m_crt = false;
+
+	// Player 0 is played by BotEnvironment::ScriptedPolicy instead of the keyboard.
+	bool m_bot = false;
+
+	// Prints input-to-photon latencies and frame times on exit, see
+	// LatencyMonitor.h.
+	bool m_latencyReport = false;
+
+	// Prints the memory of each subsystem, current and peak, on exit; see
+	// MemoryTracker.h.
+	bool m_memoryReport = false;
+
+	// Chrome trace-event JSON of the game loop zones, see Trace.h; empty = off.
+	std::string m_traceFile;
+
+	// Local high-score table, see HighScores.h; empty = off.
+	std::string m_highScoreFile = "highscores.dat";
+
+	// Localhost TCP port of the per-tick telemetry stream, 0 = off.
+	unsigned short m_telemetryPort = 0;
+
+	// Hits on the player do not cost lives; a game then only ends by
+	// invasion.
+	bool m_invulnerable = false;
+
+	// Bullet-hell profiling mode: every column fires every tick until the pool is full,
+	// and the players are invulnerable.
+	bool m_stress = false;
+	std::size_t m_stressProjectiles = 5000;
+
+	void EnableStressMode(std::size_t projectiles)
+	{
+		m_stress = true;
+		m_invulnerable = true;
+		m_stressProjectiles = projectiles;
+	}
+
+	// Overrides the level fire settings when the stress mode is on.
+	void ApplyStressMode(WeaponSettings& player, WeaponSettings& enemy, WeaponSettings& enemyMaster) const
+	{
+		if (m_stress == false)
+		{
+			return;
+		}
+
+		enemy.m_capacity = m_stressProjectiles;
+		enemy.m_chance = 1;
+		enemy.m_cooldown = 0;
+		enemy.m_shotsPerTick = static_cast<int>(m_stressProjectiles);
+		enemyMaster.m_capacity = m_stressProjectiles / 10 + 1;
+		enemyMaster.m_chance = 1;
+		enemyMaster.m_cooldown = 0;
+		player.m_capacity = 64;
+		player.m_cooldown = 4;
+	}
+};
@@ -0,0 +1,340 @@
+#include "pch.h"
+#include "GameState.h"
+#include "Checksum.h"
+
+#include <csignal>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <share.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+void GameStateFile::Seal(std::vector<unsigned char>& state)
+{
+	GameStateHeader header;
+	header.m_magic = GAME_STATE_MAGIC;
+	header.m_version = GAME_STATE_VERSION;
+	header.m_payloadSize = static_cast<std::uint32_t>(state.size() - sizeof(GameStateHeader));
+	header.m_checksum = Fnv1a32(state.data() + sizeof(GameStateHeader), header.m_payloadSize);
+	std::memcpy(state.data(), &header, sizeof(header));
+}
+
+bool GameStateFile::Open(const unsigned char* state, std::size_t size, const unsigned char*& payload, std::size_t& payloadSize)
+{
+	if (size < sizeof(GameStateHeader))
+	{
+		return false;
+	}
+
+	GameStateHeader header;
+	std::memcpy(&header, state, sizeof(header));
+
+	if (header.m_magic != GAME_STATE_MAGIC || header.m_version != GAME_STATE_VERSION)
+	{
+		return false;
+	}
+
+	if (header.m_payloadSize != size - sizeof(GameStateHeader))
+	{
+		return false;
+	}
+
+	payload = state + sizeof(GameStateHeader);
+	payloadSize = header.m_payloadSize;
+	return Fnv1a32(payload, payloadSize) == header.m_checksum;
+}
+
+bool GameStateFile::Save(const std::string& path, const std::vector<unsigned char>& state)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(state.data()), state.size());
+	return file.good();
+}
+
+bool GameStateFile::Load(const std::string& path, std::vector<unsigned char>& state)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (file.is_open() == false)
+	{
+		return false;
+	}
+
+	state.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return true;
+}
+
+//
+// Delta encoding
+//
+// u32 size of the current state, then (varint zero run, varint literal
+// count, literal bytes) tokens until the whole XOR has been covered.
+//
+
+static void WriteVarint(std::vector<unsigned char>& out, std::size_t value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back(static_cast<unsigned char>(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back(static_cast<unsigned char>(value));
+}
+
+static bool ReadVarint(const std::vector<unsigned char>& in, std::size_t& offset, std::size_t& value)
+{
+	value = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		if (offset >= in.size())
+		{
+			return false;
+		}
+
+		unsigned char byte = in[offset++];
+		value |= static_cast<std::size_t>(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void GameStateFile::EncodeDelta(const std::vector<unsigned char>& previous, const std::vector<unsigned char>& current, std::vector<unsigned char>& delta)
+{
+	delta.clear();
+
+	std::uint32_t size = static_cast<std::uint32_t>(current.size());
+	delta.insert(delta.end(), reinterpret_cast<const unsigned char*>(&size), reinterpret_cast<const unsigned char*>(&size) + sizeof(size));
+
+	std::size_t common = std::min(previous.size(), current.size());
+	std::size_t i = 0;
+	while (i < current.size())
+	{
+		std::size_t zeros = 0;
+		while (i + zeros < common && previous[i + zeros] == current[i + zeros])
+		{
+			zeros++;
+		}
+
+		std::size_t start = i + zeros;
+		std::size_t end = start;
+		while (end < current.size() && (end >= common || previous[end] != current[end]))
+		{
+			end++;
+		}
+
+		WriteVarint(delta, zeros);
+		WriteVarint(delta, end - start);
+		for (std::size_t j = start; j < end; j++)
+		{
+			delta.push_back(current[j] ^ (j < previous.size() ? previous[j] : 0));
+		}
+
+		i = end;
+	}
+}
+
+bool GameStateFile::DecodeDelta(const std::vector<unsigned char>& previous, const std::vector<unsigned char>& delta, std::vector<unsigned char>& current)
+{
+	std::uint32_t size;
+	if (delta.size() < sizeof(size))
+	{
+		return false;
+	}
+	std::memcpy(&size, delta.data(), sizeof(size));
+
+	current.resize(size);
+	std::size_t common = std::min<std::size_t>(previous.size(), size);
+	std::copy(previous.begin(), previous.begin() + common, current.begin());
+	std::fill(current.begin() + common, current.end(), 0);
+
+	std::size_t offset = sizeof(size);
+	std::size_t i = 0;
+	while (offset < delta.size())
+	{
+		std::size_t zeros, literals;
+		if (ReadVarint(delta, offset, zeros) == false || ReadVarint(delta, offset, literals) == false)
+		{
+			return false;
+		}
+
+		i += zeros;
+		if (i + literals > size || offset + literals > delta.size())
+		{
+			return false;
+		}
+
+		for (std::size_t j = 0; j < literals; j++, i++)
+		{
+			current[i] ^= delta[offset++];
+		}
+	}
+
+	return true;
+}
+
+//
+// Crash capture
+//
+// The handler only calls what a signal handler may: no heap, no stream,
+// no lock. The file is opened by InstallCrashHandler(), and the state is
+// one of two slots, each pointing to a state that is complete; the slot
+// is flipped once the other one is filled in.
+//
+
+struct CrashSlot
+{
+	const unsigned char* m_data;
+	std::size_t m_size;
+};
+
+static CrashSlot s_crashSlots[2] = {};
+static std::atomic<int> s_crashSlot{ 0 };
+static int s_crashFile = -1;
+static bool s_isCrashFileCreated = false;
+static std::string s_crashPath;
+
+static void WriteCrashState()
+{
+	const CrashSlot& slot = s_crashSlots[s_crashSlot.load()];
+	if (s_crashFile < 0 || slot.m_data == nullptr || slot.m_size == 0)
+	{
+		return;
+	}
+
+	// In place: the state of a previous crash stays until this one replaces it.
+	const unsigned char* data = slot.m_data;
+	std::size_t size = slot.m_size;
+#ifdef _WIN32
+	_lseek(s_crashFile, 0, SEEK_SET);
+	while (size > 0)
+	{
+		int written = _write(s_crashFile, data, static_cast<unsigned>(std::min<std::size_t>(size, 1 << 30)));
+		if (written <= 0)
+		{
+			return;
+		}
+		data += written;
+		size -= static_cast<std::size_t>(written);
+	}
+	_chsize_s(s_crashFile, static_cast<__int64>(slot.m_size));
+	_commit(s_crashFile);
+#else
+	lseek(s_crashFile, 0, SEEK_SET);
+	while (size > 0)
+	{
+		ssize_t written = write(s_crashFile, data, size);
+		if (written <= 0)
+		{
+			return;
+		}
+		data += written;
+		size -= static_cast<std::size_t>(written);
+	}
+	if (ftruncate(s_crashFile, static_cast<off_t>(slot.m_size)) == 0)
+	{
+		fsync(s_crashFile);
+	}
+#endif
+	s_isCrashFileCreated = false;
+}
+
+static void OnCrashSignal(int signal)
+{
+	WriteCrashState();
+	std::signal(signal, SIG_DFL);
+	std::raise(signal);
+}
+
+#ifdef _WIN32
+
+static int OpenCrashFile(const std::string& path, bool create)
+{
+	int file = -1;
+	_sopen_s(&file, path.c_str(), _O_WRONLY | _O_BINARY | (create ? _O_CREAT | _O_EXCL : 0), _SH_DENYNO, _S_IREAD | _S_IWRITE);
+	return file;
+}
+
+static void CloseCrashFile(int file)
+{
+	_close(file);
+}
+
+#else
+
+static int OpenCrashFile(const std::string& path, bool create)
+{
+	return open(path.c_str(), O_WRONLY | (create ? O_CREAT | O_EXCL : 0), 0644);
+}
+
+static void CloseCrashFile(int file)
+{
+	close(file);
+}
+
+#endif
+
+bool GameStateFile::InstallCrashHandler(const std::string& path)
+{
+	UninstallCrashHandler();
+
+	// Created here when missing, and removed again after a run without a crash.
+	s_crashFile = OpenCrashFile(path, true);
+	s_isCrashFileCreated = s_crashFile >= 0;
+	if (s_crashFile < 0)
+	{
+		s_crashFile = OpenCrashFile(path, false);
+	}
+	if (s_crashFile < 0)
+	{
+		std::cerr << "Crash capture: cannot open " << path << std::endl;
+		return false;
+	}
+	s_crashPath = path;
+
+	std::signal(SIGSEGV, OnCrashSignal);
+	std::signal(SIGFPE, OnCrashSignal);
+	std::signal(SIGILL, OnCrashSignal);
+
+	// std::terminate() ends in abort()
+	std::signal(SIGABRT, OnCrashSignal);
+	return true;
+}
+
+void GameStateFile::UninstallCrashHandler()
+{
+	if (s_crashFile < 0)
+	{
+		return;
+	}
+
+	std::signal(SIGSEGV, SIG_DFL);
+	std::signal(SIGFPE, SIG_DFL);
+	std::signal(SIGILL, SIG_DFL);
+	std::signal(SIGABRT, SIG_DFL);
+
+	CloseCrashFile(s_crashFile);
+	s_crashFile = -1;
+	if (s_isCrashFileCreated == true)
+	{
+		std::remove(s_crashPath.c_str());
+		s_isCrashFileCreated = false;
+	}
+
+	s_crashSlots[0] = CrashSlot();
+	s_crashSlots[1] = CrashSlot();
+}
+
+void GameStateFile::PublishCrashState(const std::vector<unsigned char>& state)
+{
+	int next = 1 - s_crashSlot.load();
+	s_crashSlots[next].m_data = state.data();
+	s_crashSlots[next].m_size = state.size();
+	s_crashSlot.store(next);
+}
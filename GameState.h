@@ -0,0 +1,122 @@
+#pragma once
+
+//
+// Binary game state format.
+//
+// A state is a GameStateHeader followed by the payload written by
+// Simulation::SaveState(): counters, RNG state, the mutable fields of every
+// entity, the live projectiles and the shield bitsets. Values are stored
+// in native byte order; states are meant for quick-save, rollback and
+// crash capture on the same build, not for exchange between platforms.
+//
+
+#define GAME_STATE_MAGIC 0x54534953 // "SIST"
+#define GAME_STATE_VERSION 3
+
+struct GameStateHeader
+{
+	std::uint32_t m_magic;
+	std::uint32_t m_version;
+	std::uint32_t m_payloadSize;
+	std::uint32_t m_checksum;
+};
+
+class StateWriter
+{
+public:
+	explicit StateWriter(std::vector<unsigned char>& buffer) : m_buffer(buffer) { }
+
+	void Write(const void* data, std::size_t size)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+	}
+
+	template <typename T>
+	void Write(const T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "raw values only");
+		Write(&value, sizeof(T));
+	}
+
+private:
+	std::vector<unsigned char>& m_buffer;
+};
+
+class StateReader
+{
+public:
+	StateReader(const unsigned char* data, std::size_t size) : m_data(data), m_size(size) { }
+
+	// Once a read fails every following read fails too, so callers only
+	// need to check IsOk() at the end.
+	bool Read(void* data, std::size_t size)
+	{
+		if (m_ok == false || size > m_size - m_offset)
+		{
+			m_ok = false;
+			return false;
+		}
+
+		std::memcpy(data, m_data + m_offset, size);
+		m_offset += size;
+		return true;
+	}
+
+	template <typename T>
+	bool Read(T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "raw values only");
+		return Read(&value, sizeof(T));
+	}
+
+	// Moves past bytes without reading them.
+	bool Skip(std::size_t size)
+	{
+		if (m_ok == false || size > m_size - m_offset)
+		{
+			m_ok = false;
+			return false;
+		}
+
+		m_offset += size;
+		return true;
+	}
+
+	void Fail() { m_ok = false; }
+	bool IsOk() const { return m_ok; }
+	bool IsAtEnd() const { return m_offset == m_size; }
+
+private:
+	const unsigned char* m_data;
+	std::size_t m_size;
+	std::size_t m_offset = 0;
+	bool m_ok = true;
+};
+
+class GameStateFile
+{
+public:
+	// Wraps a payload with its header / validates and strips it.
+	static void Seal(std::vector<unsigned char>& state);
+	static bool Open(const unsigned char* state, std::size_t size, const unsigned char*& payload, std::size_t& payloadSize);
+
+	static bool Save(const std::string& path, const std::vector<unsigned char>& state);
+	static bool Load(const std::string& path, std::vector<unsigned char>& state);
+
+	// Delta between two consecutive states: the XOR of both, with runs of
+	// zero bytes collapsed. Consecutive ticks differ in a few positions
+	// only, so deltas are a small fraction of a full state.
+	static void EncodeDelta(const std::vector<unsigned char>& previous, const std::vector<unsigned char>& current, std::vector<unsigned char>& delta);
+	static bool DecodeDelta(const std::vector<unsigned char>& previous, const std::vector<unsigned char>& delta, std::vector<unsigned char>& current);
+
+	// Writes the last published state to path when the process crashes.
+	// The file is opened here, so the signal handler only has to write.
+	static bool InstallCrashHandler(const std::string& path);
+	static void UninstallCrashHandler();
+
+	// Publishes a complete state to the crash handler. The buffer must stay
+	// untouched until the state after it has been published: write the
+	// states into two buffers in turn.
+	static void PublishCrashState(const std::vector<unsigned char>& state);
+};
@@ -0,0 +1,270 @@
+#include "pch.h"
+#include "HighScores.h"
+#include "MappedFile.h"
+#include "Checksum.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//
+// HighScoreRecord
+//
+
+void HighScoreRecord::Seal()
+{
+	m_magic = HIGH_SCORE_MAGIC;
+	m_checksum = Fnv1a32(&m_score, sizeof(HighScoreRecord) - offsetof(HighScoreRecord, m_score));
+}
+
+bool HighScoreRecord::IsValid() const
+{
+	return m_magic == HIGH_SCORE_MAGIC && m_checksum == Fnv1a32(&m_score, sizeof(HighScoreRecord) - offsetof(HighScoreRecord, m_score));
+}
+
+//
+// HighScoreTable
+//
+
+HighScoreTable::HighScoreTable()
+	: m_queue(HIGH_SCORE_QUEUE)
+{
+}
+
+HighScoreTable::~HighScoreTable()
+{
+	Close();
+}
+
+void HighScoreTable::Open(const std::string& path)
+{
+	Close();
+
+	m_path = path;
+	m_scores.clear();
+	m_records.clear();
+	m_isCompactionNeeded = false;
+
+	MappedFile file;
+	if (file.Open(path) == true)
+	{
+		const unsigned char* data = file.GetData();
+		std::size_t size = file.GetSize();
+		m_records.reserve(size / sizeof(HighScoreRecord));
+
+		// Copied out, the mapping gives no alignment guarantee once a
+		// damaged record has shifted the scan.
+		std::size_t offset = 0;
+		while (offset + sizeof(HighScoreRecord) <= size)
+		{
+			HighScoreRecord record;
+			std::memcpy(&record, data + offset, sizeof(record));
+			if (record.IsValid() == false)
+			{
+				m_isCompactionNeeded = true;
+				offset++;
+				continue;
+			}
+
+			m_records.push_back(record);
+			offset += sizeof(HighScoreRecord);
+		}
+
+		// A torn last record would shift every record appended after it.
+		if (offset != size)
+		{
+			m_isCompactionNeeded = true;
+		}
+
+		// Unmapped before the writer may replace the file.
+		file.Close();
+	}
+
+	if (m_records.size() > HIGH_SCORE_COMPACT_RECORDS)
+	{
+		m_isCompactionNeeded = true;
+	}
+
+	m_scores.reserve(m_records.size() + HIGH_SCORE_QUEUE);
+	for (const HighScoreRecord& record : m_records)
+	{
+		m_scores.push_back(record.m_score);
+	}
+	std::sort(m_scores.begin(), m_scores.end(), std::greater<int>());
+
+	m_dropped = 0;
+	m_running = true;
+	m_thread = std::thread(&HighScoreTable::WriterLoop, this);
+}
+
+void HighScoreTable::Close()
+{
+	if (IsOpen() == false)
+	{
+		return;
+	}
+
+	// The writer drains the queue before leaving.
+	m_running = false;
+	m_thread.join();
+}
+
+std::size_t HighScoreTable::Submit(int score, std::size_t level)
+{
+	std::size_t rank = GetRank(score);
+	m_scores.insert(m_scores.begin() + (rank - 1), score);
+
+	if (IsOpen() == false)
+	{
+		return rank;
+	}
+
+	HighScoreRecord* record = m_queue.BeginPush();
+	if (record == nullptr)
+	{
+		m_dropped++;
+		return rank;
+	}
+
+	record->m_score = score;
+	record->m_level = static_cast<std::uint32_t>(level);
+	record->m_time = static_cast<std::uint64_t>(std::time(nullptr));
+	record->Seal();
+	m_queue.EndPush();
+	return rank;
+}
+
+std::size_t HighScoreTable::GetRank(int score) const
+{
+	// The scores strictly better, found before the first equal one.
+	return static_cast<std::size_t>(std::lower_bound(m_scores.begin(), m_scores.end(), score, std::greater<int>()) - m_scores.begin()) + 1;
+}
+
+void HighScoreTable::WriterLoop()
+{
+	if (m_isCompactionNeeded == true)
+	{
+		Compact();
+	}
+
+	std::vector<HighScoreRecord> pending;
+	pending.reserve(HIGH_SCORE_QUEUE);
+
+	while (true)
+	{
+		// Read before the queue, so a record pushed before Close() is seen.
+		bool running = m_running;
+
+		pending.clear();
+		HighScoreRecord record;
+		while (m_queue.TryPop(record) == true)
+		{
+			pending.push_back(record);
+		}
+
+		if (pending.empty() == true)
+		{
+			if (running == false)
+			{
+				break;
+			}
+			sf::sleep(sf::milliseconds(10));
+			continue;
+		}
+
+		if (Write(m_path, pending, true) == false)
+		{
+			std::cerr << "High scores: cannot write " << m_path << std::endl;
+		}
+		m_records.insert(m_records.end(), pending.begin(), pending.end());
+
+		if (m_records.size() > HIGH_SCORE_COMPACT_RECORDS)
+		{
+			Compact();
+		}
+	}
+}
+
+void HighScoreTable::Compact()
+{
+	if (m_records.size() > HIGH_SCORE_KEEP)
+	{
+		std::nth_element(m_records.begin(), m_records.begin() + HIGH_SCORE_KEEP, m_records.end(),
+			[](const HighScoreRecord& a, const HighScoreRecord& b) { return a.m_score > b.m_score; });
+		m_records.resize(HIGH_SCORE_KEEP);
+	}
+
+	// The old file stays whole until the new one is on the disk.
+	std::string temporary = m_path + ".tmp";
+	if (Write(temporary, m_records, false) == false || Replace(temporary, m_path) == false)
+	{
+		std::cerr << "High scores: cannot compact " << m_path << std::endl;
+		return;
+	}
+
+	m_isCompactionNeeded = false;
+}
+
+#ifdef _WIN32
+
+bool HighScoreTable::Write(const std::string& path, const std::vector<HighScoreRecord>& records, bool append)
+{
+	HANDLE file = CreateFileA(path.c_str(), append ? FILE_APPEND_DATA : GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+		append ? OPEN_ALWAYS : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	DWORD size = static_cast<DWORD>(records.size() * sizeof(HighScoreRecord));
+	DWORD written = 0;
+	bool ok = WriteFile(file, records.data(), size, &written, nullptr) != FALSE && written == size;
+	ok = FlushFileBuffers(file) != FALSE && ok;
+	CloseHandle(file);
+	return ok;
+}
+
+bool HighScoreTable::Replace(const std::string& from, const std::string& to)
+{
+	return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != FALSE;
+}
+
+#else
+
+bool HighScoreTable::Write(const std::string& path, const std::vector<HighScoreRecord>& records, bool append)
+{
+	int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC), 0644);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	const char* data = reinterpret_cast<const char*>(records.data());
+	std::size_t size = records.size() * sizeof(HighScoreRecord);
+	bool ok = true;
+	while (size > 0)
+	{
+		ssize_t written = ::write(fd, data, size);
+		if (written <= 0)
+		{
+			ok = false;
+			break;
+		}
+		data += written;
+		size -= static_cast<std::size_t>(written);
+	}
+
+	ok = fsync(fd) == 0 && ok;
+	::close(fd);
+	return ok;
+}
+
+bool HighScoreTable::Replace(const std::string& from, const std::string& to)
+{
+	return ::rename(from.c_str(), to.c_str()) == 0;
+}
+
+#endif
@@ -0,0 +1,82 @@
+#pragma once
+#include "SpscQueue.h"
+
+//
+// Local high-score table, stored as an append-only file of fixed-size
+// records (native byte order), each one carrying a checksum of its fields.
+// A record torn by a crash or a power cut fails its check and is skipped,
+// the reader then scans forward for the next valid one, so no complete
+// record is ever lost.
+//
+// Open() maps the file and reads every record at once; the scores are then
+// kept sorted in memory, best first, and the rank of a score is a binary
+// search. Submit() only inserts the score and queues the record: a writer
+// thread appends it and flushes it to the disk, so the game never waits on
+// the file. When the file holds more than HIGH_SCORE_COMPACT_RECORDS
+// records, or damaged ones, the writer rewrites the best HIGH_SCORE_KEEP
+// into a temporary file and renames it over the table.
+//
+
+#define HIGH_SCORE_MAGIC 0x31534853u		// "SHS1"
+#define HIGH_SCORE_KEEP 16384
+#define HIGH_SCORE_COMPACT_RECORDS (HIGH_SCORE_KEEP * 2)
+#define HIGH_SCORE_QUEUE 16
+
+struct HighScoreRecord
+{
+	std::uint32_t m_magic;
+	std::uint32_t m_checksum;		// of the fields below
+	std::int32_t m_score;
+	std::uint32_t m_level;			// the level the game ended on
+	std::uint64_t m_time;			// seconds since 1970
+
+	void Seal();
+	bool IsValid() const;
+};
+
+class HighScoreTable
+{
+public:
+	HighScoreTable();
+	~HighScoreTable();
+
+public:
+	// Loads the table and starts the writer thread. A missing file is an
+	// empty table, created by the first Submit().
+	void Open(const std::string& path);
+	void Close();
+	bool IsOpen() const { return m_thread.joinable(); }
+
+	// Adds a score to the table and queues it for writing. Returns its
+	// rank. Never waits: when the queue is full the record is dropped and
+	// counted, and the score only lives until Close().
+	std::size_t Submit(int score, std::size_t level);
+
+	// 1 for the best score; equal scores share a rank.
+	std::size_t GetRank(int score) const;
+	std::size_t GetCount() const { return m_scores.size(); }
+	int GetBest() const { return m_scores.empty() ? 0 : m_scores.front(); }
+	std::size_t GetDropped() const { return m_dropped; }
+
+private:
+	void WriterLoop();
+	void Compact();
+
+	// Appends, or replaces the file with, the records and flushes them to
+	// the disk before returning.
+	static bool Write(const std::string& path, const std::vector<HighScoreRecord>& records, bool append);
+	static bool Replace(const std::string& from, const std::string& to);
+
+private:
+	std::string m_path;
+	std::vector<int> m_scores;		// best first
+	std::size_t m_dropped = 0;
+
+	// Writer thread only, once started
+	std::vector<HighScoreRecord> m_records;		// of the file
+	bool m_isCompactionNeeded = false;
+
+	SpscQueue<HighScoreRecord> m_queue;
+	std::thread m_thread;
+	std::atomic<bool> m_running{ false };
+};
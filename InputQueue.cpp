@@ -0,0 +1,45 @@
+#include "pch.h"
+#include "InputQueue.h"
+
+// Far more than a tick can see, even mashing every key.
+static const std::size_t InputQueueCapacity = 256;
+
+InputQueue::InputQueue()
+	: m_queue(InputQueueCapacity)
+{
+}
+
+bool InputQueue::Push(const InputCommand& command)
+{
+	if (m_queue.TryPush(command) == false)
+	{
+		m_dropped++;
+		return false;
+	}
+
+	return true;
+}
+
+std::size_t InputQueue::Apply(sf::Int64 deadline, PlayerInput& input)
+{
+	std::size_t count = 0;
+	for (InputCommand* command = m_queue.BeginPop(); command != nullptr; command = m_queue.BeginPop())
+	{
+		// Later commands wait for a later tick
+		if (command->m_time >= deadline)
+		{
+			break;
+		}
+
+		// A release does not cancel a press of Fire the tick has not seen yet
+		if (command->m_isPressed == true)
+			input.m_buttons |= command->m_button;
+		else if (command->m_button != PlayerInput::Fire)
+			input.m_buttons &= static_cast<unsigned char>(~command->m_button);
+
+		m_queue.EndPop();
+		count++;
+	}
+
+	return count;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "SpscQueue.h"
+#include "Simulation.h"
+
+//
+// Key presses and releases as timestamped commands, from the thread that
+// polls the window to the one that runs the ticks, through a lock-free
+// ring. Each tick takes the commands stamped before its deadline, so what
+// a tick sees only depends on when the keys were polled, not on which
+// loop iteration happened to poll them.
+//
+
+struct InputCommand
+{
+	sf::Int64 m_time = 0;			// microseconds on the game clock, at poll time
+	unsigned char m_button = 0;		// PlayerInput::Button
+	bool m_isPressed = false;
+};
+
+class InputQueue
+{
+public:
+	InputQueue();
+
+	// Producer: false when the ring is full, the command is then dropped.
+	bool Push(const InputCommand& command);
+
+	// Consumer: applies the commands stamped before deadline to the held
+	// buttons and returns how many there were. Fire is only ever set here;
+	// the caller clears it once a tick has taken the press.
+	std::size_t Apply(sf::Int64 deadline, PlayerInput& input);
+
+	std::size_t GetDropped() const { return m_dropped; }
+
+private:
+	SpscQueue<InputCommand> m_queue;
+	std::size_t m_dropped = 0;		// producer side
+};
@@ -0,0 +1,166 @@
+#include "pch.h"
+#include "LatencyMonitor.h"
+
+// Frame time histogram: one millisecond per bucket, the last one open.
+static const int HistogramBuckets = 34;
+static const int HistogramWidth = 50;
+
+static void ReportPercentiles(std::ostream& out, const char* name, std::vector<sf::Int64> samples)
+{
+	if (samples.empty() == true)
+	{
+		out << name << ": no sample" << std::endl;
+		return;
+	}
+
+	std::sort(samples.begin(), samples.end());
+	out << name << " (" << samples.size() << "): p50 " << samples[samples.size() / 2] / 1000.f
+		<< "ms, p90 " << samples[samples.size() * 90 / 100] / 1000.f
+		<< "ms, p99 " << samples[samples.size() * 99 / 100] / 1000.f
+		<< "ms, max " << samples.back() / 1000.f << "ms" << std::endl;
+}
+
+void LatencyMonitor::Start(std::size_t maxInputs, std::size_t maxFrames)
+{
+	m_polled.clear();
+	m_ticked.clear();
+	m_inputToTick.clear();
+	m_tickToPhoton.clear();
+	m_inputToPhoton.clear();
+	m_frameTimes.clear();
+
+	m_polled.reserve(maxInputs);
+	m_ticked.reserve(maxInputs);
+	m_inputToTick.reserve(maxInputs);
+	m_tickToPhoton.reserve(maxInputs);
+	m_inputToPhoton.reserve(maxInputs);
+	m_frameTimes.reserve(maxFrames);
+
+	m_dropped = 0;
+	m_lastFrame = -1;
+	m_clock.restart();
+	m_running = true;
+}
+
+void LatencyMonitor::OnInput()
+{
+	if (m_running == false)
+	{
+		return;
+	}
+
+	// Every input ends up in m_inputToPhoton, so this bounds all the vectors
+	if (m_polled.size() + m_ticked.size() + m_inputToPhoton.size() >= m_inputToPhoton.capacity())
+	{
+		m_dropped++;
+		return;
+	}
+
+	m_polled.push_back(m_clock.getElapsedTime().asMicroseconds());
+}
+
+void LatencyMonitor::OnTick(std::size_t inputs)
+{
+	inputs = std::min(inputs, m_polled.size());
+	if (m_running == false || inputs == 0)
+	{
+		return;
+	}
+
+	sf::Int64 now = m_clock.getElapsedTime().asMicroseconds();
+	for (std::size_t i = 0; i < inputs; i++)
+	{
+		PendingInput input;
+		input.m_poll = m_polled[i];
+		input.m_tick = now;
+		m_ticked.push_back(input);
+		m_inputToTick.push_back(now - input.m_poll);
+	}
+
+	m_polled.erase(m_polled.begin(), m_polled.begin() + inputs);
+}
+
+void LatencyMonitor::OnFrame()
+{
+	if (m_running == false)
+	{
+		return;
+	}
+
+	sf::Int64 now = m_clock.getElapsedTime().asMicroseconds();
+	for (const PendingInput& input : m_ticked)
+	{
+		m_tickToPhoton.push_back(now - input.m_tick);
+		m_inputToPhoton.push_back(now - input.m_poll);
+	}
+	m_ticked.clear();
+
+	if (m_lastFrame >= 0)
+	{
+		if (m_frameTimes.size() < m_frameTimes.capacity())
+			m_frameTimes.push_back(now - m_lastFrame);
+		else
+			m_dropped++;
+	}
+	m_lastFrame = now;
+}
+
+void LatencyMonitor::Report(std::ostream& out) const
+{
+	ReportPercentiles(out, "Input to tick", m_inputToTick);
+	ReportPercentiles(out, "Tick to photon", m_tickToPhoton);
+	ReportPercentiles(out, "Input to photon", m_inputToPhoton);
+	ReportPercentiles(out, "Frame time", m_frameTimes);
+
+	if (m_dropped > 0)
+	{
+		out << m_dropped << " samples dropped" << std::endl;
+	}
+
+	if (m_frameTimes.empty() == true)
+	{
+		return;
+	}
+
+	// Jitter: spread of the frame times and mean change between two frames
+	double mean = 0.0;
+	double change = 0.0;
+	for (std::size_t i = 0; i < m_frameTimes.size(); i++)
+	{
+		mean += m_frameTimes[i];
+		if (i > 0)
+			change += std::abs(static_cast<double>(m_frameTimes[i] - m_frameTimes[i - 1]));
+	}
+	mean /= m_frameTimes.size();
+
+	double variance = 0.0;
+	for (sf::Int64 frameTime : m_frameTimes)
+	{
+		variance += (frameTime - mean) * (frameTime - mean);
+	}
+	variance /= m_frameTimes.size();
+	change /= std::max<std::size_t>(m_frameTimes.size() - 1, 1);
+
+	out << "Frame time mean " << mean / 1000.0 << "ms, deviation " << std::sqrt(variance) / 1000.0
+		<< "ms, frame to frame " << change / 1000.0 << "ms" << std::endl;
+
+	std::size_t buckets[HistogramBuckets] = {};
+	std::size_t largest = 0;
+	for (sf::Int64 frameTime : m_frameTimes)
+	{
+		std::size_t& bucket = buckets[std::min<sf::Int64>(frameTime / 1000, HistogramBuckets - 1)];
+		bucket++;
+		largest = std::max(largest, bucket);
+	}
+
+	for (int i = 0; i < HistogramBuckets; i++)
+	{
+		if (buckets[i] == 0)
+		{
+			continue;
+		}
+
+		out << i << (i == HistogramBuckets - 1 ? "+ms\t" : "ms\t") << buckets[i] << "\t"
+			<< std::string(std::max<std::size_t>(buckets[i] * HistogramWidth / largest, 1), '#') << std::endl;
+	}
+}
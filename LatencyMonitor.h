@@ -0,0 +1,49 @@
+#pragma once
+
+//
+// Input-to-photon and frame-pacing measurements of the game loop.
+//
+// A key event is stamped when processEvents() polls it, again by the
+// tick that takes it from the input queue, and a last time when the frame
+// showing that tick has been displayed. Frame times are the intervals between two
+// displays. Samples are kept in storage reserved by Start(), so recording
+// never allocates; past that the samples are dropped and counted.
+//
+
+class LatencyMonitor
+{
+public:
+	void Start(std::size_t maxInputs = 1 << 16, std::size_t maxFrames = 1 << 20);
+	bool IsRunning() const { return m_running; }
+
+	// A key event was just polled.
+	void OnInput();
+
+	// A tick just ran with the next inputs polled, oldest first.
+	void OnTick(std::size_t inputs);
+
+	// A frame was just displayed.
+	void OnFrame();
+
+	// Percentiles of the three latencies and a histogram of frame times.
+	void Report(std::ostream& out) const;
+
+private:
+	struct PendingInput
+	{
+		sf::Int64 m_poll;
+		sf::Int64 m_tick;
+	};
+
+	bool m_running = false;
+	sf::Clock m_clock;
+	sf::Int64 m_lastFrame = -1;
+
+	std::vector<sf::Int64> m_polled;			// waiting for a tick
+	std::vector<PendingInput> m_ticked;			// waiting for a frame
+	std::vector<sf::Int64> m_inputToTick;		// microseconds
+	std::vector<sf::Int64> m_tickToPhoton;
+	std::vector<sf::Int64> m_inputToPhoton;
+	std::vector<sf::Int64> m_frameTimes;
+	std::size_t m_dropped = 0;
+};
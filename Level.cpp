@@ -0,0 +1,311 @@
+#include "pch.h"
+#include "Level.h"
+#include "AssetBundle.h"
+
+LevelSet::LevelSet()
+{
+}
+
+LevelSet::~LevelSet()
+{
+}
+
+void LevelSet::LoadDefault()
+{
+	m_enemyTypes.assign(1, EnemyTypeDefinition());
+	m_levels.assign(1, LevelDefinition());
+
+	LevelDefinition& level = m_levels[0];
+	level.m_grid.assign(level.m_columns * level.m_rows, 0);
+	for (int i = 0; i < 4; i++)
+	{
+		level.m_shields.push_back(sf::Vector2f(150.f * (i + 1), 360.f));
+	}
+}
+
+void LevelSet::Load(const AssetBundle& assets, const std::string& levelFile)
+{
+	bool loaded = false;
+
+	if (levelFile.empty() == false)
+	{
+		loaded = LoadFromFile(levelFile);
+	}
+	else
+	{
+		const void* data;
+		std::size_t size;
+		if (assets.Find("Levels/Levels.txt", data, size) == true)
+			loaded = LoadFromMemory(static_cast<const char*>(data), size);
+		else
+			loaded = LoadFromFile("Media/Levels/Levels.txt");
+	}
+
+	if (loaded == false)
+	{
+		LoadDefault();
+	}
+}
+
+bool LevelSet::LoadFromFile(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (file.is_open() == false)
+	{
+		return false;
+	}
+
+	std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	return LoadFromMemory(data.c_str(), data.size());
+}
+
+bool LevelSet::LoadFromMemory(const char* data, std::size_t size)
+{
+	m_enemyTypes.clear();
+	m_levels.clear();
+	m_pendingRows.clear();
+	m_fill = 0;
+
+	std::istringstream stream(std::string(data, size));
+	std::string line;
+	LevelDefinition* level = nullptr;
+	std::string error;
+	int number = 0;
+
+	while (std::getline(stream, line))
+	{
+		number++;
+		if (ParseLine(line, level, error) == false)
+		{
+			std::cerr << "Levels, line " << number << ": " << error << std::endl;
+			m_levels.clear();
+			return false;
+		}
+	}
+
+	if (level != nullptr && Finish(*level, error) == false)
+	{
+		std::cerr << "Levels, line " << number << ": " << error << std::endl;
+		m_levels.clear();
+		return false;
+	}
+
+	if (m_levels.empty() == true)
+	{
+		std::cerr << "Levels: no [level] defined" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool LevelSet::ParseLine(const std::string& line, LevelDefinition*& level, std::string& error)
+{
+	std::string text = line.substr(0, line.find('#'));
+	std::istringstream stream(text);
+	std::string key;
+	if (!(stream >> key))
+	{
+		return true;
+	}
+
+	if (key == "[level]")
+	{
+		if (level != nullptr && Finish(*level, error) == false)
+		{
+			return false;
+		}
+
+		m_levels.push_back(LevelDefinition());
+		level = &m_levels.back();
+		std::getline(stream >> std::ws, level->m_name);
+		if (level->m_name.empty() == true)
+		{
+			level->m_name = "Wave " + std::to_string(m_levels.size());
+		}
+		return true;
+	}
+
+	if (key == "enemy")
+	{
+		EnemyTypeDefinition type;
+		std::string color;
+		if (!(stream >> type.m_symbol >> type.m_score >> color) || type.m_symbol == '.')
+		{
+			error = "expected: enemy <symbol> <score> <RRGGBB>";
+			return false;
+		}
+		if (m_enemyTypes.size() >= LEVEL_EMPTY_CELL)
+		{
+			error = "too many enemy types";
+			return false;
+		}
+
+		char* end = nullptr;
+		unsigned long rgb = std::strtoul(color.c_str(), &end, 16);
+		bool isHex = std::all_of(color.begin(), color.end(), [](char c) { return std::isxdigit(static_cast<unsigned char>(c)) != 0; });
+		if (color.size() != 6 || isHex == false || end != color.c_str() + color.size())
+		{
+			error = "expected: enemy <symbol> <score> <RRGGBB>";
+			return false;
+		}
+		type.m_color = sf::Color((rgb >> 16) & 0xFF, (rgb >> 8) & 0xFF, rgb & 0xFF);
+		m_enemyTypes.push_back(type);
+		return true;
+	}
+
+	if (level == nullptr)
+	{
+		error = "'" + key + "' outside of a [level]";
+		return false;
+	}
+
+	bool ok = true;
+
+	if (key == "grid")
+	{
+		ok = static_cast<bool>(stream >> level->m_columns >> level->m_rows) && level->m_columns > 0 && level->m_columns <= LEVEL_MAX_COLUMNS && level->m_rows > 0 && level->m_rows <= LEVEL_MAX_ROWS;
+	}
+	else if (key == "row")
+	{
+		std::string row;
+		ok = static_cast<bool>(stream >> row);
+		m_pendingRows.push_back(row);
+	}
+	else if (key == "fill")
+	{
+		ok = static_cast<bool>(stream >> m_fill);
+	}
+	else if (key == "origin")
+	{
+		ok = static_cast<bool>(stream >> level->m_origin.x >> level->m_origin.y);
+	}
+	else if (key == "spacing")
+	{
+		ok = static_cast<bool>(stream >> level->m_spacing.x >> level->m_spacing.y);
+	}
+	else if (key == "march")
+	{
+		ok = static_cast<bool>(stream >> level->m_enemySpeed >> level->m_enemyMarch >> level->m_enemyDrop);
+		ok = ok && level->m_enemySpeed > 0.f && level->m_enemyMarch >= 1;
+	}
+	else if (key == "master")
+	{
+		ok = static_cast<bool>(stream >> level->m_masterSpeed >> level->m_masterLeft >> level->m_masterRight);
+	}
+	else if (key == "fire")
+	{
+		std::string shooter;
+		WeaponSettings weapon;
+		long long capacity = 0;
+		ok = static_cast<bool>(stream >> shooter >> capacity >> weapon.m_cooldown >> weapon.m_chance >> weapon.m_speed);
+		ok = ok && capacity > 0 && capacity <= LEVEL_MAX_CAPACITY && weapon.m_chance > 0 && weapon.m_speed > 0.f;
+		weapon.m_capacity = static_cast<std::size_t>(capacity);
+		if (shooter == "player")
+			level->m_player = weapon;
+		else if (shooter == "enemy")
+			level->m_enemy = weapon;
+		else if (shooter == "master")
+			level->m_enemyMaster = weapon;
+		else
+			ok = false;
+	}
+	else if (key == "shield")
+	{
+		sf::Vector2f position;
+		ok = static_cast<bool>(stream >> position.x >> position.y);
+		level->m_shields.push_back(position);
+	}
+	else
+	{
+		error = "unknown key '" + key + "'";
+		return false;
+	}
+
+	if (ok == false)
+	{
+		error = "invalid '" + key + "'";
+		return false;
+	}
+
+	return true;
+}
+
+bool LevelSet::Finish(LevelDefinition& level, std::string& error)
+{
+	if (m_enemyTypes.empty() == true)
+	{
+		m_enemyTypes.push_back(EnemyTypeDefinition());
+	}
+
+	level.m_grid.assign(level.m_columns * level.m_rows, LEVEL_EMPTY_CELL);
+
+	for (int y = 0; y < level.m_rows; y++)
+	{
+		for (int x = 0; x < level.m_columns; x++)
+		{
+			char symbol = m_fill;
+			if (y < static_cast<int>(m_pendingRows.size()))
+			{
+				symbol = x < static_cast<int>(m_pendingRows[y].size()) ? m_pendingRows[y][x] : '.';
+			}
+
+			if (symbol == 0 || symbol == '.')
+			{
+				continue;
+			}
+
+			std::vector<EnemyTypeDefinition>::const_iterator type = std::find_if(m_enemyTypes.begin(), m_enemyTypes.end(), [symbol](const EnemyTypeDefinition& t) {
+				return t.m_symbol == symbol;
+			});
+
+			if (type == m_enemyTypes.end())
+			{
+				error = std::string("unknown enemy '") + symbol + "' in " + level.m_name;
+				return false;
+			}
+
+			level.m_grid[y * level.m_columns + x] = static_cast<unsigned char>(type - m_enemyTypes.begin());
+		}
+	}
+
+	if (static_cast<int>(m_pendingRows.size()) > level.m_rows)
+	{
+		error = "more rows than the grid in " + level.m_name;
+		return false;
+	}
+
+	m_pendingRows.clear();
+	m_fill = 0;
+	return true;
+}
+
+int LevelSet::GetMaxEnemies() const
+{
+	int count = 0;
+	for (const LevelDefinition& level : m_levels)
+	{
+		count = std::max(count, level.GetEnemyCount());
+	}
+	return count;
+}
+
+int LevelSet::GetMaxShields() const
+{
+	std::size_t count = 0;
+	for (const LevelDefinition& level : m_levels)
+	{
+		count = std::max(count, level.m_shields.size());
+	}
+	return static_cast<int>(count);
+}
+
+std::size_t LevelSet::GetMaxCapacity(WeaponSettings LevelDefinition::* weapon) const
+{
+	std::size_t capacity = 0;
+	for (const LevelDefinition& level : m_levels)
+	{
+		capacity = std::max(capacity, (level.*weapon).m_capacity);
+	}
+	return capacity;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include "GameSettings.h"
+
+class AssetBundle;
+
+//
+// Waves are described in a small text file (Media/Levels/Levels.txt) that
+// is parsed once at startup. Switching level only re-configures entities
+// created for the largest level, nothing is allocated.
+//
+
+#define LEVEL_EMPTY_CELL 0xFF
+
+// A formation column is a 64-bit mask, see Formation.h.
+#define LEVEL_MAX_ROWS 64
+
+// Keeps the cell count of a grid far from overflowing; the playfield holds
+// a few dozen columns at most.
+#define LEVEL_MAX_COLUMNS 256
+
+// Live projectiles of one shooter at most, the default of the stress mode;
+// the pools are sized from the largest capacity of the set.
+#define LEVEL_MAX_CAPACITY 5000
+
+struct EnemyTypeDefinition
+{
+	char m_symbol = 'A';
+	int m_score = 10;
+	sf::Color m_color = sf::Color::White;
+};
+
+struct LevelDefinition
+{
+	std::string m_name = "Wave";
+
+	// Formation, one enemy type index per cell, row by row.
+	int m_columns = 11;
+	int m_rows = 5;
+	std::vector<unsigned char> m_grid;
+	sf::Vector2f m_origin = sf::Vector2f(150.f, 60.f);
+	sf::Vector2f m_spacing = sf::Vector2f(50.f, 50.f);
+
+	// Enemies step m_enemySpeed per tick and turn every m_enemyMarch ticks,
+	// dropping by m_enemyDrop when they turn back to the right.
+	float m_enemySpeed = 1.f;
+	int m_enemyMarch = 100;
+	float m_enemyDrop = 1.f;
+
+	// Enemy master bounces between m_masterLeft and m_masterRight.
+	float m_masterSpeed = 0.5f;
+	float m_masterLeft = 150.f;
+	float m_masterRight = 600.f;
+
+	WeaponSettings m_player;
+	WeaponSettings m_enemy;
+	WeaponSettings m_enemyMaster;
+
+	std::vector<sf::Vector2f> m_shields;
+
+	LevelDefinition()
+	{
+		m_enemy.m_chance = 20;
+		m_enemyMaster.m_chance = 50;
+	}
+
+	int GetEnemyCount() const
+	{
+		return static_cast<int>(std::count_if(m_grid.begin(), m_grid.end(), [](unsigned char cell) { return cell != LEVEL_EMPTY_CELL; }));
+	}
+};
+
+class LevelSet
+{
+public:
+	LevelSet();
+	~LevelSet();
+
+public:
+	bool LoadFromMemory(const char* data, std::size_t size);
+	bool LoadFromFile(const std::string& path);
+
+	// The original 11x5 wave with four shields.
+	void LoadDefault();
+
+	// levelFile when given, else Levels/Levels.txt from the assets, else
+	// the default wave.
+	void Load(const AssetBundle& assets, const std::string& levelFile);
+
+	std::size_t GetCount() const { return m_levels.size(); }
+	const LevelDefinition& Get(std::size_t index) const { return m_levels[index]; }
+	const EnemyTypeDefinition& GetEnemyType(unsigned char index) const { return m_enemyTypes[index]; }
+
+	// Sizes of the largest level, used to preallocate everything once.
+	int GetMaxEnemies() const;
+	int GetMaxShields() const;
+	std::size_t GetMaxCapacity(WeaponSettings LevelDefinition::* weapon) const;
+
+private:
+	bool ParseLine(const std::string& line, LevelDefinition*& level, std::string& error);
+	bool Finish(LevelDefinition& level, std::string& error);
+
+private:
+	std::vector<EnemyTypeDefinition> m_enemyTypes;
+	std::vector<LevelDefinition> m_levels;
+	std::vector<std::string> m_pendingRows;
+	char m_fill = 0;
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+// Read-only view of a whole file mapped into memory.
+// The data stays valid until Close() or destruction.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool Open(const std::string& path);
+	void Close();
+
+	bool IsOpen() const { return m_data != nullptr; }
+	const unsigned char* GetData() const { return m_data; }
+	std::size_t GetSize() const { return m_size; }
+
+private:
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const unsigned char* m_data = nullptr;
+	std::size_t m_size = 0;
+#ifdef _WIN32
+	void* m_file = nullptr;
+	void* m_mapping = nullptr;
+#else
+	int m_fd = -1;
+#endif
+};
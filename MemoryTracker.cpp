@@ -0,0 +1,126 @@
+#include "pch.h"
+#include "MemoryTracker.h"
+
+static const char* TagNames[memoryTagCount] = { "entities", "projectiles", "particles", "textures", "hud", "audio" };
+
+MemoryTracker::Counters MemoryTracker::s_tags[memoryTagCount];
+
+void MemoryTracker::Allocate(MemoryTag tag, std::size_t bytes)
+{
+	Counters& counters = s_tags[tag];
+	counters.m_allocations++;
+	Update(tag, counters.m_current.fetch_add(bytes) + bytes);
+}
+
+void MemoryTracker::Free(MemoryTag tag, std::size_t bytes)
+{
+	s_tags[tag].m_current.fetch_sub(bytes);
+}
+
+void MemoryTracker::SetCurrent(MemoryTag tag, std::size_t bytes)
+{
+	s_tags[tag].m_current = bytes;
+	Update(tag, bytes);
+}
+
+void MemoryTracker::SetBudget(MemoryTag tag, std::size_t bytes)
+{
+	Counters& counters = s_tags[tag];
+	counters.m_budget = bytes;
+	counters.m_isOverBudget = false;
+	Update(tag, counters.m_current);
+}
+
+bool MemoryTracker::SetBudgets(const std::string& budgets)
+{
+	std::istringstream stream(budgets);
+	std::string entry;
+	while (std::getline(stream, entry, ','))
+	{
+		std::size_t equals = entry.find('=');
+		if (equals == std::string::npos)
+		{
+			return false;
+		}
+
+		std::string name = entry.substr(0, equals);
+		const char* digits = entry.c_str() + equals + 1;
+		char* end = nullptr;
+		unsigned long long kibibytes = std::strtoull(digits, &end, 10);
+		if (end == digits || *end != 0)
+		{
+			return false;
+		}
+
+		int tag = 0;
+		while (tag < memoryTagCount && name != TagNames[tag])
+		{
+			tag++;
+		}
+		if (tag == memoryTagCount)
+		{
+			return false;
+		}
+		SetBudget(static_cast<MemoryTag>(tag), static_cast<std::size_t>(kibibytes) * 1024);
+	}
+	return true;
+}
+
+bool MemoryTracker::IsOverBudget()
+{
+	for (int tag = 0; tag < memoryTagCount; tag++)
+	{
+		if (s_tags[tag].m_isOverBudget == true)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+std::size_t MemoryTracker::GetTotal()
+{
+	std::size_t total = 0;
+	for (int tag = 0; tag < memoryTagCount; tag++)
+	{
+		total += s_tags[tag].m_current;
+	}
+	return total;
+}
+
+const char* MemoryTracker::GetName(MemoryTag tag)
+{
+	return TagNames[tag];
+}
+
+void MemoryTracker::Report(std::ostream& stream)
+{
+	for (int tag = 0; tag < memoryTagCount; tag++)
+	{
+		const Counters& counters = s_tags[tag];
+		stream << "Memory: " << TagNames[tag] << ' ' << (counters.m_current + 1023) / 1024 << " KiB, peak " << (counters.m_peak + 1023) / 1024
+			<< " KiB, " << counters.m_allocations << " allocations";
+		if (counters.m_budget > 0)
+		{
+			stream << ", budget " << counters.m_budget / 1024 << " KiB" << (counters.m_isOverBudget ? " exceeded" : "");
+		}
+		stream << std::endl;
+	}
+	stream << "Memory: " << (GetTotal() + 1023) / 1024 << " KiB in all" << std::endl;
+}
+
+void MemoryTracker::Update(MemoryTag tag, std::size_t current)
+{
+	Counters& counters = s_tags[tag];
+	std::size_t peak = counters.m_peak;
+	while (current > peak && counters.m_peak.compare_exchange_weak(peak, current) == false)
+	{
+	}
+
+	// Reported once per budget; SetBudget() rearms it.
+	std::size_t budget = counters.m_budget;
+	if (budget > 0 && current > budget && counters.m_isOverBudget.exchange(true) == false)
+	{
+		std::cerr << "Memory: " << TagNames[tag] << " over budget, " << current << " bytes of " << budget << std::endl;
+	}
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+//
+// Memory accounting per subsystem. Containers of a subsystem allocate
+// through TrackingAllocator, tagged with it; resources whose storage SFML
+// or the driver owns (textures, sound buffers, font pages) are accounted
+// by their owners with Allocate() and Free(), or sampled with SetCurrent().
+// The counters are atomic, any thread may allocate.
+//
+// Each tag keeps its current bytes, the peak, and the allocations made. A
+// tag may have a budget: the first allocation over it is reported on the
+// error stream and the tag stays marked over budget, for the stats overlay,
+// the shutdown report and the soak run to fail on. The game keeps running;
+// a budget is a tripwire for the team, not a limit for the player.
+//
+
+enum MemoryTag
+{
+	memoryEntities,
+	memoryProjectiles,
+	memoryParticles,
+	memoryTextures,
+	memoryHud,
+	memoryAudio,
+	memoryTagCount
+};
+
+class MemoryTracker
+{
+public:
+	static void Allocate(MemoryTag tag, std::size_t bytes);
+	static void Free(MemoryTag tag, std::size_t bytes);
+
+	// For resources measured rather than allocated through the tracker.
+	static void SetCurrent(MemoryTag tag, std::size_t bytes);
+
+	// 0 for no budget.
+	static void SetBudget(MemoryTag tag, std::size_t bytes);
+
+	// "tag=KiB,tag=KiB", e.g. "entities=256,textures=8192". False on an
+	// unknown tag or a malformed entry; the entries before it are kept.
+	static bool SetBudgets(const std::string& budgets);
+
+	static std::size_t GetCurrent(MemoryTag tag) { return s_tags[tag].m_current; }
+	static std::size_t GetPeak(MemoryTag tag) { return s_tags[tag].m_peak; }
+	static std::size_t GetAllocations(MemoryTag tag) { return s_tags[tag].m_allocations; }
+	static std::size_t GetBudget(MemoryTag tag) { return s_tags[tag].m_budget; }
+	static bool IsOverBudget(MemoryTag tag) { return s_tags[tag].m_isOverBudget; }
+	static bool IsOverBudget();
+
+	static std::size_t GetTotal();
+	static const char* GetName(MemoryTag tag);
+
+	// One line per tag: current, peak, allocations and budget, in KiB.
+	static void Report(std::ostream& stream);
+
+private:
+	static void Update(MemoryTag tag, std::size_t current);
+
+	struct Counters
+	{
+		std::atomic<std::size_t> m_current{ 0 };
+		std::atomic<std::size_t> m_peak{ 0 };
+		std::atomic<std::size_t> m_allocations{ 0 };
+		std::atomic<std::size_t> m_budget{ 0 };
+		std::atomic<bool> m_isOverBudget{ false };
+	};
+
+	static Counters s_tags[memoryTagCount];
+};
+
+//
+// Standard allocator accounting to a tag. Stateless, so containers of the
+// same tag compare equal and swap or move their storage freely.
+//
+
+template <typename T, MemoryTag Tag>
+class TrackingAllocator
+{
+public:
+	typedef T value_type;
+
+	template <typename U>
+	struct rebind
+	{
+		typedef TrackingAllocator<U, Tag> other;
+	};
+
+	TrackingAllocator() = default;
+
+	template <typename U>
+	TrackingAllocator(const TrackingAllocator<U, Tag>&)
+	{
+	}
+
+	T* allocate(std::size_t count)
+	{
+		T* data = std::allocator<T>().allocate(count);
+		MemoryTracker::Allocate(Tag, count * sizeof(T));
+		return data;
+	}
+
+	void deallocate(T* data, std::size_t count)
+	{
+		MemoryTracker::Free(Tag, count * sizeof(T));
+		std::allocator<T>().deallocate(data, count);
+	}
+};
+
+template <typename T, typename U, MemoryTag Tag>
+bool operator==(const TrackingAllocator<T, Tag>&, const TrackingAllocator<U, Tag>&)
+{
+	return true;
+}
+
+template <typename T, typename U, MemoryTag Tag>
+bool operator!=(const TrackingAllocator<T, Tag>&, const TrackingAllocator<U, Tag>&)
+{
+	return false;
+}
+
+template <typename T, MemoryTag Tag>
+using TrackedVector = std::vector<T, TrackingAllocator<T, Tag>>;
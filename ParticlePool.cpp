@@ -0,0 +1,133 @@
+#include "pch.h"
+#include "ParticlePool.h"
+
+// Pulls debris down, pixels per second squared.
+static const float Gravity = 120.f;
+
+ParticlePool::ParticlePool()
+{
+}
+
+ParticlePool::~ParticlePool()
+{
+	MemoryTracker::Free(memoryParticles, m_x.size() * 4 * sizeof(sf::Vertex));
+}
+
+void ParticlePool::Create(std::size_t capacity)
+{
+	m_count = 0;
+	MemoryTracker::Free(memoryParticles, m_x.size() * 4 * sizeof(sf::Vertex));
+	m_x.assign(capacity, 0.f);
+	m_y.assign(capacity, 0.f);
+	m_vx.assign(capacity, 0.f);
+	m_vy.assign(capacity, 0.f);
+	m_life.assign(capacity, 0.f);
+	m_fade.assign(capacity, 0.f);
+	m_color.assign(capacity, sf::Color::White);
+
+	// Reserve the full vertex storage once; resize() in Draw() then never allocates.
+	m_vertices.setPrimitiveType(sf::Quads);
+	m_vertices.resize(capacity * 4);
+	m_vertices.clear();
+	MemoryTracker::Allocate(memoryParticles, capacity * 4 * sizeof(sf::Vertex));
+}
+
+void ParticlePool::Clear()
+{
+	m_count = 0;
+}
+
+void ParticlePool::Burst(const sf::Vector2f& centre, std::size_t count, float speed, float lifetime, sf::Color color)
+{
+	count = std::min(count, m_x.size() - m_count);
+
+	for (std::size_t i = m_count; i < m_count + count; i++)
+	{
+		// Random direction and speed, a little random lifetime
+		float angle = m_random.NextInt(3600) * (6.2831853f / 3600.f);
+		float velocity = speed * (0.2f + m_random.NextInt(800) / 1000.f);
+		float life = lifetime * (0.5f + m_random.NextInt(500) / 1000.f);
+
+		m_x[i] = centre.x;
+		m_y[i] = centre.y;
+		m_vx[i] = std::cos(angle) * velocity;
+		m_vy[i] = std::sin(angle) * velocity;
+		m_life[i] = life;
+		m_fade[i] = 1.f / life;
+		m_color[i] = color;
+	}
+
+	m_count += count;
+}
+
+void ParticlePool::Update(float seconds)
+{
+	// Integration: independent lanes over plain float arrays, which the
+	// compiler vectorizes.
+	float* x = m_x.data();
+	float* y = m_y.data();
+	float* vx = m_vx.data();
+	float* vy = m_vy.data();
+	float* life = m_life.data();
+	float gravity = Gravity * seconds;
+
+	for (std::size_t i = 0; i < m_count; i++)
+	{
+		x[i] += vx[i] * seconds;
+		y[i] += vy[i] * seconds;
+		vy[i] += gravity;
+		life[i] -= seconds;
+	}
+
+	// Then the dead ones are replaced by the last live particle, so only
+	// the particles that die this frame cost a copy.
+	std::size_t i = 0;
+	while (i < m_count)
+	{
+		if (life[i] > 0.f)
+		{
+			i++;
+			continue;
+		}
+
+		m_count--;
+		x[i] = x[m_count];
+		y[i] = y[m_count];
+		vx[i] = vx[m_count];
+		vy[i] = vy[m_count];
+		life[i] = life[m_count];
+		m_fade[i] = m_fade[m_count];
+		m_color[i] = m_color[m_count];
+	}
+}
+
+void ParticlePool::Draw(sf::RenderTarget& target, float size) const
+{
+	if (m_count == 0)
+	{
+		return;
+	}
+
+	m_vertices.resize(m_count * 4);
+
+	for (std::size_t i = 0; i < m_count; i++)
+	{
+		float x = m_x[i];
+		float y = m_y[i];
+		sf::Color color = m_color[i];
+		color.a = static_cast<sf::Uint8>(255.f * std::min(1.f, m_life[i] * m_fade[i]));
+		sf::Vertex* quad = &m_vertices[i * 4];
+
+		quad[0].position = sf::Vector2f(x, y);
+		quad[1].position = sf::Vector2f(x + size, y);
+		quad[2].position = sf::Vector2f(x + size, y + size);
+		quad[3].position = sf::Vector2f(x, y + size);
+
+		quad[0].color = color;
+		quad[1].color = color;
+		quad[2].color = color;
+		quad[3].color = color;
+	}
+
+	target.draw(m_vertices);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "Random.h"
+#include "MemoryTracker.h"
+
+//
+// Fixed-capacity pool of short-lived particles for explosions and debris.
+// Purely visual: Game owns it and feeds it from the events of each tick,
+// the simulation never sees it. Like ProjectilePool the particles are kept
+// as separate arrays, packed at the front; Update() integrates them in a
+// straight loop over those arrays, with no branch, before a second pass
+// drops the dead ones. Draw() issues one draw call for the whole pool.
+// The arrays and the vertex scratch are accounted to memoryParticles.
+//
+
+class ParticlePool
+{
+public:
+	ParticlePool();
+	~ParticlePool();
+
+public:
+	void Create(std::size_t capacity);
+	void Clear();
+
+	// count particles flying out of centre at up to speed pixels per second,
+	// living lifetime seconds. Whatever does not fit is not spawned.
+	void Burst(const sf::Vector2f& centre, std::size_t count, float speed, float lifetime, sf::Color color);
+
+	void Update(float seconds);
+
+	// Square particles of size pixels, fading out as they age.
+	void Draw(sf::RenderTarget& target, float size) const;
+
+	std::size_t GetCount() const { return m_count; }
+	std::size_t GetCapacity() const { return m_x.size(); }
+
+private:
+	std::size_t m_count = 0;
+	TrackedVector<float, memoryParticles> m_x;
+	TrackedVector<float, memoryParticles> m_y;
+	TrackedVector<float, memoryParticles> m_vx;
+	TrackedVector<float, memoryParticles> m_vy;
+	TrackedVector<float, memoryParticles> m_life;			// seconds left
+	TrackedVector<float, memoryParticles> m_fade;			// 1 / lifetime
+	TrackedVector<sf::Color, memoryParticles> m_color;
+
+	Random m_random;
+	mutable sf::VertexArray m_vertices;	// scratch of Draw()
+};
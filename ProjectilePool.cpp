@@ -0,0 +1,230 @@
+#include "pch.h"
+#include "ProjectilePool.h"
+#include "GameState.h"
+
+ProjectilePool::ProjectilePool()
+{
+}
+
+ProjectilePool::~ProjectilePool()
+{
+	MemoryTracker::Free(memoryProjectiles, m_x.size() * 4 * sizeof(sf::Vertex));
+}
+
+void ProjectilePool::Create(EntityType type, std::size_t capacity, const sf::Vector2u& size, float top, float bottom)
+{
+	m_type = type;
+	m_width = static_cast<float>(size.x);
+	m_height = static_cast<float>(size.y);
+	m_top = top;
+	m_bottom = bottom;
+
+	// Up to capacity in the field, as many again on their way out
+	std::size_t slots = capacity * 2;
+	m_count = 0;
+	m_leaving = 0;
+	m_limit = capacity;
+	MemoryTracker::Free(memoryProjectiles, m_x.size() * 4 * sizeof(sf::Vertex));
+	m_x.assign(slots, 0.f);
+	m_y.assign(slots, 0.f);
+	m_sweep.assign(slots, 0.f);
+	m_owner.assign(slots, 0);
+
+	// Reserve the full vertex storage once; resize() below then never allocates.
+	m_vertices.setPrimitiveType(sf::Quads);
+	m_vertices.resize(slots * 4);
+	m_vertices.clear();
+	MemoryTracker::Allocate(memoryProjectiles, slots * 4 * sizeof(sf::Vertex));
+}
+
+void ProjectilePool::Clear()
+{
+	m_count = 0;
+	m_leaving = 0;
+}
+
+bool ProjectilePool::Spawn(float x, float y, int owner)
+{
+	if (IsFull() == true || m_count == m_x.size())
+	{
+		return false;
+	}
+
+	m_x[m_count] = x;
+	m_y[m_count] = y;
+	m_sweep[m_count] = 0.f;
+	m_owner[m_count] = static_cast<unsigned char>(owner);
+	m_count++;
+	if (IsOutside(y) == true)
+	{
+		m_leaving++;
+	}
+	return true;
+}
+
+std::size_t ProjectilePool::GetOwnedCount(int owner) const
+{
+	std::size_t count = 0;
+	for (std::size_t i = 0; i < m_count; i++)
+	{
+		count += m_owner[i] == owner && IsOutside(m_y[i]) == false ? 1 : 0;
+	}
+	return count;
+}
+
+void ProjectilePool::Kill(std::size_t i)
+{
+	if (IsOutside(m_y[i]) == true)
+	{
+		m_leaving--;
+	}
+
+	m_count--;
+	m_x[i] = m_x[m_count];
+	m_y[i] = m_y[m_count];
+	m_sweep[i] = m_sweep[m_count];
+	m_owner[i] = m_owner[m_count];
+}
+
+sf::FloatRect ProjectilePool::GetSweptBounds(std::size_t i) const
+{
+	float sweep = m_sweep[i];
+	float top = sweep > 0.f ? m_y[i] - sweep : m_y[i];
+	return sf::FloatRect(m_x[i], top, m_width, m_height + std::abs(sweep));
+}
+
+bool ProjectilePool::Sweep(std::size_t i, const sf::FloatRect& target, float& time) const
+{
+	float x = m_x[i];
+	if (x + m_width <= target.left || x >= target.left + target.width)
+	{
+		return false;
+	}
+
+	// Along y only: the boxes overlap while start + sweep * t lies strictly
+	// between the two entry and exit positions.
+	float sweep = m_sweep[i];
+	float start = m_y[i] - sweep;
+	float entry = target.top - m_height;
+	float exit = target.top + target.height;
+	if (sweep == 0.f)
+	{
+		time = 0.f;
+		return start > entry && start < exit;
+	}
+
+	float enter = (entry - start) / sweep;
+	float leave = (exit - start) / sweep;
+	if (sweep < 0.f)
+	{
+		std::swap(enter, leave);
+	}
+
+	if (enter >= 1.f || leave <= 0.f)
+	{
+		return false;
+	}
+
+	time = std::max(enter, 0.f);
+	return true;
+}
+
+void ProjectilePool::Move(float dy)
+{
+	std::size_t i = 0;
+	while (i < m_count)
+	{
+		if (IsOutside(m_y[i]) == true)
+		{
+			Kill(i);
+			continue;
+		}
+
+		float y = m_y[i] + dy;
+		m_y[i] = y;
+		m_sweep[i] = dy;
+		if (IsOutside(y) == true)
+		{
+			m_leaving++;
+		}
+		i++;
+	}
+}
+
+void ProjectilePool::Draw(sf::RenderTarget& target, const sf::Texture& texture) const
+{
+	if (m_count == 0)
+	{
+		return;
+	}
+
+	m_vertices.resize(m_count * 4);
+
+	for (std::size_t i = 0; i < m_count; i++)
+	{
+		float x = m_x[i];
+		float y = m_y[i];
+		sf::Vertex* quad = &m_vertices[i * 4];
+
+		quad[0].position = sf::Vector2f(x, y);
+		quad[1].position = sf::Vector2f(x + m_width, y);
+		quad[2].position = sf::Vector2f(x + m_width, y + m_height);
+		quad[3].position = sf::Vector2f(x, y + m_height);
+
+		quad[0].texCoords = sf::Vector2f(0.f, 0.f);
+		quad[1].texCoords = sf::Vector2f(m_width, 0.f);
+		quad[2].texCoords = sf::Vector2f(m_width, m_height);
+		quad[3].texCoords = sf::Vector2f(0.f, m_height);
+	}
+
+	target.draw(m_vertices, sf::RenderStates(&texture));
+}
+
+void ProjectilePool::Save(StateWriter& writer) const
+{
+	std::uint32_t count = static_cast<std::uint32_t>(m_count);
+	writer.Write(count);
+	writer.Write(m_x.data(), m_count * sizeof(float));
+	writer.Write(m_y.data(), m_count * sizeof(float));
+	writer.Write(m_sweep.data(), m_count * sizeof(float));
+	writer.Write(m_owner.data(), m_count);
+}
+
+bool ProjectilePool::Check(StateReader& reader) const
+{
+	std::uint32_t count = 0;
+	if (reader.Read(count) == false || count > m_x.size())
+	{
+		reader.Fail();
+		return false;
+	}
+
+	// x, y and sweep, then the owner
+	return reader.Skip(count * (3 * sizeof(float) + 1));
+}
+
+bool ProjectilePool::Load(StateReader& reader)
+{
+	std::uint32_t count = 0;
+	if (reader.Read(count) == false || count > m_x.size())
+	{
+		reader.Fail();
+		return false;
+	}
+
+	m_count = count;
+	reader.Read(m_x.data(), m_count * sizeof(float));
+	reader.Read(m_y.data(), m_count * sizeof(float));
+	reader.Read(m_sweep.data(), m_count * sizeof(float));
+	reader.Read(m_owner.data(), m_count);
+
+	m_leaving = 0;
+	for (std::size_t i = 0; i < m_count; i++)
+	{
+		if (IsOutside(m_y[i]) == true)
+		{
+			m_leaving++;
+		}
+	}
+	return reader.IsOk();
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include "Entity.h"
+#include "MemoryTracker.h"
+
+class StateWriter;
+class StateReader;
+
+//
+// Fixed-capacity pool of projectiles of one type. Positions are stored as
+// separate x / y arrays and live projectiles are kept packed at the front,
+// so moves and collision loops walk contiguous memory. The pool never
+// allocates after Create(). It holds no texture, so simulations can run
+// without a window; Draw() takes the texture of the projectile type.
+//
+// Each projectile also keeps the distance of its last move, so collisions
+// can test the whole path it swept since the previous tick instead of its
+// end position only: fast projectiles cannot tunnel through a target. A
+// projectile that leaves the field stays one more move, for its way out
+// to be tested too; it no longer counts against the limit, and the arrays
+// have room for twice the capacity to hold it. The arrays and the vertex
+// scratch are accounted to memoryProjectiles.
+//
+
+class ProjectilePool
+{
+public:
+	ProjectilePool();
+	~ProjectilePool();
+
+public:
+	// Projectiles live in [top, bottom) vertically.
+	void Create(EntityType type, std::size_t capacity, const sf::Vector2u& size, float top, float bottom);
+	void Clear();
+
+	// Caps the live projectiles below the capacity, e.g. per level.
+	void SetLimit(std::size_t limit) { m_limit = std::min(limit, m_x.size() / 2); }
+
+	// Returns false when the pool is full. The owner is the player who
+	// fired, for scoring.
+	bool Spawn(float x, float y, int owner = 0);
+
+	// Kills projectile i by moving the last live one into its slot, so a
+	// loop calling Kill(i) must test index i again.
+	void Kill(std::size_t i);
+
+	std::size_t GetCount() const { return m_count; }
+	std::size_t GetCapacity() const { return m_x.size(); }
+	bool IsFull() const { return m_count - m_leaving >= m_limit; }
+
+	// Live projectiles of one owner still in the field, those that count
+	// against its share of the limit.
+	std::size_t GetOwnedCount(int owner) const;
+	EntityType GetType() const { return m_type; }
+
+	float GetX(std::size_t i) const { return m_x[i]; }
+	float GetY(std::size_t i) const { return m_y[i]; }
+	int GetOwner(std::size_t i) const { return m_owner[i]; }
+	sf::FloatRect GetBounds(std::size_t i) const { return sf::FloatRect(m_x[i], m_y[i], m_width, m_height); }
+
+	// Distance of the last move, 0 for a projectile spawned since.
+	float GetSweep(std::size_t i) const { return m_sweep[i]; }
+
+	// The bounds stretched back over the last move.
+	sf::FloatRect GetSweptBounds(std::size_t i) const;
+
+	// Time of impact of the last move against a still rectangle: 0 at the
+	// position before the move, 1 at the current one. False when the path
+	// does not touch the rectangle.
+	bool Sweep(std::size_t i, const sf::FloatRect& target, float& time) const;
+
+	// Moves every projectile vertically. Those that had left the field are
+	// killed instead, their way out has been through a collision pass.
+	void Move(float dy);
+
+	// One draw call for the whole pool.
+	void Draw(sf::RenderTarget& target, const sf::Texture& texture) const;
+
+	// Live projectiles only.
+	void Save(StateWriter& writer) const;
+	bool Load(StateReader& reader);
+
+	// Reads past a saved pool without loading it; false when it does not
+	// fit this one.
+	bool Check(StateReader& reader) const;
+
+private:
+	bool IsOutside(float y) const { return y <= m_top || y >= m_bottom; }
+
+private:
+	EntityType m_type = EntityType::weapon;
+	float m_width = 0.f;
+	float m_height = 0.f;
+	float m_top = 0.f;
+	float m_bottom = 0.f;
+
+	std::size_t m_count = 0;
+	std::size_t m_leaving = 0;		// live ones outside the field
+	std::size_t m_limit = 0;
+	TrackedVector<float, memoryProjectiles> m_x;
+	TrackedVector<float, memoryProjectiles> m_y;
+	TrackedVector<float, memoryProjectiles> m_sweep;
+	TrackedVector<unsigned char, memoryProjectiles> m_owner;
+	mutable sf::VertexArray m_vertices;	// scratch of Draw()
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+// Small deterministic generator (xorshift64*). Unlike rand() its whole
+// state is one integer, so it can be saved, restored and replayed.
+class Random
+{
+public:
+	explicit Random(std::uint64_t seed = 1978) { Seed(seed); }
+
+	void Seed(std::uint64_t seed) { m_state = seed != 0 ? seed : 0x9E3779B97F4A7C15ull; }
+
+	std::uint64_t Next()
+	{
+		m_state ^= m_state >> 12;
+		m_state ^= m_state << 25;
+		m_state ^= m_state >> 27;
+		return m_state * 0x2545F4914F6CDD1Dull;
+	}
+
+	// Uniform in [0, bound).
+	int NextInt(int bound) { return static_cast<int>((Next() >> 33) % static_cast<std::uint64_t>(bound)); }
+
+	std::uint64_t m_state;
+};
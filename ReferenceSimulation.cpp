@@ -0,0 +1,919 @@
+#include "pch.h"
+#include "ReferenceSimulation.h"
+#include "GameState.h"
+
+// Indices of m_Shots and m_Fire
+#define SHOTS_PLAYER 0
+#define SHOTS_ENEMY 1
+#define SHOTS_MASTER 2
+
+// The crater of Shield::Damage(), '#' = pixel removed
+#define REFERENCE_CRATER_SIZE 8
+static const char* ReferenceCrater[REFERENCE_CRATER_SIZE] =
+{
+	"#..#..#.",
+	"..####..",
+	".######.",
+	"########",
+	"########",
+	".######.",
+	"..####.#",
+	".#..#...",
+};
+
+//
+// Shields
+//
+
+void ReferenceShield::Create(const sf::Image& image)
+{
+	m_width = static_cast<int>(image.getSize().x);
+	m_height = static_cast<int>(image.getSize().y);
+	m_original.assign(m_width * m_height, false);
+	for (int y = 0; y < m_height; y++)
+	{
+		for (int x = 0; x < m_width; x++)
+		{
+			m_original[y * m_width + x] = image.getPixel(x, y).a != 0;
+		}
+	}
+	Reset();
+}
+
+bool ReferenceShield::HitTest(const sf::FloatRect& bounds, bool movingUp, int& hitX, int& hitY) const
+{
+	// Every pixel the bounds cover, even in part
+	int left = std::max(0, static_cast<int>(std::floor(bounds.left - m_position.x)));
+	int right = std::min(m_width, static_cast<int>(std::ceil(bounds.left + bounds.width - m_position.x)));
+	int top = std::max(0, static_cast<int>(std::floor(bounds.top - m_position.y)));
+	int bottom = std::min(m_height, static_cast<int>(std::ceil(bounds.top + bounds.height - m_position.y)));
+
+	// The first row along the direction of travel with an opaque pixel
+	for (int i = 0; i < bottom - top; i++)
+	{
+		int y = movingUp ? bottom - 1 - i : top + i;
+		for (int x = left; x < right; x++)
+		{
+			if (IsOpaque(x, y) == true)
+			{
+				hitX = (left + right) / 2;
+				hitY = y;
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+void ReferenceShield::Damage(int x, int y)
+{
+	int left = x - REFERENCE_CRATER_SIZE / 2;
+	int top = y - REFERENCE_CRATER_SIZE / 2;
+	for (int row = 0; row < REFERENCE_CRATER_SIZE; row++)
+	{
+		for (int col = 0; col < REFERENCE_CRATER_SIZE; col++)
+		{
+			int px = left + col;
+			int py = top + row;
+			if (ReferenceCrater[row][col] == '#' && px >= 0 && px < m_width && py >= 0 && py < m_height)
+			{
+				m_pixels[py * m_width + px] = false;
+			}
+		}
+	}
+}
+
+void ReferenceShield::Save(StateWriter& writer) const
+{
+	int words = (m_width + 63) / 64;
+	for (int y = 0; y < m_height; y++)
+	{
+		for (int word = 0; word < words; word++)
+		{
+			std::uint64_t bits = 0;
+			for (int x = word * 64; x < std::min(m_width, word * 64 + 64); x++)
+			{
+				if (IsOpaque(x, y) == true)
+				{
+					bits |= std::uint64_t(1) << (x - word * 64);
+				}
+			}
+			writer.Write(&bits, sizeof(bits));
+		}
+	}
+}
+
+//
+// Simulation
+//
+
+void ReferenceSimulation::Init(const GameSettings& settings, const LevelSet& levels, const SimulationAssets& assets)
+{
+	m_Settings = settings;
+	m_Settings.m_players = std::max(1, std::min(MAX_PLAYERS, settings.m_players));
+	m_Levels = &levels;
+	m_Random.Seed(m_Settings.m_seed);
+	m_Tick = 0;
+	m_IsGameOver = false;
+
+	for (int i = 0; i < MAX_PLAYERS; i++)
+	{
+		m_Lives[i] = i < m_Settings.m_players ? 3 : 0;
+		m_Score[i] = 0;
+	}
+
+	// Room for the most demanding level
+	WeaponSettings fire[3];
+	fire[SHOTS_PLAYER].m_capacity = levels.GetMaxCapacity(&LevelDefinition::m_player);
+	fire[SHOTS_ENEMY].m_capacity = levels.GetMaxCapacity(&LevelDefinition::m_enemy);
+	fire[SHOTS_MASTER].m_capacity = levels.GetMaxCapacity(&LevelDefinition::m_enemyMaster);
+	m_Settings.ApplyStressMode(fire[SHOTS_PLAYER], fire[SHOTS_ENEMY], fire[SHOTS_MASTER]);
+	fire[SHOTS_PLAYER].m_capacity *= m_Settings.m_players;
+
+	const sf::Vector2u* sizes[3] = { &assets.m_weapon, &assets.m_enemyWeapon, &assets.m_enemyMasterWeapon };
+	for (int i = 0; i < 3; i++)
+	{
+		m_Shots[i].m_projectiles.clear();
+		m_Shots[i].m_size = sf::Vector2f(*sizes[i]);
+		m_Shots[i].m_slots = fire[i].m_capacity * 2;
+		m_Shots[i].m_limit = fire[i].m_capacity;
+	}
+
+	m_Entities.clear();
+
+	for (int i = 0; i < m_Settings.m_players; i++)
+	{
+		ReferenceEntity player;
+		player.m_type = EntityType::player;
+		player.m_size = assets.m_player;
+		player.m_index = i;
+		m_Entities.push_back(player);
+	}
+
+	ReferenceEntity master;
+	master.m_type = EntityType::enemyMaster;
+	master.m_size = assets.m_enemyMaster;
+	m_Entities.push_back(master);
+
+	for (int i = 0; i < levels.GetMaxEnemies(); i++)
+	{
+		ReferenceEntity enemy;
+		enemy.m_type = EntityType::enemy;
+		enemy.m_size = assets.m_enemy;
+		m_Entities.push_back(enemy);
+	}
+
+	m_Shields.resize(levels.GetMaxShields());
+	for (std::size_t i = 0; i < m_Shields.size(); i++)
+	{
+		m_Shields[i].Create(assets.m_block);
+
+		ReferenceEntity block;
+		block.m_type = EntityType::block;
+		block.m_size = assets.m_block.getSize();
+		m_Entities.push_back(block);
+	}
+
+	LoadLevel(0);
+}
+
+void ReferenceSimulation::LoadLevel(std::size_t index)
+{
+	m_LevelIndex = index % m_Levels->GetCount();
+	const LevelDefinition& level = m_Levels->Get(m_LevelIndex);
+
+	m_Fire[SHOTS_PLAYER] = level.m_player;
+	m_Fire[SHOTS_ENEMY] = level.m_enemy;
+	m_Fire[SHOTS_MASTER] = level.m_enemyMaster;
+	m_Settings.ApplyStressMode(m_Fire[SHOTS_PLAYER], m_Fire[SHOTS_ENEMY], m_Fire[SHOTS_MASTER]);
+
+	// The players share the pool, each with the capacity of the level.
+	m_Shots[SHOTS_PLAYER].m_limit = std::min(m_Fire[SHOTS_PLAYER].m_capacity * m_Settings.m_players, m_Shots[SHOTS_PLAYER].m_slots / 2);
+	m_Shots[SHOTS_ENEMY].m_limit = std::min(m_Fire[SHOTS_ENEMY].m_capacity, m_Shots[SHOTS_ENEMY].m_slots / 2);
+	m_Shots[SHOTS_MASTER].m_limit = std::min(m_Fire[SHOTS_MASTER].m_capacity, m_Shots[SHOTS_MASTER].m_slots / 2);
+
+	m_ShieldCount = level.m_shields.size();
+	for (std::size_t i = 0; i < m_ShieldCount; i++)
+	{
+		m_Shields[i].SetPosition(level.m_shields[i]);
+	}
+
+	// Enemies fill the cells column by column, the slots left over are unused.
+	int cell = 0;
+	int cells = level.m_columns * level.m_rows;
+	int shield = 0;
+	for (ReferenceEntity& entity : m_Entities)
+	{
+		switch (entity.m_type)
+		{
+		case EntityType::player:
+			entity.m_enabled = true;
+			entity.m_position = sf::Vector2f(100.f + 500.f * entity.m_index, 500.f);
+			break;
+
+		case EntityType::enemyMaster:
+			entity.m_enabled = true;
+			entity.m_position = sf::Vector2f(level.m_masterLeft, 1.f);
+			entity.m_bLeftToRight = true;
+			entity.m_times = 0;
+			entity.m_score = 100;
+			break;
+
+		case EntityType::enemy:
+			while (cell < cells && level.m_grid[(cell % level.m_rows) * level.m_columns + cell / level.m_rows] == LEVEL_EMPTY_CELL)
+			{
+				cell++;
+			}
+
+			entity.m_bLeftToRight = true;
+			entity.m_times = 0;
+			entity.m_score = 0;
+			entity.m_column = -1;
+			entity.m_row = -1;
+			entity.m_enabled = cell < cells;
+			if (entity.m_enabled == true)
+			{
+				int i = cell / level.m_rows;
+				int j = cell % level.m_rows;
+				entity.m_index = level.m_grid[j * level.m_columns + i];
+				entity.m_position = sf::Vector2f(level.m_origin.x + level.m_spacing.x * i, level.m_origin.y + level.m_spacing.y * j);
+				entity.m_score = m_Levels->GetEnemyType(static_cast<unsigned char>(entity.m_index)).m_score;
+				entity.m_column = i;
+				entity.m_row = j;
+				cell++;
+			}
+			break;
+
+		case EntityType::block:
+			entity.m_enabled = static_cast<std::size_t>(shield) < m_ShieldCount;
+			entity.m_index = shield;
+			entity.m_position = m_Shields[shield].GetPosition();
+			shield++;
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	m_LevelEntities = m_Entities;
+	ResetWave();
+}
+
+void ReferenceSimulation::ResetWave()
+{
+	m_Entities = m_LevelEntities;
+
+	// Players out of lives stay out.
+	for (ReferenceEntity& entity : m_Entities)
+	{
+		if (entity.m_type == EntityType::player && m_Lives[entity.m_index] == 0)
+		{
+			entity.m_enabled = false;
+		}
+	}
+
+	m_IsInvaded = false;
+	m_IsGameOver = false;
+	for (Shots& shots : m_Shots)
+	{
+		shots.m_projectiles.clear();
+	}
+	m_EnemyCooldown = 0;
+	m_EnemyMasterCooldown = 0;
+
+	for (int i = 0; i < MAX_PLAYERS; i++)
+	{
+		m_PlayerCooldown[i] = 0;
+	}
+
+	for (std::size_t i = 0; i < m_ShieldCount; i++)
+	{
+		m_Shields[i].Reset();
+	}
+}
+
+void ReferenceSimulation::Step(const PlayerInput* inputs)
+{
+	if (m_IsGameOver == true)
+		return;
+
+	MovePlayers(inputs);
+	CheckWave();
+
+	// Every pass reads the state as it is before any hit applies.
+	std::vector<Hit> hits;
+	FindTargetHits(SHOTS_PLAYER, EntityType::enemy, hits);
+	FindTargetHits(SHOTS_ENEMY, EntityType::player, hits);
+	if (m_Settings.m_versus == true)
+	{
+		FindTargetHits(SHOTS_PLAYER, EntityType::player, hits);
+	}
+	FindShieldHits(SHOTS_PLAYER, hits);
+	FindShieldHits(SHOTS_ENEMY, hits);
+	FindShieldHits(SHOTS_MASTER, hits);
+	FindTargetHits(SHOTS_MASTER, EntityType::player, hits);
+	FindInvasion(hits);
+	FindTargetHits(SHOTS_PLAYER, EntityType::enemyMaster, hits);
+	ApplyHits(hits);
+
+	Move(m_Shots[SHOTS_PLAYER], -m_Fire[SHOTS_PLAYER].m_speed);
+	Move(m_Shots[SHOTS_ENEMY], m_Fire[SHOTS_ENEMY].m_speed);
+	Move(m_Shots[SHOTS_MASTER], m_Fire[SHOTS_MASTER].m_speed);
+	MoveEnemies();
+	MoveMaster();
+
+	for (int i = 0; i < MAX_PLAYERS; i++)
+	{
+		if (m_PlayerCooldown[i] > 0)
+			m_PlayerCooldown[i]--;
+	}
+	if (m_EnemyCooldown > 0)
+		m_EnemyCooldown--;
+	if (m_EnemyMasterCooldown > 0)
+		m_EnemyMasterCooldown--;
+
+	FireEnemies();
+	FireMaster();
+
+	m_Tick++;
+}
+
+void ReferenceSimulation::CheckWave()
+{
+	int count = 0;
+	for (const ReferenceEntity& entity : m_Entities)
+	{
+		if ((entity.m_type == EntityType::enemy || entity.m_type == EntityType::enemyMaster) && entity.m_enabled == true)
+		{
+			count++;
+		}
+	}
+
+	if (count == 0 && IsAnyPlayerAlive() == true)
+	{
+		LoadLevel(m_LevelIndex + 1);
+		return;
+	}
+
+	if (IsAnyPlayerAlive() == false)
+	{
+		m_IsGameOver = true;
+		return;
+	}
+
+	if (m_IsInvaded == true)
+	{
+		ResetWave();
+	}
+}
+
+//
+// Moves and fire
+//
+
+void ReferenceSimulation::MovePlayers(const PlayerInput* inputs)
+{
+	for (ReferenceEntity& entity : m_Entities)
+	{
+		if (entity.m_type != EntityType::player || entity.m_enabled == false)
+		{
+			continue;
+		}
+
+		int player = entity.m_index;
+		const PlayerInput& input = inputs[player];
+
+		sf::Vector2f movement(0.f, 0.f);
+		if (input.IsDown(PlayerInput::Up))
+			movement.y -= Simulation::PlayerSpeed;
+		if (input.IsDown(PlayerInput::Down))
+			movement.y += Simulation::PlayerSpeed;
+		if (input.IsDown(PlayerInput::Left))
+			movement.x -= Simulation::PlayerSpeed;
+		if (input.IsDown(PlayerInput::Right))
+			movement.x += Simulation::PlayerSpeed;
+
+		entity.m_position += movement / static_cast<float>(Simulation::TicksPerSecond);
+
+		if (input.IsDown(PlayerInput::Fire) == false)
+		{
+			continue;
+		}
+
+		Shots& shots = m_Shots[SHOTS_PLAYER];
+		if (m_PlayerCooldown[player] > 0 || IsFull(shots) == true || GetInField(shots, player) >= m_Fire[SHOTS_PLAYER].m_capacity)
+		{
+			continue;
+		}
+
+		Spawn(shots, entity.m_position.x + entity.m_size.x / 2, entity.m_position.y - 10, player);
+		m_PlayerCooldown[player] = m_Fire[SHOTS_PLAYER].m_cooldown;
+	}
+}
+
+void ReferenceSimulation::MoveEnemies()
+{
+	const LevelDefinition& level = m_Levels->Get(m_LevelIndex);
+	for (ReferenceEntity& entity : m_Entities)
+	{
+		if (entity.m_type != EntityType::enemy || entity.m_enabled == false)
+		{
+			continue;
+		}
+
+		float x = entity.m_position.x;
+		float y = entity.m_position.y;
+		if (entity.m_bLeftToRight == true)
+			x += level.m_enemySpeed;
+		else
+			x -= level.m_enemySpeed;
+		entity.m_times++;
+
+		// Right, then left and one step down
+		if (entity.m_times >= level.m_enemyMarch)
+		{
+			if (entity.m_bLeftToRight == false)
+			{
+				y += level.m_enemyDrop;
+			}
+			entity.m_bLeftToRight = !entity.m_bLeftToRight;
+			entity.m_times = 0;
+		}
+
+		entity.m_position = sf::Vector2f(x, y);
+	}
+}
+
+void ReferenceSimulation::MoveMaster()
+{
+	const LevelDefinition& level = m_Levels->Get(m_LevelIndex);
+	for (ReferenceEntity& entity : m_Entities)
+	{
+		if (entity.m_type != EntityType::enemyMaster || entity.m_enabled == false)
+		{
+			continue;
+		}
+
+		float x = entity.m_position.x;
+		if (entity.m_bLeftToRight == true)
+			x += level.m_masterSpeed;
+		else
+			x -= level.m_masterSpeed;
+		entity.m_times++;
+
+		if (x >= level.m_masterRight || x <= level.m_masterLeft)
+		{
+			entity.m_bLeftToRight = !entity.m_bLeftToRight;
+			entity.m_times = 0;
+		}
+
+		entity.m_position.x = x;
+	}
+}
+
+void ReferenceSimulation::FireEnemies()
+{
+	if (m_EnemyCooldown > 0)
+		return;
+
+	// The column whose shooter is closest to the target rolls first, then
+	// the others outwards: 0, +1, -1, +2, -2...
+	int columns = m_Levels->Get(m_LevelIndex).m_columns;
+	int aimed = 0;
+	float target;
+	if (GetTargetX(target) == true)
+	{
+		float closest = Simulation::FieldWidth;
+		for (int column = 0; column < columns; column++)
+		{
+			int shooter = GetShooter(column);
+			if (shooter < 0)
+			{
+				continue;
+			}
+
+			const ReferenceEntity& enemy = m_Entities[shooter];
+			float distance = std::abs(enemy.m_position.x + enemy.m_size.x / 2 - target);
+			if (distance < closest)
+			{
+				closest = distance;
+				aimed = column;
+			}
+		}
+	}
+
+	Shots& shots = m_Shots[SHOTS_ENEMY];
+	const WeaponSettings& fire = m_Fire[SHOTS_ENEMY];
+	int fired = 0;
+	for (int k = 0; k < 2 * columns; k++)
+	{
+		if (IsFull(shots) == true || fired >= fire.m_shotsPerTick)
+		{
+			break;
+		}
+
+		int column = aimed + ((k & 1) != 0 ? (k + 1) / 2 : -(k / 2));
+		int shooter = column >= 0 && column < columns ? GetShooter(column) : -1;
+		if (shooter < 0 || m_Random.NextInt(fire.m_chance) != 0)
+		{
+			continue;
+		}
+
+		const ReferenceEntity& enemy = m_Entities[shooter];
+		Spawn(shots, enemy.m_position.x + enemy.m_size.x / 2, enemy.m_position.y - 10, 0);
+		fired++;
+	}
+
+	if (fired > 0)
+	{
+		m_EnemyCooldown = fire.m_cooldown;
+	}
+}
+
+void ReferenceSimulation::FireMaster()
+{
+	Shots& shots = m_Shots[SHOTS_MASTER];
+	if (m_EnemyMasterCooldown > 0 || IsFull(shots) == true)
+		return;
+
+	for (const ReferenceEntity& entity : m_Entities)
+	{
+		if (entity.m_type != EntityType::enemyMaster || entity.m_enabled == false)
+		{
+			continue;
+		}
+
+		if (m_Random.NextInt(m_Fire[SHOTS_MASTER].m_chance) != 0)
+			return;
+
+		float y = entity.m_position.y - 1;
+		Spawn(shots, entity.m_position.x + entity.m_size.x / 2, y + entity.m_size.y, 0);
+		m_EnemyMasterCooldown = m_Fire[SHOTS_MASTER].m_cooldown;
+		return;
+	}
+}
+
+//
+// Projectiles
+//
+
+bool ReferenceSimulation::IsOutside(float y)
+{
+	return y <= 0.f || y >= Simulation::FieldHeight;
+}
+
+std::size_t ReferenceSimulation::GetInField(const Shots& shots, int owner) const
+{
+	std::size_t count = 0;
+	for (const ReferenceProjectile& projectile : shots.m_projectiles)
+	{
+		if ((owner < 0 || projectile.m_owner == owner) && IsOutside(projectile.m_y) == false)
+		{
+			count++;
+		}
+	}
+	return count;
+}
+
+bool ReferenceSimulation::IsFull(const Shots& shots) const
+{
+	return GetInField(shots, -1) >= shots.m_limit;
+}
+
+void ReferenceSimulation::Spawn(Shots& shots, float x, float y, int owner)
+{
+	if (IsFull(shots) == true || shots.m_projectiles.size() == shots.m_slots)
+	{
+		return;
+	}
+
+	ReferenceProjectile projectile;
+	projectile.m_x = x;
+	projectile.m_y = y;
+	projectile.m_owner = owner;
+	shots.m_projectiles.push_back(projectile);
+}
+
+void ReferenceSimulation::Kill(Shots& shots, std::size_t i)
+{
+	shots.m_projectiles[i] = shots.m_projectiles.back();
+	shots.m_projectiles.pop_back();
+}
+
+void ReferenceSimulation::Move(Shots& shots, float dy)
+{
+	// A projectile outside the field had its last collision passes, it goes.
+	std::size_t i = 0;
+	while (i < shots.m_projectiles.size())
+	{
+		ReferenceProjectile& projectile = shots.m_projectiles[i];
+		if (IsOutside(projectile.m_y) == true)
+		{
+			Kill(shots, i);
+			continue;
+		}
+
+		projectile.m_y += dy;
+		projectile.m_sweep = dy;
+		i++;
+	}
+}
+
+bool ReferenceSimulation::Sweep(const Shots& shots, const ReferenceProjectile& projectile, const sf::FloatRect& target, float& time)
+{
+	if (projectile.m_x + shots.m_size.x <= target.left || projectile.m_x >= target.left + target.width)
+	{
+		return false;
+	}
+
+	// Overlap along y while start + sweep * t is strictly between the entry and exit positions
+	float start = projectile.m_y - projectile.m_sweep;
+	float entry = target.top - shots.m_size.y;
+	float exit = target.top + target.height;
+	if (projectile.m_sweep == 0.f)
+	{
+		time = 0.f;
+		return start > entry && start < exit;
+	}
+
+	float enter = (entry - start) / projectile.m_sweep;
+	float leave = (exit - start) / projectile.m_sweep;
+	if (projectile.m_sweep < 0.f)
+	{
+		std::swap(enter, leave);
+	}
+
+	if (enter >= 1.f || leave <= 0.f)
+	{
+		return false;
+	}
+
+	time = std::max(enter, 0.f);
+	return true;
+}
+
+//
+// Collisions
+//
+
+void ReferenceSimulation::FindTargetHits(int shots, EntityType target, std::vector<Hit>& hits) const
+{
+	// The target met first along the last move counts; a player's own shots pass through it.
+	const std::vector<ReferenceProjectile>& projectiles = m_Shots[shots].m_projectiles;
+	for (std::size_t i = 0; i < projectiles.size(); i++)
+	{
+		int owner = shots == SHOTS_PLAYER ? projectiles[i].m_owner : -1;
+		Hit hit;
+		bool isHit = false;
+
+		std::size_t row = 0;
+		for (const ReferenceEntity& entity : m_Entities)
+		{
+			if (entity.m_type != target)
+			{
+				continue;
+			}
+
+			float time;
+			if (entity.m_enabled == true && (target != EntityType::player || owner != entity.m_index) &&
+				Sweep(m_Shots[shots], projectiles[i], sf::FloatRect(entity.m_position, sf::Vector2f(entity.m_size)), time) == true &&
+				(isHit == false || time < hit.m_time))
+			{
+				isHit = true;
+				hit.m_target = row;
+				hit.m_time = time;
+			}
+			row++;
+		}
+
+		if (isHit == true)
+		{
+			hit.m_type = target == EntityType::player ? GameEventType::playerHit :
+				target == EntityType::enemy ? GameEventType::enemyKilled : GameEventType::enemyMasterKilled;
+			hit.m_shots = shots;
+			hit.m_projectile = i;
+			hit.m_player = owner;
+			hits.push_back(hit);
+		}
+	}
+}
+
+void ReferenceSimulation::FindShieldHits(int shots, std::vector<Hit>& hits) const
+{
+	// The first opaque row met along the last move, over every shield
+	const Shots& pool = m_Shots[shots];
+	bool movingUp = shots == SHOTS_PLAYER;
+	for (std::size_t i = 0; i < pool.m_projectiles.size(); i++)
+	{
+		const ReferenceProjectile& projectile = pool.m_projectiles[i];
+		float top = projectile.m_sweep > 0.f ? projectile.m_y - projectile.m_sweep : projectile.m_y;
+		sf::FloatRect swept(projectile.m_x, top, pool.m_size.x, pool.m_size.y + std::abs(projectile.m_sweep));
+
+		Hit hit;
+		bool isHit = false;
+		float hitRow = 0.f;
+		for (std::size_t s = 0; s < m_ShieldCount; s++)
+		{
+			int x, y;
+			if (m_Shields[s].HitTest(swept, movingUp, x, y) == false)
+			{
+				continue;
+			}
+
+			float row = m_Shields[s].GetPosition().y + y;
+			if (isHit == false || (movingUp ? row > hitRow : row < hitRow))
+			{
+				isHit = true;
+				hitRow = row;
+				hit.m_target = s;
+				hit.m_x = x;
+				hit.m_y = y;
+			}
+		}
+
+		if (isHit == true)
+		{
+			// When the leading edge reaches that row; left at 1 if the path misses it
+			Sweep(pool, projectile, sf::FloatRect(swept.left, hitRow, swept.width, 1.f), hit.m_time);
+			hit.m_type = GameEventType::shieldHit;
+			hit.m_shots = shots;
+			hit.m_projectile = i;
+			hits.push_back(hit);
+		}
+	}
+}
+
+void ReferenceSimulation::FindInvasion(std::vector<Hit>& hits) const
+{
+	for (const ReferenceEntity& enemy : m_Entities)
+	{
+		if (enemy.m_type != EntityType::enemy || enemy.m_enabled == false)
+		{
+			continue;
+		}
+
+		sf::FloatRect bounds(enemy.m_position, sf::Vector2f(enemy.m_size));
+		for (const ReferenceEntity& block : m_Entities)
+		{
+			if (block.m_type == EntityType::block && block.m_enabled == true &&
+				bounds.intersects(sf::FloatRect(block.m_position, sf::Vector2f(block.m_size))) == true)
+			{
+				Hit hit;
+				hit.m_type = GameEventType::invaded;
+				hits.push_back(hit);
+				return;
+			}
+		}
+	}
+}
+
+void ReferenceSimulation::ApplyHits(std::vector<Hit>& hits)
+{
+	// In order of time, then of the passes. A projectile is spent by its
+	// first hit that takes effect; a hit on a target already gone is void
+	// and the projectile flies on.
+	std::stable_sort(hits.begin(), hits.end(), [](const Hit& a, const Hit& b) { return a.m_time < b.m_time; });
+
+	std::vector<bool> spent[3];
+	for (int i = 0; i < 3; i++)
+	{
+		spent[i].assign(m_Shots[i].m_projectiles.size(), false);
+	}
+
+	// Rows count within the entities of the target type.
+	auto find = [this](EntityType type, std::size_t row) -> ReferenceEntity& {
+		std::size_t first = 0;
+		while (m_Entities[first].m_type != type)
+		{
+			first++;
+		}
+		return m_Entities[first + row];
+	};
+
+	for (const Hit& hit : hits)
+	{
+		if (hit.m_shots >= 0 && spent[hit.m_shots][hit.m_projectile] == true)
+		{
+			continue;
+		}
+
+		switch (hit.m_type)
+		{
+		case GameEventType::enemyKilled:
+		case GameEventType::enemyMasterKilled:
+		{
+			ReferenceEntity& enemy = find(hit.m_type == GameEventType::enemyKilled ? EntityType::enemy : EntityType::enemyMaster, hit.m_target);
+			if (enemy.m_enabled == false)
+			{
+				continue;
+			}
+			enemy.m_enabled = false;
+			m_Score[hit.m_player] += enemy.m_score;
+			break;
+		}
+
+		case GameEventType::playerHit:
+		{
+			ReferenceEntity& player = find(EntityType::player, hit.m_target);
+			if (player.m_enabled == false)
+			{
+				continue;
+			}
+			if (hit.m_player >= 0)
+			{
+				// Versus
+				m_Score[hit.m_player] += 50;
+			}
+			if (m_Settings.m_invulnerable == false)
+			{
+				int& lives = m_Lives[player.m_index];
+				if (lives > 0)
+				{
+					lives--;
+				}
+				player.m_enabled = lives > 0;
+			}
+			break;
+		}
+
+		case GameEventType::shieldHit:
+			m_Shields[hit.m_target].Damage(hit.m_x, hit.m_y);
+			break;
+
+		case GameEventType::invaded:
+			m_IsInvaded = true;
+			break;
+
+		default:
+			break;
+		}
+
+		if (hit.m_shots >= 0)
+		{
+			spent[hit.m_shots][hit.m_projectile] = true;
+		}
+	}
+
+	// Backwards, so a kill only moves a projectile that stays
+	for (int s = 0; s < 3; s++)
+	{
+		for (std::size_t i = spent[s].size(); i-- > 0; )
+		{
+			if (spent[s][i] == true)
+			{
+				Kill(m_Shots[s], i);
+			}
+		}
+	}
+}
+
+//
+// Queries
+//
+
+int ReferenceSimulation::GetShooter(int column) const
+{
+	// Bottom-most live enemy of the column
+	int shooter = -1;
+	for (std::size_t i = 0; i < m_Entities.size(); i++)
+	{
+		const ReferenceEntity& enemy = m_Entities[i];
+		if (enemy.m_type == EntityType::enemy && enemy.m_enabled == true && enemy.m_column == column &&
+			(shooter < 0 || enemy.m_row > m_Entities[shooter].m_row))
+		{
+			shooter = static_cast<int>(i);
+		}
+	}
+	return shooter;
+}
+
+bool ReferenceSimulation::GetTargetX(float& x) const
+{
+	// Each live player in turn, a second at a time
+	std::size_t count = static_cast<std::size_t>(m_Settings.m_players);
+	std::size_t first = static_cast<std::size_t>(m_Tick / Simulation::TicksPerSecond);
+	for (std::size_t i = 0; i < count; i++)
+	{
+		const ReferenceEntity& player = m_Entities[(first + i) % count];
+		if (player.m_enabled == true)
+		{
+			x = player.m_position.x + player.m_size.x / 2;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ReferenceSimulation::IsAnyPlayerAlive() const
+{
+	for (int i = 0; i < m_Settings.m_players; i++)
+	{
+		if (m_Lives[i] > 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
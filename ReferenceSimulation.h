@@ -0,0 +1,172 @@
+#pragma once
+#include "Simulation.h"
+
+//
+// The rules of Simulation written the plain way, as the reference of the
+// differential test. One table holds every entity, in the order of the
+// table that came before the archetypes: players, master, enemies,
+// shields. Projectiles are vectors of structs. Collision tests are
+// brute force, and the shooter of a column is searched for among the
+// enemies. Nothing here is meant to be fast; it is meant to be read.
+//
+// It plays the same rules, to the bit: the same float operations in the
+// same order, the same draws of the random generator, shots killed by
+// moving the last one into their slot as ProjectilePool does, since that
+// order breaks ties between hits. Shields are a flag per pixel, tested one
+// pixel at a time. What Simulation keeps for the other consumers (events,
+// saved states) is left out.
+//
+// Work on the speed of Simulation must not touch this file. A change of
+// the rules lands in both, in the same commit, or the differential test
+// fails on it.
+//
+
+struct ReferenceEntity
+{
+	EntityType m_type = EntityType::player;
+	sf::Vector2f m_position;
+	sf::Vector2u m_size;
+	bool m_enabled = true;
+	int m_index = 0;			// player, enemy type or shield
+
+	// Enemies: cell of the formation, -1 when unused by the level
+	int m_column = -1;
+	int m_row = -1;
+
+	// Enemies and master
+	bool m_bLeftToRight = true;
+	int m_times = 0;
+	int m_score = 0;
+};
+
+struct ReferenceProjectile
+{
+	float m_x = 0.f;
+	float m_y = 0.f;
+	float m_sweep = 0.f;		// distance of the last move, 0 when just fired
+	int m_owner = 0;
+};
+
+// A shield as one flag per pixel, opaque where the alpha of the block
+// image is not 0.
+class ReferenceShield
+{
+public:
+	void Create(const sf::Image& image);
+	void Reset() { m_pixels = m_original; }
+
+	bool HitTest(const sf::FloatRect& bounds, bool movingUp, int& hitX, int& hitY) const;
+	void Damage(int x, int y);
+
+	// The layout of Shield::Save(): a row of 64-bit words per scanline,
+	// bit 0 = leftmost pixel, so both hash the same bytes.
+	void Save(StateWriter& writer) const;
+
+	const sf::Vector2f& GetPosition() const { return m_position; }
+	void SetPosition(const sf::Vector2f& position) { m_position = position; }
+
+private:
+	bool IsOpaque(int x, int y) const { return m_pixels[y * m_width + x]; }
+
+private:
+	int m_width = 0;
+	int m_height = 0;
+	sf::Vector2f m_position;
+	std::vector<bool> m_pixels;
+	std::vector<bool> m_original;
+};
+
+class ReferenceSimulation
+{
+public:
+	void Init(const GameSettings& settings, const LevelSet& levels, const SimulationAssets& assets);
+	void Step(const PlayerInput* inputs);
+
+	const std::vector<ReferenceEntity>& GetEntities() const { return m_Entities; }
+	const std::vector<ReferenceProjectile>& GetProjectiles(EntityType type) const { return m_Shots[type - EntityType::weapon].m_projectiles; }
+	std::size_t GetShieldCount() const { return m_ShieldCount; }
+	const ReferenceShield& GetShield(std::size_t index) const { return m_Shields[index]; }
+
+	int GetPlayerCount() const { return m_Settings.m_players; }
+	int GetLives(int player) const { return m_Lives[player]; }
+	int GetScore(int player) const { return m_Score[player]; }
+	bool IsGameOver() const { return m_IsGameOver; }
+	std::uint64_t GetTick() const { return m_Tick; }
+	std::size_t GetLevel() const { return m_LevelIndex; }
+
+private:
+	// Projectiles of one type: at most m_limit in the field, and room for
+	// twice the largest capacity of the level set, those leaving included.
+	struct Shots
+	{
+		std::vector<ReferenceProjectile> m_projectiles;
+		sf::Vector2f m_size;
+		std::size_t m_slots = 0;
+		std::size_t m_limit = 0;
+	};
+
+	// A collision found by a pass, applied once all passes are done.
+	struct Hit
+	{
+		GameEventType m_type = GameEventType::enemyKilled;
+		int m_shots = -1;			// index of m_Shots, -1 for the invasion
+		std::size_t m_projectile = 0;
+		float m_time = 1.f;
+		int m_player = -1;			// who fired
+		std::size_t m_target = 0;	// entity, or shield
+		int m_x = 0;				// crater, local to the shield
+		int m_y = 0;
+	};
+
+	void LoadLevel(std::size_t index);
+	void ResetWave();
+	void CheckWave();
+
+	void MovePlayers(const PlayerInput* inputs);
+	void MoveEnemies();
+	void MoveMaster();
+	void FireEnemies();
+	void FireMaster();
+
+	static bool IsOutside(float y);
+	std::size_t GetInField(const Shots& shots, int owner) const;
+	bool IsFull(const Shots& shots) const;
+	void Spawn(Shots& shots, float x, float y, int owner);
+	static void Kill(Shots& shots, std::size_t i);
+	static void Move(Shots& shots, float dy);
+	static bool Sweep(const Shots& shots, const ReferenceProjectile& projectile, const sf::FloatRect& target, float& time);
+
+	// The passes of Simulation::Step(), in its order.
+	void FindTargetHits(int shots, EntityType target, std::vector<Hit>& hits) const;
+	void FindShieldHits(int shots, std::vector<Hit>& hits) const;
+	void FindInvasion(std::vector<Hit>& hits) const;
+	void ApplyHits(std::vector<Hit>& hits);
+
+	int GetShooter(int column) const;
+	bool GetTargetX(float& x) const;
+	bool IsAnyPlayerAlive() const;
+
+private:
+	GameSettings	m_Settings;
+	const LevelSet*	m_Levels = nullptr;
+
+	std::vector<ReferenceEntity>	m_Entities;
+	std::vector<ReferenceEntity>	m_LevelEntities;	// as loaded, for a wave that starts over
+	std::vector<ReferenceShield>	m_Shields;
+	std::size_t		m_ShieldCount = 0;
+
+	// By EntityType: weapon, enemyWeapon, enemyMasterWeapon
+	Shots			m_Shots[3];
+	WeaponSettings	m_Fire[3];
+
+	std::uint64_t	m_Tick = 0;
+	std::size_t		m_LevelIndex = 0;
+	int				m_Lives[MAX_PLAYERS] = {};
+	int				m_Score[MAX_PLAYERS] = {};
+	int				m_PlayerCooldown[MAX_PLAYERS] = {};
+	int				m_EnemyCooldown = 0;
+	int				m_EnemyMasterCooldown = 0;
+	bool			m_IsInvaded = false;
+	bool			m_IsGameOver = false;
+	Random			m_Random;
+};
@@ -0,0 +1,456 @@
+#include "pch.h"
+#include "RollbackSession.h"
+#include "AssetBundle.h"
+#include "GameState.h"
+
+#define ROLLBACK_NO_TICK 0xFFFFFFFFu
+
+// Datagram kinds
+#define ROLLBACK_INPUTS 'I'		// u32 first tick, u8 count, inputs, u32 ack, u32 check tick, u32 checksum
+#define ROLLBACK_STATE 'S'		// u32 tick, u32 state size, u32 offset, bytes of the sealed state
+
+static void AppendU32(std::vector<unsigned char>& buffer, std::uint32_t value)
+{
+	unsigned char bytes[4];
+	std::memcpy(bytes, &value, 4);
+	buffer.insert(buffer.end(), bytes, bytes + 4);
+}
+
+static std::uint32_t ReadU32(const unsigned char* data)
+{
+	std::uint32_t value;
+	std::memcpy(&value, data, 4);
+	return value;
+}
+
+// The header of a sealed state already holds the checksum of its payload.
+static std::uint32_t GetStateChecksum(const std::vector<unsigned char>& state)
+{
+	GameStateHeader header;
+	std::memcpy(&header, state.data(), sizeof(header));
+	return header.m_checksum;
+}
+
+RollbackSession::RollbackSession(Simulation& simulation, Transport& transport, int localPlayer, int inputDelay)
+	: m_simulation(simulation)
+	, m_transport(transport)
+	, m_local(localPlayer)
+	, m_remote(1 - localPlayer)
+	, m_inputDelay(std::max(0, std::min(inputDelay, ROLLBACK_MAX_PREDICTION)))
+	, m_rollbackFrom(ROLLBACK_NO_TICK)
+	, m_peerCheckTick(ROLLBACK_NO_TICK)
+	, m_checkedTick(ROLLBACK_NO_TICK)
+	, m_fragmentsTick(ROLLBACK_NO_TICK)
+	, m_resyncTick(ROLLBACK_NO_TICK)
+{
+	for (int i = 0; i < ROLLBACK_HISTORY; i++)
+	{
+		m_remoteTags[i] = ROLLBACK_NO_TICK;
+		m_stateTags[i] = ROLLBACK_NO_TICK;
+	}
+}
+
+RollbackSession::~RollbackSession()
+{
+}
+
+bool RollbackSession::Advance(const PlayerInput& input)
+{
+	ReceiveDatagrams();
+
+	// A resync covers every misprediction: the state of player 0 was
+	// simulated from the right inputs.
+	if (m_resyncTick != ROLLBACK_NO_TICK)
+	{
+		Resimulate(m_resyncTick, m_resyncState);
+		m_resyncTick = ROLLBACK_NO_TICK;
+	}
+	else if (m_rollbackFrom != ROLLBACK_NO_TICK && m_stateTags[m_rollbackFrom % ROLLBACK_HISTORY] == m_rollbackFrom)
+	{
+		Resimulate(m_rollbackFrom, m_states[m_rollbackFrom % ROLLBACK_HISTORY]);
+	}
+	m_rollbackFrom = ROLLBACK_NO_TICK;
+
+	CheckPeerChecksum();
+
+	if (m_tick >= m_confirmedRemote + ROLLBACK_MAX_PREDICTION)
+	{
+		// Too far ahead of the peer; keep re-sending until it catches up.
+		m_stalls++;
+		SendInputs();
+		return false;
+	}
+
+	// Local inputs apply InputDelay ticks later; the first ticks get none.
+	while (m_nextLocalTick <= m_tick + m_inputDelay)
+	{
+		m_localInputs[m_nextLocalTick % ROLLBACK_HISTORY] = m_nextLocalTick < static_cast<std::uint32_t>(m_inputDelay) ? PlayerInput() : input;
+		m_nextLocalTick++;
+	}
+
+	SendInputs();
+	SimulateTick(m_tick);
+	m_tick++;
+	return true;
+}
+
+bool RollbackSession::GetChecksum(std::uint32_t tick, std::uint32_t& checksum) const
+{
+	if (m_stateTags[tick % ROLLBACK_HISTORY] != tick)
+	{
+		return false;
+	}
+
+	checksum = GetStateChecksum(m_states[tick % ROLLBACK_HISTORY]);
+	return true;
+}
+
+void RollbackSession::SendInputs()
+{
+	std::uint32_t first = m_localAcked;
+	std::uint32_t count = std::min<std::uint32_t>(m_nextLocalTick - first, ROLLBACK_MAX_INPUTS);
+
+	// Latest state both peers agree on, so the peer can compare checksums.
+	std::uint32_t checkTick = ROLLBACK_NO_TICK;
+	std::uint32_t checksum = 0;
+	std::uint32_t settled = std::min(m_confirmedRemote, m_tick > 0 ? m_tick - 1 : 0);
+	settled -= settled % ROLLBACK_CHECK_INTERVAL;
+	if (settled > 0 && GetChecksum(settled, checksum) == true)
+	{
+		checkTick = settled;
+	}
+
+	m_datagram.clear();
+	m_datagram.push_back(ROLLBACK_INPUTS);
+	AppendU32(m_datagram, first);
+	m_datagram.push_back(static_cast<unsigned char>(count));
+	for (std::uint32_t i = 0; i < count; i++)
+	{
+		m_datagram.push_back(m_localInputs[(first + i) % ROLLBACK_HISTORY].m_buttons);
+	}
+	AppendU32(m_datagram, m_confirmedRemote);
+	AppendU32(m_datagram, checkTick);
+	AppendU32(m_datagram, checksum);
+
+	m_transport.Send(m_datagram.data(), m_datagram.size());
+}
+
+void RollbackSession::ReceiveDatagrams()
+{
+	while (m_transport.Receive(m_datagram) == true)
+	{
+		if (m_datagram.empty() == true)
+		{
+			continue;
+		}
+
+		if (m_datagram[0] == ROLLBACK_INPUTS)
+		{
+			HandleInputs(m_datagram.data() + 1, m_datagram.size() - 1);
+		}
+		else if (m_datagram[0] == ROLLBACK_STATE)
+		{
+			HandleState(m_datagram.data() + 1, m_datagram.size() - 1);
+		}
+	}
+}
+
+void RollbackSession::HandleInputs(const unsigned char* data, std::size_t size)
+{
+	if (size < 5 || size != 5 + std::size_t(data[4]) + 12)
+	{
+		return;
+	}
+
+	std::uint32_t first = ReadU32(data);
+	std::uint32_t count = data[4];
+	const unsigned char* inputs = data + 5;
+	const unsigned char* trailer = inputs + count;
+
+	for (std::uint32_t i = 0; i < count; i++)
+	{
+		std::uint32_t tick = first + i;
+		std::size_t slot = tick % ROLLBACK_HISTORY;
+
+		// Duplicates, or garbage too far ahead to have a slot
+		if (tick < m_confirmedRemote || m_remoteTags[slot] == tick || tick >= m_tick + ROLLBACK_HISTORY / 2)
+		{
+			continue;
+		}
+
+		m_remoteInputs[slot].m_buttons = inputs[i];
+		m_remoteTags[slot] = tick;
+
+		if (tick < m_tick && m_usedRemote[slot] != m_remoteInputs[slot])
+		{
+			m_rollbackFrom = std::min(m_rollbackFrom, tick);
+		}
+	}
+
+	while (m_remoteTags[m_confirmedRemote % ROLLBACK_HISTORY] == m_confirmedRemote)
+	{
+		m_confirmedRemote++;
+	}
+
+	m_localAcked = std::max(m_localAcked, std::min(ReadU32(trailer), m_nextLocalTick));
+	m_peerCheckTick = ReadU32(trailer + 4);
+	m_peerChecksum = ReadU32(trailer + 8);
+}
+
+void RollbackSession::HandleState(const unsigned char* data, std::size_t size)
+{
+	// Only player 0 is authoritative.
+	if (m_local == 0 || size < 12)
+	{
+		return;
+	}
+
+	std::uint32_t tick = ReadU32(data);
+	std::uint32_t stateSize = ReadU32(data + 4);
+	std::uint32_t offset = ReadU32(data + 8);
+	const unsigned char* bytes = data + 12;
+	std::size_t count = size - 12;
+	if (tick >= m_tick || tick + ROLLBACK_HISTORY <= m_tick || stateSize < sizeof(GameStateHeader) || stateSize > ROLLBACK_MAX_STATE ||
+		offset % ROLLBACK_FRAGMENT != 0 || offset >= stateSize || count != std::min<std::size_t>(stateSize - offset, ROLLBACK_FRAGMENT))
+	{
+		return;
+	}
+
+	// A fragment of another resync starts over; the older one is lost.
+	if (tick != m_fragmentsTick || stateSize != m_fragments.size())
+	{
+		m_fragmentsTick = tick;
+		m_fragments.resize(stateSize);
+		m_fragmentsMissing = (stateSize + ROLLBACK_FRAGMENT - 1) / ROLLBACK_FRAGMENT;
+		m_fragmentsReceived.assign(m_fragmentsMissing, false);
+	}
+
+	std::size_t fragment = offset / ROLLBACK_FRAGMENT;
+	if (m_fragmentsReceived[fragment] == true)
+	{
+		return;
+	}
+
+	std::memcpy(m_fragments.data() + offset, bytes, count);
+	m_fragmentsReceived[fragment] = true;
+	m_fragmentsMissing--;
+	if (m_fragmentsMissing > 0)
+	{
+		return;
+	}
+
+	m_resyncState.swap(m_fragments);
+	m_resyncTick = tick;
+	m_fragmentsTick = ROLLBACK_NO_TICK;
+	m_fragments.clear();
+	m_resyncs++;
+}
+
+void RollbackSession::CheckPeerChecksum()
+{
+	std::uint32_t tick = m_peerCheckTick;
+	std::uint32_t checksum;
+	if (tick == ROLLBACK_NO_TICK || tick > m_confirmedRemote || tick >= m_tick || GetChecksum(tick, checksum) == false)
+	{
+		return;
+	}
+
+	// Each tick is compared once; a lost resync is retried at the next one.
+	m_peerCheckTick = ROLLBACK_NO_TICK;
+	if ((m_checkedTick != ROLLBACK_NO_TICK && tick <= m_checkedTick) || checksum == m_peerChecksum)
+	{
+		return;
+	}
+
+	m_checkedTick = tick;
+	m_desyncs++;
+	if (m_local != 0)
+	{
+		return;
+	}
+
+	// Send our state; the peer re-simulates from it.
+	SendState(tick);
+}
+
+void RollbackSession::SendState(std::uint32_t tick)
+{
+	const std::vector<unsigned char>& state = m_states[tick % ROLLBACK_HISTORY];
+	for (std::size_t offset = 0; offset < state.size(); offset += ROLLBACK_FRAGMENT)
+	{
+		std::size_t count = std::min<std::size_t>(state.size() - offset, ROLLBACK_FRAGMENT);
+		m_datagram.clear();
+		m_datagram.push_back(ROLLBACK_STATE);
+		AppendU32(m_datagram, tick);
+		AppendU32(m_datagram, static_cast<std::uint32_t>(state.size()));
+		AppendU32(m_datagram, static_cast<std::uint32_t>(offset));
+		m_datagram.insert(m_datagram.end(), state.begin() + offset, state.begin() + offset + count);
+		m_transport.Send(m_datagram.data(), m_datagram.size());
+	}
+}
+
+void RollbackSession::Resimulate(std::uint32_t fromTick, const std::vector<unsigned char>& state)
+{
+	// The state may be the slot of fromTick, which SimulateTick() saves
+	// again once it has been loaded.
+	sf::Clock clock;
+	if (m_simulation.LoadState(state) == false)
+	{
+		// Nothing to replay from; the peers are apart until the next resync.
+		m_desyncs++;
+		return;
+	}
+
+	for (std::uint32_t tick = fromTick; tick < m_tick; tick++)
+	{
+		SimulateTick(tick);
+	}
+
+	m_rollbacks++;
+	m_resimulatedTicks += m_tick - fromTick;
+	m_rollbackTime += clock.getElapsedTime();
+}
+
+void RollbackSession::SimulateTick(std::uint32_t tick)
+{
+	std::size_t slot = tick % ROLLBACK_HISTORY;
+
+	// The state before each tick is kept to roll back to.
+	m_simulation.SaveState(m_states[slot]);
+	m_stateTags[slot] = tick;
+
+	PlayerInput inputs[MAX_PLAYERS];
+	inputs[m_local] = m_localInputs[slot];
+	inputs[m_remote] = GetRemoteInput(tick);
+	m_usedRemote[slot] = inputs[m_remote];
+
+	m_simulation.Step(inputs);
+}
+
+PlayerInput RollbackSession::GetRemoteInput(std::uint32_t tick) const
+{
+	std::size_t slot = tick % ROLLBACK_HISTORY;
+	if (m_remoteTags[slot] == tick)
+	{
+		return m_remoteInputs[slot];
+	}
+
+	// Prediction: the last confirmed input, without the Fire edge.
+	PlayerInput predicted;
+	if (m_confirmedRemote > 0)
+	{
+		predicted = m_remoteInputs[(m_confirmedRemote - 1) % ROLLBACK_HISTORY];
+		predicted.m_buttons &= ~PlayerInput::Fire;
+	}
+	return predicted;
+}
+
+bool RollbackSession::RunLoopbackTest(const GameSettings& settings, int ticks, int latency, int lossPercent)
+{
+	AssetBundle assets;
+	assets.Open("Media.bundle");
+
+	LevelSet levels;
+	levels.Load(assets, settings.m_levelFile);
+
+	SimulationAssets media;
+	if (media.Load(assets) == false)
+	{
+		std::cerr << "Netplay: missing textures" << std::endl;
+		return false;
+	}
+
+	GameSettings twoPlayers = settings;
+	twoPlayers.m_players = 2;
+
+	Simulation simulations[2];
+	Simulation reference;
+	simulations[0].Init(twoPlayers, levels, media);
+	simulations[1].Init(twoPlayers, levels, media);
+	reference.Init(twoPlayers, levels, media);
+
+	LoopbackLink link(latency, latency / 2, lossPercent, settings.m_seed);
+	RollbackSession first(simulations[0], link.GetEnd(0), 0, settings.m_inputDelay);
+	RollbackSession second(simulations[1], link.GetEnd(1), 1, settings.m_inputDelay);
+	RollbackSession* sessions[2] = { &first, &second };
+
+	// Inputs each session took, by tick
+	std::vector<PlayerInput> taken[2];
+	PlayerInput held[2];
+	Random random(settings.m_seed + 1);
+
+	for (int i = 0; i < 2; i++)
+	{
+		taken[i].assign(first.m_inputDelay, PlayerInput());
+		taken[i].reserve(first.m_inputDelay + ticks);
+	}
+
+	sf::Clock clock;
+	for (int tick = 0; tick < ticks; tick++)
+	{
+		for (int i = 0; i < 2; i++)
+		{
+			// Bots: change direction now and then, fire often
+			if (random.NextInt(20) == 0)
+			{
+				held[i].m_buttons = static_cast<unsigned char>(random.NextInt(16));
+			}
+
+			PlayerInput input = held[i];
+			if (random.NextInt(8) == 0)
+			{
+				input.m_buttons |= PlayerInput::Fire;
+			}
+
+			if (sessions[i]->Advance(input) == true)
+			{
+				taken[i].push_back(input);
+			}
+		}
+
+		link.Advance();
+	}
+	sf::Time elapsed = clock.getElapsedTime();
+
+	// Latest state both peers have confirmed, replayed without network.
+	std::uint32_t settled = std::min(first.GetConfirmedTick(), second.GetConfirmedTick());
+	settled = std::min(settled, std::min(first.GetTick(), second.GetTick()) - 1);
+
+	for (std::uint32_t tick = 0; tick < settled; tick++)
+	{
+		PlayerInput inputs[MAX_PLAYERS];
+		inputs[0] = taken[0][tick];
+		inputs[1] = taken[1][tick];
+		reference.Step(inputs);
+	}
+
+	std::vector<unsigned char> state;
+	reference.SaveState(state);
+	std::uint32_t expected = GetStateChecksum(state);
+
+	std::cout << "Netplay loopback: " << ticks << " ticks, latency " << latency << " ticks, loss " << lossPercent << "%, "
+		<< elapsed.asMilliseconds() << "ms" << std::endl;
+	std::cout << "Datagrams: " << link.GetSent() << " sent, " << link.GetLost() << " lost" << std::endl;
+
+	bool ok = true;
+	for (int i = 0; i < 2; i++)
+	{
+		const RollbackSession& session = *sessions[i];
+		std::uint32_t checksum = 0;
+		bool match = session.GetChecksum(settled, checksum) == true && checksum == expected;
+		ok = ok && match;
+
+		std::size_t resimulated = std::max<std::size_t>(session.GetResimulatedTicks(), 1);
+		std::cout << "Player " << i << ": tick " << session.GetTick()
+			<< ", " << session.GetRollbacks() << " rollbacks"
+			<< ", " << session.GetResimulatedTicks() << " ticks re-simulated"
+			<< " (" << session.GetRollbackTime().asMicroseconds() / resimulated << "us/tick)"
+			<< ", " << session.GetStalls() << " stalls"
+			<< ", " << session.GetDesyncs() << " desyncs"
+			<< ", " << session.GetResyncs() << " resyncs"
+			<< (match ? "" : ", STATE MISMATCH") << std::endl;
+	}
+
+	std::cout << "State at tick " << settled << (ok ? ": identical" : ": DIFFERENT") << std::endl;
+	return ok;
+}
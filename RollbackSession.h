@@ -0,0 +1,119 @@
+#pragma once
+#include "Simulation.h"
+#include "Transport.h"
+
+//
+// GGPO-style rollback for two players over an unreliable transport.
+//
+// Every tick the local input is sent, scheduled InputDelay ticks ahead,
+// together with all the inputs the peer has not acknowledged yet. Missing
+// remote inputs are predicted by repeating the last confirmed one (without
+// Fire, a press is an edge). When a remote input arrives for a tick that
+// was already simulated and differs from the prediction, the state saved
+// before that tick is loaded and the ticks up to the present are simulated
+// again. The session stalls instead of predicting more than
+// ROLLBACK_MAX_PREDICTION ticks.
+//
+// Peers exchange the checksum of a confirmed state every
+// ROLLBACK_CHECK_INTERVAL ticks; on a mismatch player 0 sends that state
+// and the other peer loads it and re-simulates from there. The state goes
+// in fragments of at most ROLLBACK_FRAGMENT bytes, which the peer puts
+// together in a buffer of its own; a resync with a fragment lost is sent
+// again at the next mismatch.
+//
+
+#define ROLLBACK_HISTORY 128		// ticks of inputs and states kept, power of two
+#define ROLLBACK_MAX_PREDICTION 16
+#define ROLLBACK_MAX_INPUTS 64		// inputs re-sent per datagram at most
+#define ROLLBACK_CHECK_INTERVAL 32
+#define ROLLBACK_FRAGMENT 60000			// state bytes per datagram, below sf::UdpSocket::MaxDatagramSize
+#define ROLLBACK_MAX_STATE (64 * 1024 * 1024)	// larger resyncs are dropped
+
+class RollbackSession
+{
+public:
+	RollbackSession(Simulation& simulation, Transport& transport, int localPlayer, int inputDelay);
+	~RollbackSession();
+
+public:
+	// Exchanges datagrams, rolls back if needed, then simulates one tick.
+	// Returns false without simulating while waiting for the peer; the
+	// caller should then pass the same input again.
+	bool Advance(const PlayerInput& input);
+
+	// Checksum of the state before the given tick, if it is still kept.
+	bool GetChecksum(std::uint32_t tick, std::uint32_t& checksum) const;
+
+	std::uint32_t GetTick() const { return m_tick; }
+	std::uint32_t GetConfirmedTick() const { return m_confirmedRemote; }
+
+	// Statistics
+	std::size_t GetRollbacks() const { return m_rollbacks; }
+	std::size_t GetResimulatedTicks() const { return m_resimulatedTicks; }
+	std::size_t GetStalls() const { return m_stalls; }
+	std::size_t GetDesyncs() const { return m_desyncs; }
+	std::size_t GetResyncs() const { return m_resyncs; }
+	sf::Time GetRollbackTime() const { return m_rollbackTime; }
+
+	// Two sessions over a LoopbackLink with random inputs; checks both
+	// peers and a reference simulation fed the same inputs end up in the
+	// same state. Returns false on a mismatch.
+	static bool RunLoopbackTest(const GameSettings& settings, int ticks, int latency, int lossPercent);
+
+private:
+	void SendInputs();
+	void ReceiveDatagrams();
+	void HandleInputs(const unsigned char* data, std::size_t size);
+	void HandleState(const unsigned char* data, std::size_t size);
+	void CheckPeerChecksum();
+	void SendState(std::uint32_t tick);
+
+	// Loads the state before fromTick and simulates again up to the present.
+	void Resimulate(std::uint32_t fromTick, const std::vector<unsigned char>& state);
+	void SimulateTick(std::uint32_t tick);
+	PlayerInput GetRemoteInput(std::uint32_t tick) const;
+
+private:
+	Simulation& m_simulation;
+	Transport& m_transport;
+	int m_local;
+	int m_remote;
+	int m_inputDelay;
+
+	std::uint32_t m_tick = 0;				// next tick to simulate
+	std::uint32_t m_nextLocalTick = 0;		// next tick without a local input
+	std::uint32_t m_confirmedRemote = 0;	// remote inputs before this tick are known
+	std::uint32_t m_localAcked = 0;			// the peer knows our inputs before this tick
+	std::uint32_t m_rollbackFrom;			// earliest mispredicted tick, if any
+
+	// Rings indexed by tick % ROLLBACK_HISTORY; the tags tell which tick a
+	// slot holds.
+	PlayerInput m_localInputs[ROLLBACK_HISTORY];
+	PlayerInput m_remoteInputs[ROLLBACK_HISTORY];
+	std::uint32_t m_remoteTags[ROLLBACK_HISTORY];
+	PlayerInput m_usedRemote[ROLLBACK_HISTORY];
+	std::vector<unsigned char> m_states[ROLLBACK_HISTORY];
+	std::uint32_t m_stateTags[ROLLBACK_HISTORY];
+
+	// Last checksum received, compared once that tick is confirmed here too
+	std::uint32_t m_peerCheckTick;
+	std::uint32_t m_peerChecksum = 0;
+	std::uint32_t m_checkedTick;			// last mismatch found
+
+	// Resync of player 0: the fragments received so far, then the whole
+	// state, applied by the next Advance().
+	std::uint32_t m_fragmentsTick;
+	std::vector<unsigned char> m_fragments;
+	std::vector<bool> m_fragmentsReceived;
+	std::size_t m_fragmentsMissing = 0;
+	std::uint32_t m_resyncTick;
+	std::vector<unsigned char> m_resyncState;
+	std::vector<unsigned char> m_datagram;
+
+	std::size_t m_rollbacks = 0;
+	std::size_t m_resimulatedTicks = 0;
+	std::size_t m_stalls = 0;
+	std::size_t m_desyncs = 0;
+	std::size_t m_resyncs = 0;
+	sf::Time m_rollbackTime;
+};
@@ -0,0 +1,266 @@
+#include "pch.h"
+#include "Shield.h"
+#include "GameState.h"
+
+#define CRATER_SIZE 8
+
+// Explosion pattern, one string per row, '#' = pixel removed.
+static const char* CraterPattern[CRATER_SIZE] =
+{
+	"#..#..#.",
+	"..####..",
+	".######.",
+	"########",
+	"########",
+	".######.",
+	"..####.#",
+	".#..#...",
+};
+
+static const std::uint64_t* GetCraterRows()
+{
+	static std::uint64_t rows[CRATER_SIZE];
+	static bool built = false;
+	if (built == false)
+	{
+		for (int y = 0; y < CRATER_SIZE; y++)
+		{
+			rows[y] = 0;
+			for (int x = 0; x < CRATER_SIZE; x++)
+			{
+				if (CraterPattern[y][x] == '#')
+				{
+					rows[y] |= std::uint64_t(1) << x;
+				}
+			}
+		}
+		built = true;
+	}
+	return rows;
+}
+
+Shield::Shield()
+{
+}
+
+Shield::~Shield()
+{
+}
+
+void Shield::Create(const sf::Image& image, const sf::Vector2f& position)
+{
+	m_width = static_cast<int>(image.getSize().x);
+	m_height = static_cast<int>(image.getSize().y);
+	m_words = (m_width + 63) / 64;
+	m_position = position;
+
+	const sf::Uint8* pixels = image.getPixelsPtr();
+	m_originalPixels.assign(pixels, pixels + m_width * m_height * 4);
+	m_originalRows.assign(m_words * m_height, 0);
+
+	for (int y = 0; y < m_height; y++)
+	{
+		for (int x = 0; x < m_width; x++)
+		{
+			if (m_originalPixels[(y * m_width + x) * 4 + 3] != 0)
+			{
+				m_originalRows[y * m_words + (x >> 6)] |= std::uint64_t(1) << (x & 63);
+			}
+		}
+	}
+
+	m_pixels = m_originalPixels;
+	m_upload.resize(m_originalPixels.size());
+	Reset();
+}
+
+void Shield::Reset()
+{
+	m_rows = m_originalRows;
+	m_pixelsStale = true;
+	m_dirtyLeft = 0;
+	m_dirtyTop = 0;
+	m_dirtyRight = m_width;
+	m_dirtyBottom = m_height;
+}
+
+bool Shield::HitTest(const sf::FloatRect& bounds, bool movingUp, int& hitX, int& hitY) const
+{
+	// Every pixel the bounds cover, even in part
+	int left = std::max(0, static_cast<int>(std::floor(bounds.left - m_position.x)));
+	int right = std::min(m_width, static_cast<int>(std::ceil(bounds.left + bounds.width - m_position.x)));
+	int top = std::max(0, static_cast<int>(std::floor(bounds.top - m_position.y)));
+	int bottom = std::min(m_height, static_cast<int>(std::ceil(bounds.top + bounds.height - m_position.y)));
+
+	if (left >= right || top >= bottom)
+	{
+		return false;
+	}
+
+	int step = movingUp ? -1 : 1;
+	int y = movingUp ? bottom - 1 : top;
+	for (int i = top; i < bottom; i++, y += step)
+	{
+		if (IsRowHit(y, left, right) == true)
+		{
+			hitX = (left + right) / 2;
+			hitY = y;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool Shield::IsRowHit(int y, int left, int right) const
+{
+	// The columns as a mask over each word they span
+	const std::uint64_t* row = &m_rows[y * m_words];
+	for (int word = left >> 6; word <= (right - 1) >> 6; word++)
+	{
+		int first = std::max(left, word * 64) - word * 64;
+		int count = std::min(right, word * 64 + 64) - word * 64 - first;
+		std::uint64_t bits = count == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << count) - 1;
+		if ((row[word] & (bits << first)) != 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void Shield::ClearRowBits(int y, int left, std::uint64_t bits)
+{
+	if (left < 0)
+	{
+		bits = -left >= 64 ? 0 : bits >> -left;
+		left = 0;
+	}
+
+	int word = left >> 6;
+	int shift = left & 63;
+	std::uint64_t* row = &m_rows[y * m_words];
+
+	if (word < m_words)
+	{
+		row[word] &= ~(bits << shift);
+	}
+	if (shift != 0 && word + 1 < m_words)
+	{
+		row[word + 1] &= ~(bits >> (64 - shift));
+	}
+}
+
+void Shield::Damage(int x, int y)
+{
+	const std::uint64_t* crater = GetCraterRows();
+
+	int left = x - CRATER_SIZE / 2;
+	int top = y - CRATER_SIZE / 2;
+	int x0 = std::max(0, left);
+	int x1 = std::min(m_width, left + CRATER_SIZE);
+	int y0 = std::max(0, top);
+	int y1 = std::min(m_height, top + CRATER_SIZE);
+
+	if (x0 >= x1 || y0 >= y1)
+	{
+		return;
+	}
+
+	for (int row = y0; row < y1; row++)
+	{
+		ClearRowBits(row, left, crater[row - top]);
+
+		if (m_pixelsStale == true)
+		{
+			continue;
+		}
+
+		// Mirror the bitset into the alpha channel of the crater area.
+		const std::uint64_t* bits = &m_rows[row * m_words];
+		for (int col = x0; col < x1; col++)
+		{
+			if (((bits[col >> 6] >> (col & 63)) & 1) == 0)
+			{
+				m_pixels[(row * m_width + col) * 4 + 3] = 0;
+			}
+		}
+	}
+
+	if (m_dirtyRight <= m_dirtyLeft)
+	{
+		m_dirtyLeft = x0;
+		m_dirtyTop = y0;
+		m_dirtyRight = x1;
+		m_dirtyBottom = y1;
+	}
+	else
+	{
+		m_dirtyLeft = std::min(m_dirtyLeft, x0);
+		m_dirtyTop = std::min(m_dirtyTop, y0);
+		m_dirtyRight = std::max(m_dirtyRight, x1);
+		m_dirtyBottom = std::max(m_dirtyBottom, y1);
+	}
+}
+
+void Shield::Upload(sf::Texture& texture)
+{
+	if (m_dirtyRight <= m_dirtyLeft)
+	{
+		return;
+	}
+
+	if (m_pixelsStale == true)
+	{
+		RebuildPixels();
+	}
+
+	// sf::Texture::update() wants a tightly packed sub-image.
+	int width = m_dirtyRight - m_dirtyLeft;
+	int height = m_dirtyBottom - m_dirtyTop;
+	for (int y = 0; y < height; y++)
+	{
+		const sf::Uint8* source = &m_pixels[((m_dirtyTop + y) * m_width + m_dirtyLeft) * 4];
+		std::memcpy(&m_upload[y * width * 4], source, width * 4);
+	}
+
+	texture.update(m_upload.data(), width, height, m_dirtyLeft, m_dirtyTop);
+	m_dirtyLeft = m_dirtyRight = 0;
+	m_dirtyTop = m_dirtyBottom = 0;
+}
+
+void Shield::Save(StateWriter& writer) const
+{
+	writer.Write(m_rows.data(), m_rows.size() * sizeof(std::uint64_t));
+}
+
+bool Shield::Load(StateReader& reader)
+{
+	if (reader.Read(m_rows.data(), m_rows.size() * sizeof(std::uint64_t)) == false)
+	{
+		return false;
+	}
+
+	m_pixelsStale = true;
+	m_dirtyLeft = 0;
+	m_dirtyTop = 0;
+	m_dirtyRight = m_width;
+	m_dirtyBottom = m_height;
+	return true;
+}
+
+void Shield::RebuildPixels()
+{
+	for (int y = 0; y < m_height; y++)
+	{
+		const std::uint64_t* bits = &m_rows[y * m_words];
+		for (int x = 0; x < m_width; x++)
+		{
+			std::size_t alpha = (y * m_width + x) * 4 + 3;
+			m_pixels[alpha] = ((bits[x >> 6] >> (x & 63)) & 1) != 0 ? m_originalPixels[alpha] : 0;
+		}
+	}
+
+	m_pixelsStale = false;
+}
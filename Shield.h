@@ -0,0 +1,70 @@
+#pragma once
+
+class StateWriter;
+class StateReader;
+
+//
+// Destructible shield. The opaque pixels of the block image are kept as a
+// bitset, one row of 64-bit words per scanline (bit 0 = leftmost pixel).
+// Hits carve a crater into the bitset and into a CPU copy of the pixels;
+// only the damaged rectangle is re-uploaded to the texture. The texture
+// belongs to the renderer, the shield itself never touches the GPU.
+//
+
+class Shield
+{
+public:
+	Shield();
+	~Shield();
+
+public:
+	void Create(const sf::Image& image, const sf::Vector2f& position);
+	void Reset();
+
+	// Tests a projectile against the remaining pixels. Rows are scanned in
+	// the direction of travel so the reported row is the first one touched.
+	bool HitTest(const sf::FloatRect& bounds, bool movingUp, int& hitX, int& hitY) const;
+
+	// Carves a crater centered on a local pixel position.
+	void Damage(int x, int y);
+
+	// Pushes the damaged area of the pixels to a texture of the image size.
+	void Upload(sf::Texture& texture);
+
+	// Only the bitset is saved. Pixels are rebuilt from it by the next
+	// Upload(), so rollbacks that load many states in a row stay cheap.
+	void Save(StateWriter& writer) const;
+	bool Load(StateReader& reader);
+	std::size_t GetStateSize() const { return m_rows.size() * sizeof(std::uint64_t); }
+
+	sf::Vector2u GetSize() const { return sf::Vector2u(m_width, m_height); }
+	const sf::Vector2f& GetPosition() const { return m_position; }
+	void SetPosition(const sf::Vector2f& position) { m_position = position; }
+
+private:
+	// Whether any of the columns [left, right) of row y is still opaque.
+	bool IsRowHit(int y, int left, int right) const;
+	void ClearRowBits(int y, int left, std::uint64_t bits);
+	void RebuildPixels();
+
+private:
+	int m_width = 0;
+	int m_height = 0;
+	int m_words = 0;
+	sf::Vector2f m_position;
+
+	std::vector<std::uint64_t> m_rows;
+	std::vector<std::uint64_t> m_originalRows;
+	std::vector<sf::Uint8> m_pixels;
+	std::vector<sf::Uint8> m_originalPixels;
+	std::vector<sf::Uint8> m_upload;
+
+	// The pixels no longer match the bitset and are rebuilt on upload.
+	bool m_pixelsStale = false;
+
+	// Dirty rectangle, empty when m_dirtyRight <= m_dirtyLeft.
+	int m_dirtyLeft = 0;
+	int m_dirtyTop = 0;
+	int m_dirtyRight = 0;
+	int m_dirtyBottom = 0;
+};
@@ -0,0 +1,1152 @@
+#include "pch.h"
+#include "Simulation.h"
+#include "AssetBundle.h"
+#include "GameState.h"
+#include "Trace.h"
+
+// The rules used to run once per rendered frame at up to 160 frames per
+// second; 150 ticks keep the speeds of the levels close to what they were.
+const int Simulation::TicksPerSecond = 150;
+const float Simulation::PlayerSpeed = 100.f;
+const float Simulation::FieldWidth = 840.f;
+const float Simulation::FieldHeight = 600.f;
+
+bool SimulationAssets::Load(const AssetBundle& assets)
+{
+	sf::Image image;
+	bool ok = true;
+
+	ok = assets.LoadImage(image, "Textures/SI_Player.png") && ok;
+	m_player = image.getSize();
+	ok = assets.LoadImage(image, "Textures/SI_Enemy.png") && ok;
+	m_enemy = image.getSize();
+	ok = assets.LoadImage(image, "Textures/SI_EnemyMaster.png") && ok;
+	m_enemyMaster = image.getSize();
+	ok = assets.LoadImage(image, "Textures/SI_WeaponGreen.png") && ok;
+	m_weapon = image.getSize();
+	ok = assets.LoadImage(image, "Textures/SI_WeaponYellow.png") && ok;
+	m_enemyWeapon = image.getSize();
+	ok = assets.LoadImage(image, "Textures/SI_WeaponRed.png") && ok;
+	m_enemyMasterWeapon = image.getSize();
+	ok = assets.LoadImage(m_block, "Textures/SI_Block.png") && ok;
+
+	return ok;
+}
+
+//
+// Entity helpers over both archetypes; the basic one has no AI.
+//
+
+static EnemyAI GetAI(const BasicArchetype&, std::size_t)
+{
+	return EnemyAI();
+}
+
+static EnemyAI GetAI(const EnemyArchetype& archetype, std::size_t row)
+{
+	return archetype.Get<EnemyAI>()[row];
+}
+
+static void SetAI(BasicArchetype&, std::size_t, const EnemyAI&)
+{
+}
+
+static void SetAI(EnemyArchetype& archetype, std::size_t row, const EnemyAI& ai)
+{
+	archetype.Get<EnemyAI>()[row] = ai;
+}
+
+// Only the fields the simulation changes, in the layout of the entity
+// table that came before the archetypes: position, flags (1 = enabled,
+// 2 = left to right), times, index and score.
+template <typename ArchetypeType>
+static void SaveEntities(StateWriter& writer, const ArchetypeType& archetype)
+{
+	for (std::size_t i = 0; i < archetype.GetCount(); i++)
+	{
+		EnemyAI ai = GetAI(archetype, i);
+		unsigned char flags = (archetype.template Get<Collider>()[i].m_enabled ? 1 : 0) | (ai.m_bLeftToRight ? 2 : 0);
+		writer.Write(archetype.template Get<Transform>()[i].m_position);
+		writer.Write(flags);
+		writer.Write(static_cast<std::int32_t>(ai.m_times));
+		writer.Write(static_cast<std::int32_t>(archetype.template Get<Renderable>()[i].m_index));
+		writer.Write(static_cast<std::int32_t>(ai.m_score));
+	}
+}
+
+// Bytes of one entity written by SaveEntities()
+static const std::size_t EntityStateSize = sizeof(sf::Vector2f) + 1 + 3 * sizeof(std::int32_t);
+
+template <typename ArchetypeType>
+static void LoadEntities(StateReader& reader, ArchetypeType& archetype)
+{
+	for (std::size_t i = 0; i < archetype.GetCount(); i++)
+	{
+		unsigned char flags = 0;
+		std::int32_t times = 0, index = 0, score = 0;
+		reader.Read(archetype.template Get<Transform>()[i].m_position);
+		reader.Read(flags);
+		reader.Read(times);
+		reader.Read(index);
+		reader.Read(score);
+
+		EnemyAI ai;
+		ai.m_bLeftToRight = (flags & 2) != 0;
+		ai.m_times = times;
+		ai.m_score = score;
+		SetAI(archetype, i, ai);
+		archetype.template Get<Collider>()[i].m_enabled = (flags & 1) != 0;
+		archetype.template Get<Renderable>()[i].m_index = index;
+	}
+}
+
+Simulation::Simulation()
+{
+	for (int i = 0; i < MAX_PLAYERS; i++)
+	{
+		m_Lives[i] = 0;
+		m_Score[i] = 0;
+		m_PlayerCooldown[i] = 0;
+	}
+}
+
+Simulation::~Simulation()
+{
+}
+
+void Simulation::Init(const GameSettings& settings, const LevelSet& levels, const SimulationAssets& assets)
+{
+	m_Settings = settings;
+	m_Settings.m_players = std::max(1, std::min(MAX_PLAYERS, settings.m_players));
+	m_Levels = &levels;
+	m_Random.Seed(m_Settings.m_seed);
+	m_Tick = 0;
+	m_IsGameOver = false;
+
+	for (int i = 0; i < MAX_PLAYERS; i++)
+	{
+		m_Lives[i] = i < m_Settings.m_players ? 3 : 0;
+		m_Score[i] = 0;
+	}
+
+	//
+	// Projectiles, sized for the most demanding level
+	//
+
+	WeaponSettings playerFire, enemyFire, enemyMasterFire;
+	playerFire.m_capacity = levels.GetMaxCapacity(&LevelDefinition::m_player);
+	enemyFire.m_capacity = levels.GetMaxCapacity(&LevelDefinition::m_enemy);
+	enemyMasterFire.m_capacity = levels.GetMaxCapacity(&LevelDefinition::m_enemyMaster);
+	m_Settings.ApplyStressMode(playerFire, enemyFire, enemyMasterFire);
+
+	m_PlayerWeapons.Create(EntityType::weapon, playerFire.m_capacity * m_Settings.m_players, assets.m_weapon, 0.f, FieldHeight);
+	m_EnemyWeapons.Create(EntityType::enemyWeapon, enemyFire.m_capacity, assets.m_enemyWeapon, 0.f, FieldHeight);
+	m_EnemyMasterWeapons.Create(EntityType::enemyMasterWeapon, enemyMasterFire.m_capacity, assets.m_enemyMasterWeapon, 0.f, FieldHeight);
+	m_Spent[0].assign(m_PlayerWeapons.GetCapacity(), 0);
+	m_Spent[1].assign(m_EnemyWeapons.GetCapacity(), 0);
+	m_Spent[2].assign(m_EnemyMasterWeapons.GetCapacity(), 0);
+
+	int enemyCount = levels.GetMaxEnemies();
+	int shieldCount = levels.GetMaxShields();
+	m_EntityManager.Clear();
+
+	// Every detection pass yields at most one event per projectile; the
+	// rest covers shots and level events.
+	m_Events.Reserve(
+		m_PlayerWeapons.GetCapacity() * (3 + m_Settings.m_players) +
+		(m_EnemyWeapons.GetCapacity() + m_EnemyMasterWeapons.GetCapacity()) * (1 + m_Settings.m_players) +
+		16);
+
+	//
+	// Players
+	//
+
+	BasicArchetype& players = m_EntityManager.Get<EntityType::player>();
+	players.Reserve(m_Settings.m_players);
+	for (int i = 0; i < m_Settings.m_players; i++)
+	{
+		std::size_t row = players.Add();
+		players.Get<Collider>()[row].m_size = assets.m_player;
+		players.Get<Renderable>()[row].m_type = EntityType::player;
+		players.Get<Renderable>()[row].m_index = i;
+	}
+
+	//
+	// Enemy Master
+	//
+
+	EnemyArchetype& master = m_EntityManager.Get<EntityType::enemyMaster>();
+	std::size_t row = master.Add();
+	master.Get<Collider>()[row].m_size = assets.m_enemyMaster;
+	master.Get<Renderable>()[row].m_type = EntityType::enemyMaster;
+
+	//
+	// Enemies, positioned by LoadLevel()
+	//
+
+	EnemyArchetype& enemies = m_EntityManager.Get<EntityType::enemy>();
+	enemies.Reserve(enemyCount);
+	for (int i = 0; i < enemyCount; i++)
+	{
+		row = enemies.Add();
+		enemies.Get<Collider>()[row].m_size = assets.m_enemy;
+		enemies.Get<Renderable>()[row].m_type = EntityType::enemy;
+	}
+
+	//
+	// Blocks
+	//
+
+	BasicArchetype& blocks = m_EntityManager.Get<EntityType::block>();
+	blocks.Reserve(shieldCount);
+	m_Shields.resize(shieldCount);
+	for (int i = 0; i < shieldCount; i++)
+	{
+		m_Shields[i].Create(assets.m_block, sf::Vector2f(0.f, 0.f));
+
+		row = blocks.Add();
+		blocks.Get<Collider>()[row].m_size = assets.m_block.getSize();
+		blocks.Get<Renderable>()[row].m_type = EntityType::block;
+	}
+
+	m_Formation.Create(levels);
+	LoadLevel(0);
+}
+
+void Simulation::LoadLevel(std::size_t index)
+{
+	m_LevelIndex = index % m_Levels->GetCount();
+	const LevelDefinition& level = m_Levels->Get(m_LevelIndex);
+
+	m_PlayerFire = level.m_player;
+	m_EnemyFire = level.m_enemy;
+	m_EnemyMasterFire = level.m_enemyMaster;
+	m_Settings.ApplyStressMode(m_PlayerFire, m_EnemyFire, m_EnemyMasterFire);
+
+	m_PlayerWeapons.SetLimit(m_PlayerFire.m_capacity * m_Settings.m_players);
+	m_EnemyWeapons.SetLimit(m_EnemyFire.m_capacity);
+	m_EnemyMasterWeapons.SetLimit(m_EnemyMasterFire.m_capacity);
+
+	m_ShieldCount = level.m_shields.size();
+	for (std::size_t i = 0; i < m_ShieldCount; i++)
+	{
+		m_Shields[i].SetPosition(level.m_shields[i]);
+	}
+
+	// Entities were created for the largest level; re-configure them in
+	// place and disable the slots this level does not use.
+	m_EntityManager.Get<EntityType::player>().ForEach<Transform, Collider, Renderable>([](std::size_t, Transform& transform, Collider& collider, const Renderable& renderable) {
+		collider.m_enabled = true;
+		transform.m_position = sf::Vector2f(100.f + 500.f * renderable.m_index, 500.f);
+	});
+
+	m_EntityManager.Get<EntityType::enemyMaster>().ForEach<Transform, Collider, EnemyAI>([&level](std::size_t, Transform& transform, Collider& collider, EnemyAI& ai) {
+		collider.m_enabled = true;
+		transform.m_position = sf::Vector2f(level.m_masterLeft, 1.f);
+		ai = EnemyAI();
+		ai.m_score = 100;
+	});
+
+	// Column by column, like the original formation
+	int cell = 0;
+	int cells = level.m_columns * level.m_rows;
+	m_Formation.Reset(level);
+	m_EntityManager.Get<EntityType::enemy>().ForEach<Transform, Collider, Renderable, EnemyAI>([&](std::size_t enemy, Transform& transform, Collider& collider, Renderable& renderable, EnemyAI& ai) {
+		while (cell < cells && level.m_grid[(cell % level.m_rows) * level.m_columns + cell / level.m_rows] == LEVEL_EMPTY_CELL)
+		{
+			cell++;
+		}
+
+		ai = EnemyAI();
+		collider.m_enabled = cell < cells;
+		if (collider.m_enabled == true)
+		{
+			int i = cell / level.m_rows;
+			int j = cell % level.m_rows;
+			renderable.m_index = level.m_grid[j * level.m_columns + i];
+			transform.m_position = sf::Vector2f(level.m_origin.x + level.m_spacing.x * i, level.m_origin.y + level.m_spacing.y * j);
+			ai.m_score = m_Levels->GetEnemyType(static_cast<unsigned char>(renderable.m_index)).m_score;
+			m_Formation.Place(enemy, i, j);
+			cell++;
+		}
+	});
+
+	m_EntityManager.Get<EntityType::block>().ForEach<Transform, Collider, Renderable>([this](std::size_t shield, Transform& transform, Collider& collider, Renderable& renderable) {
+		collider.m_enabled = shield < m_ShieldCount;
+		renderable.m_index = static_cast<int>(shield);
+		transform.m_position = m_Shields[shield].GetPosition();
+	});
+
+	// Later resets of this level restore this state in one copy.
+	m_EntityManager.SaveSnapshot();
+	ResetSprites();
+
+	// Announced by the next Step(): the events of Init() would be cleared
+	// before anyone reads them.
+	m_IsLevelStartPending = true;
+}
+
+void Simulation::ResetSprites()
+{
+	m_EntityManager.RestoreSnapshot();
+
+	// Players out of lives stay out.
+	m_EntityManager.Get<EntityType::player>().ForEach<Collider, Renderable>([this](std::size_t, Collider& collider, const Renderable& renderable) {
+		if (m_Lives[renderable.m_index] == 0)
+		{
+			collider.m_enabled = false;
+		}
+	});
+	m_Formation.Rebuild(m_EntityManager.Get<EntityType::enemy>().Get<Collider>());
+
+	m_IsInvaded = false;
+	m_IsGameOver = false;
+	m_PlayerWeapons.Clear();
+	m_EnemyWeapons.Clear();
+	m_EnemyMasterWeapons.Clear();
+	m_EnemyCooldown = 0;
+	m_EnemyMasterCooldown = 0;
+
+	for (int i = 0; i < MAX_PLAYERS; i++)
+	{
+		m_PlayerCooldown[i] = 0;
+	}
+
+	for (std::size_t i = 0; i < m_ShieldCount; i++)
+	{
+		m_Shields[i].Reset();
+	}
+}
+
+void Simulation::Step(const PlayerInput* inputs)
+{
+	TRACE_ZONE("Simulation::Step");
+
+	// A game-over tick has no events: the consumers must not see the last
+	// ones again.
+	m_Events.Clear();
+	if (m_IsGameOver == true)
+		return;
+
+	HandlePlayerInput(inputs);
+	HandleGameOver();
+
+	if (m_IsLevelStartPending == true)
+	{
+		GameEvent event;
+		event.m_type = GameEventType::levelStarted;
+		event.m_target = static_cast<int>(m_LevelIndex);
+		m_Events.Push(event);
+		m_IsLevelStartPending = false;
+	}
+
+	// Detection only reads the state; the order of the passes is the
+	// priority of their events when one projectile hits several things.
+	static_assert(CountCollisionPairs() == 9, "every pair of CollisionMatrix needs its pass");
+	{
+		TRACE_ZONE("Simulation::DetectCollisions");
+		DetectCollisions<EntityType::weapon, EntityType::enemy>(m_Events);
+		DetectCollisions<EntityType::enemyWeapon, EntityType::player>(m_Events);
+		DetectCollisions<EntityType::weapon, EntityType::player>(m_Events);
+		DetectCollisions<EntityType::weapon, EntityType::block>(m_Events);
+		DetectCollisions<EntityType::enemyWeapon, EntityType::block>(m_Events);
+		DetectCollisions<EntityType::enemyMasterWeapon, EntityType::block>(m_Events);
+		DetectCollisions<EntityType::enemyMasterWeapon, EntityType::player>(m_Events);
+		DetectCollisions<EntityType::enemy, EntityType::block>(m_Events);
+		DetectCollisions<EntityType::weapon, EntityType::enemyMaster>(m_Events);
+	}
+	ResolveEvents();
+
+	HanldeWeaponMoves();
+	HanldeEnemyWeaponMoves();
+	HanldeEnemyMasterWeaponMoves();
+	HandleEnemyMoves();
+	HandleEnemyMasterMove();
+	HandleWeaponCooldowns();
+	HandleEnemyWeaponFiring();
+	HandleEnemyMasterWeaponFiring();
+
+	m_Tick++;
+}
+
+void Simulation::HandlePlayerInput(const PlayerInput* inputs)
+{
+	TRACE_ZONE("Simulation::HandlePlayerInput");
+	BasicArchetype& players = m_EntityManager.Get<EntityType::player>();
+	players.ForEach<Transform, Collider, Renderable>([&](std::size_t, Transform& transform, const Collider& collider, const Renderable& renderable) {
+		if (collider.m_enabled == false)
+		{
+			return;
+		}
+
+		int player = renderable.m_index;
+		const PlayerInput& input = inputs[player];
+
+		sf::Vector2f movement(0.f, 0.f);
+		if (input.IsDown(PlayerInput::Up))
+			movement.y -= PlayerSpeed;
+		if (input.IsDown(PlayerInput::Down))
+			movement.y += PlayerSpeed;
+		if (input.IsDown(PlayerInput::Left))
+			movement.x -= PlayerSpeed;
+		if (input.IsDown(PlayerInput::Right))
+			movement.x += PlayerSpeed;
+
+		transform.m_position += movement / static_cast<float>(TicksPerSecond);
+
+		if (input.IsDown(PlayerInput::Fire) == false)
+		{
+			return;
+		}
+
+		// Each player has the capacity of the level to itself.
+		int& cooldown = m_PlayerCooldown[player];
+		if (cooldown > 0 || m_PlayerWeapons.IsFull() == true || m_PlayerWeapons.GetOwnedCount(player) >= m_PlayerFire.m_capacity)
+		{
+			return;
+		}
+
+		sf::Vector2f muzzle(transform.m_position.x + collider.m_size.x / 2, transform.m_position.y - 10);
+		m_PlayerWeapons.Spawn(muzzle.x, muzzle.y, player);
+
+		cooldown = m_PlayerFire.m_cooldown;
+
+		GameEvent event;
+		event.m_type = GameEventType::playerFired;
+		event.m_player = player;
+		event.m_position = muzzle;
+		m_Events.Push(event);
+	});
+}
+
+void Simulation::HandlePlayerHit(std::size_t row)
+{
+	TRACE_ZONE("Simulation::HandlePlayerHit");
+	if (m_Settings.m_invulnerable == true)
+	{
+		return;
+	}
+
+	BasicArchetype& players = m_EntityManager.Get<EntityType::player>();
+	int& lives = m_Lives[players.Get<Renderable>()[row].m_index];
+	if (lives > 0)
+	{
+		lives--;
+	}
+
+	if (lives == 0)
+	{
+		players.Get<Collider>()[row].m_enabled = false;
+	}
+}
+
+void Simulation::HanldeEnemyMasterWeaponMoves()
+{
+	TRACE_ZONE("Simulation::HanldeEnemyMasterWeaponMoves");
+	m_EnemyMasterWeapons.Move(m_EnemyMasterFire.m_speed);
+}
+
+void Simulation::HandleEnemyMasterWeaponFiring()
+{
+	TRACE_ZONE("Simulation::HandleEnemyMasterWeaponFiring");
+	if (m_EnemyMasterCooldown > 0 || m_EnemyMasterWeapons.IsFull() == true)
+		return;
+
+	const EnemyArchetype& master = m_EntityManager.Get<EntityType::enemyMaster>();
+	const Collider& collider = master.Get<Collider>()[0];
+	if (collider.m_enabled == false)
+		return;
+
+	// a little random...
+	int r = m_Random.NextInt(m_EnemyMasterFire.m_chance);
+	if (r != 0)
+		return;
+
+	float x, y;
+	x = master.Get<Transform>()[0].m_position.x;
+	y = master.Get<Transform>()[0].m_position.y;
+	y--;
+
+	m_EnemyMasterWeapons.Spawn(
+		x + collider.m_size.x / 2,
+		y + collider.m_size.y);
+
+	m_EnemyMasterCooldown = m_EnemyMasterFire.m_cooldown;
+}
+
+void Simulation::HandleEnemyMasterMove()
+{
+	TRACE_ZONE("Simulation::HandleEnemyMasterMove");
+	const LevelDefinition& level = m_Levels->Get(m_LevelIndex);
+
+	EnemyArchetype& master = m_EntityManager.Get<EntityType::enemyMaster>();
+	master.ForEach<Transform, Collider, EnemyAI>([&level](std::size_t, Transform& transform, const Collider& collider, EnemyAI& ai) {
+		if (collider.m_enabled == false)
+		{
+			return;
+		}
+
+		float x, y;
+		x = transform.m_position.x;
+		y = transform.m_position.y;
+
+		if (ai.m_bLeftToRight == true)
+			x = x + level.m_masterSpeed;
+		else
+			x = x - level.m_masterSpeed;
+
+		ai.m_times++;
+
+		if (x >= level.m_masterRight || x <= level.m_masterLeft)
+		{
+			if (ai.m_bLeftToRight == true)
+			{
+				ai.m_bLeftToRight = false;
+				ai.m_times = 0;
+			}
+			else
+			{
+				ai.m_bLeftToRight = true;
+				ai.m_times = 0;
+			}
+		}
+
+		transform.m_position = sf::Vector2f(x, y);
+	});
+}
+
+void Simulation::HanldeEnemyWeaponMoves()
+{
+	TRACE_ZONE("Simulation::HanldeEnemyWeaponMoves");
+	m_EnemyWeapons.Move(m_EnemyFire.m_speed);
+}
+
+void Simulation::HandleEnemyWeaponFiring()
+{
+	TRACE_ZONE("Simulation::HandleEnemyWeaponFiring");
+	if (m_EnemyCooldown > 0)
+		return;
+
+	// Only the bottom-most enemy of a column may shoot. The column closest
+	// above the targeted player rolls first, then the others outwards.
+	const EnemyArchetype& enemies = m_EntityManager.Get<EntityType::enemy>();
+	const ComponentTable<Transform>& transforms = enemies.Get<Transform>();
+	const ComponentTable<Collider>& colliders = enemies.Get<Collider>();
+	int columns = m_Formation.GetColumns();
+
+	int aimed = 0;
+	float target;
+	if (GetTargetX(target) == true)
+	{
+		float closest = FieldWidth;
+		for (int column = 0; column < columns; column++)
+		{
+			int shooter = m_Formation.GetShooter(column);
+			if (shooter < 0)
+			{
+				continue;
+			}
+
+			float distance = std::abs(transforms[shooter].m_position.x + colliders[shooter].m_size.x / 2 - target);
+			if (distance < closest)
+			{
+				closest = distance;
+				aimed = column;
+			}
+		}
+	}
+
+	int shots = 0;
+
+	// Offsets 0, +1, -1, +2, -2...
+	for (int k = 0; k < 2 * columns; k++)
+	{
+		if (m_EnemyWeapons.IsFull() == true || shots >= m_EnemyFire.m_shotsPerTick)
+		{
+			break;
+		}
+
+		int column = aimed + ((k & 1) != 0 ? (k + 1) / 2 : -(k / 2));
+		int shooter = column >= 0 && column < columns ? m_Formation.GetShooter(column) : -1;
+		if (shooter < 0)
+		{
+			continue;
+		}
+
+		// a little random...
+		int r = m_Random.NextInt(m_EnemyFire.m_chance);
+		if (r != 0)
+			continue;
+
+		m_EnemyWeapons.Spawn(
+			transforms[shooter].m_position.x + colliders[shooter].m_size.x / 2,
+			transforms[shooter].m_position.y - 10);
+
+		shots++;
+	}
+
+	if (shots > 0)
+	{
+		m_EnemyCooldown = m_EnemyFire.m_cooldown;
+	}
+}
+
+void Simulation::HandleEnemyMoves()
+{
+	TRACE_ZONE("Simulation::HandleEnemyMoves");
+	//
+	// Handle Enemy moves
+	//
+
+	const LevelDefinition& level = m_Levels->Get(m_LevelIndex);
+
+	EnemyArchetype& enemies = m_EntityManager.Get<EntityType::enemy>();
+	enemies.ForEach<Transform, Collider, EnemyAI>([&level](std::size_t, Transform& transform, const Collider& collider, EnemyAI& ai) {
+		if (collider.m_enabled == false)
+		{
+			return;
+		}
+
+		float x, y;
+		x = transform.m_position.x;
+		y = transform.m_position.y;
+
+		if (ai.m_bLeftToRight == true)
+			x += level.m_enemySpeed;
+		else
+			x -= level.m_enemySpeed;
+		ai.m_times++;
+
+		if (ai.m_times >= level.m_enemyMarch)
+		{
+			if (ai.m_bLeftToRight == true)
+			{
+				ai.m_bLeftToRight = false;
+				ai.m_times = 0;
+			}
+			else
+			{
+				ai.m_bLeftToRight = true;
+				ai.m_times = 0;
+				y += level.m_enemyDrop;
+			}
+		}
+
+		transform.m_position = sf::Vector2f(x, y);
+	});
+}
+
+void Simulation::HanldeWeaponMoves()
+{
+	TRACE_ZONE("Simulation::HanldeWeaponMoves");
+	//
+	// Handle Weapon moves
+	//
+
+	m_PlayerWeapons.Move(-m_PlayerFire.m_speed);
+}
+
+//
+// Collisions
+//
+
+const ProjectilePool& Simulation::GetProjectiles(EntityType type) const
+{
+	switch (type)
+	{
+	case EntityType::enemyWeapon:
+		return m_EnemyWeapons;
+	case EntityType::enemyMasterWeapon:
+		return m_EnemyMasterWeapons;
+	default:
+		return m_PlayerWeapons;
+	}
+}
+
+template <EntityType A, EntityType B>
+void Simulation::DetectCollisions(GameEventBuffer& events) const
+{
+	static_assert(GetCollisionTest(A, B) != collisionNone, "these types never collide, see CollisionMatrix");
+	DetectCollisions<A, B>(events, std::integral_constant<CollisionTest, GetCollisionTest(A, B)>());
+}
+
+template <EntityType A, EntityType B>
+void Simulation::DetectCollisions(GameEventBuffer& events, std::integral_constant<CollisionTest, collisionBounds>) const
+{
+	// Projectiles of A against the entities of B, swept over their last
+	// move: the target touched first on the way counts. Targets are taken
+	// where they stand now. Player shots only hit the other player, and
+	// only in versus.
+	const bool playerShots = A == EntityType::weapon;
+	if (B == EntityType::player && playerShots == true && m_Settings.m_versus == false)
+	{
+		return;
+	}
+
+	const ProjectilePool& pool = GetProjectiles(A);
+	const auto& targets = m_EntityManager.Get<B>();
+	const ComponentTable<Transform>& transforms = targets.template Get<Transform>();
+	const ComponentTable<Collider>& colliders = targets.template Get<Collider>();
+	const ComponentTable<Renderable>& renderables = targets.template Get<Renderable>();
+
+	for (std::size_t i = 0; i < pool.GetCount(); i++)
+	{
+		int owner = playerShots == true ? pool.GetOwner(i) : -1;
+		int first = -1;
+		float firstTime = 0.f;
+
+		for (std::size_t e = 0; e < targets.GetCount(); e++)
+		{
+			const Collider& collider = colliders[e];
+			float time;
+			if (collider.m_enabled == false || pool.Sweep(i, collider.GetBounds(transforms[e]), time) == false)
+			{
+				continue;
+			}
+
+			if (B == EntityType::player && owner == renderables[e].m_index)
+			{
+				continue;
+			}
+
+			if (first < 0 || time < firstTime)
+			{
+				first = static_cast<int>(e);
+				firstTime = time;
+			}
+		}
+
+		if (first >= 0)
+		{
+			std::size_t e = static_cast<std::size_t>(first);
+			GameEvent event;
+			event.m_type = B == EntityType::player ? GameEventType::playerHit :
+				B == EntityType::enemy ? GameEventType::enemyKilled : GameEventType::enemyMasterKilled;
+			event.m_projectileType = A;
+			event.m_projectile = static_cast<int>(i);
+			event.m_time = firstTime;
+			event.m_player = owner;
+			event.m_target = static_cast<int>(e);
+			event.m_value = GetAI(targets, e).m_score;
+			event.m_position = transforms[e].m_position;
+			events.Push(event);
+		}
+	}
+}
+
+template <EntityType A, EntityType B>
+void Simulation::DetectCollisions(GameEventBuffer& events, std::integral_constant<CollisionTest, collisionShield>) const
+{
+	// Pixel-exact test against what is left of each shield, over the path
+	// of the last move. The rows are scanned in the direction of travel, so
+	// the first opaque row met is where the projectile lands; across
+	// shields the one met first on the way counts.
+	const ProjectilePool& pool = GetProjectiles(A);
+	const bool movingUp = A == EntityType::weapon;
+
+	for (std::size_t i = 0; i < pool.GetCount(); i++)
+	{
+		sf::FloatRect boundWeapon = pool.GetSweptBounds(i);
+		int first = -1;
+		int firstX = 0;
+		int firstY = 0;
+
+		for (std::size_t s = 0; s < m_ShieldCount; s++)
+		{
+			int x, y;
+			if (m_Shields[s].HitTest(boundWeapon, movingUp, x, y) == false)
+			{
+				continue;
+			}
+
+			float row = m_Shields[s].GetPosition().y + y;
+			float firstRow = first >= 0 ? m_Shields[first].GetPosition().y + firstY : 0.f;
+			if (first < 0 || (movingUp ? row > firstRow : row < firstRow))
+			{
+				first = static_cast<int>(s);
+				firstX = x;
+				firstY = y;
+			}
+		}
+
+		if (first >= 0)
+		{
+			// The time the leading edge reaches the row
+			sf::FloatRect row(boundWeapon.left, m_Shields[first].GetPosition().y + firstY, boundWeapon.width, 1.f);
+			GameEvent event;
+			event.m_type = GameEventType::shieldHit;
+			event.m_projectileType = A;
+			event.m_projectile = static_cast<int>(i);
+			pool.Sweep(i, row, event.m_time);
+			event.m_player = A == EntityType::weapon ? pool.GetOwner(i) : -1;
+			event.m_target = first;
+			event.m_position = sf::Vector2f(static_cast<float>(firstX), static_cast<float>(firstY));
+			events.Push(event);
+		}
+	}
+}
+
+template <EntityType A, EntityType B>
+void Simulation::DetectCollisions(GameEventBuffer& events, std::integral_constant<CollisionTest, collisionInvasion>) const
+{
+	const auto& enemies = m_EntityManager.Get<A>();
+	const auto& blocks = m_EntityManager.Get<B>();
+	const ComponentTable<Transform>& enemyTransforms = enemies.template Get<Transform>();
+	const ComponentTable<Collider>& enemyColliders = enemies.template Get<Collider>();
+	const ComponentTable<Transform>& blockTransforms = blocks.template Get<Transform>();
+	const ComponentTable<Collider>& blockColliders = blocks.template Get<Collider>();
+
+	for (std::size_t e = 0; e < enemies.GetCount(); e++)
+	{
+		if (enemyColliders[e].m_enabled == false)
+		{
+			continue;
+		}
+
+		sf::FloatRect boundEnemy = enemyColliders[e].GetBounds(enemyTransforms[e]);
+		for (std::size_t b = 0; b < blocks.GetCount(); b++)
+		{
+			if (blockColliders[b].m_enabled == true && boundEnemy.intersects(blockColliders[b].GetBounds(blockTransforms[b])) == true)
+			{
+				// One is enough, the whole wave starts over
+				GameEvent event;
+				event.m_type = GameEventType::invaded;
+				event.m_position = enemyTransforms[e].m_position;
+				events.Push(event);
+				return;
+			}
+		}
+	}
+}
+
+void Simulation::SortEventsByTime()
+{
+	// Insertion sort: stable, in place, and the events of one pass are
+	// mostly in order already.
+	for (std::size_t i = 1; i < m_Events.GetCount(); i++)
+	{
+		GameEvent event = m_Events[i];
+		std::size_t j = i;
+		while (j > 0 && m_Events[j - 1].m_time > event.m_time)
+		{
+			m_Events[j] = m_Events[j - 1];
+			j--;
+		}
+		m_Events[j] = event;
+	}
+}
+
+void Simulation::ResolveEvents()
+{
+	TRACE_ZONE("Simulation::ResolveEvents");
+	// Applied in order of time within the tick, then of detection. A
+	// projectile is spent by its first event that takes effect; events of a
+	// spent projectile, or on a target that is already gone, are dropped and
+	// the projectile flies on.
+	SortEventsByTime();
+
+	ProjectilePool* pools[] = { &m_PlayerWeapons, &m_EnemyWeapons, &m_EnemyMasterWeapons };
+	for (int p = 0; p < 3; p++)
+	{
+		std::fill(m_Spent[p].begin(), m_Spent[p].begin() + pools[p]->GetCount(), 0);
+	}
+
+	std::size_t kept = 0;
+
+	for (std::size_t i = 0; i < m_Events.GetCount(); i++)
+	{
+		GameEvent event = m_Events[i];
+
+		// Pools in EntityType order: weapon, enemyWeapon, enemyMasterWeapon
+		unsigned char* spent = nullptr;
+		if (event.m_projectile >= 0)
+		{
+			spent = &m_Spent[event.m_projectileType - EntityType::weapon][event.m_projectile];
+			if (*spent != 0)
+			{
+				continue;
+			}
+		}
+
+		switch (event.m_type)
+		{
+		case GameEventType::enemyKilled:
+		case GameEventType::enemyMasterKilled:
+		{
+			EnemyArchetype& enemies = event.m_type == GameEventType::enemyKilled ?
+				m_EntityManager.Get<EntityType::enemy>() : m_EntityManager.Get<EntityType::enemyMaster>();
+			Collider& enemy = enemies.Get<Collider>()[event.m_target];
+			if (enemy.m_enabled == false)
+			{
+				continue;
+			}
+			enemy.m_enabled = false;
+			m_Score[event.m_player] += event.m_value;
+			if (event.m_type == GameEventType::enemyKilled)
+			{
+				m_Formation.Kill(event.m_target);
+			}
+			break;
+		}
+
+		case GameEventType::playerHit:
+		{
+			BasicArchetype& players = m_EntityManager.Get<EntityType::player>();
+			if (players.Get<Collider>()[event.m_target].m_enabled == false)
+			{
+				continue;
+			}
+			if (event.m_player >= 0)
+			{
+				// Versus, 50 points a hit
+				m_Score[event.m_player] += 50;
+			}
+			HandlePlayerHit(event.m_target);
+			event.m_value = m_Lives[players.Get<Renderable>()[event.m_target].m_index];
+			break;
+		}
+
+		case GameEventType::shieldHit:
+			m_Shields[event.m_target].Damage(static_cast<int>(event.m_position.x), static_cast<int>(event.m_position.y));
+			break;
+
+		case GameEventType::invaded:
+			m_IsInvaded = true;
+			break;
+
+		default:
+			break;
+		}
+
+		if (spent != nullptr)
+		{
+			*spent = 1;
+		}
+		m_Events[kept++] = event;
+	}
+
+	m_Events.Truncate(kept);
+
+	// Backwards, so Kill() only ever moves a projectile that stays alive
+	for (int p = 0; p < 3; p++)
+	{
+		for (std::size_t i = pools[p]->GetCount(); i-- > 0; )
+		{
+			if (m_Spent[p][i] != 0)
+			{
+				pools[p]->Kill(i);
+			}
+		}
+	}
+}
+
+void Simulation::HandleWeaponCooldowns()
+{
+	TRACE_ZONE("Simulation::HandleWeaponCooldowns");
+	for (int i = 0; i < MAX_PLAYERS; i++)
+	{
+		if (m_PlayerCooldown[i] > 0)
+			m_PlayerCooldown[i]--;
+	}
+	if (m_EnemyCooldown > 0)
+		m_EnemyCooldown--;
+	if (m_EnemyMasterCooldown > 0)
+		m_EnemyMasterCooldown--;
+}
+
+bool Simulation::IsAnyPlayerAlive() const
+{
+	for (int i = 0; i < m_Settings.m_players; i++)
+	{
+		if (m_Lives[i] > 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Centre of the player the enemies aim at: each live player in turn, a
+// second at a time.
+bool Simulation::GetTargetX(float& x) const
+{
+	const BasicArchetype& players = m_EntityManager.Get<EntityType::player>();
+	const ComponentTable<Collider>& colliders = players.Get<Collider>();
+	std::size_t count = players.GetCount();
+	std::size_t first = static_cast<std::size_t>(m_Tick / TicksPerSecond);
+
+	for (std::size_t i = 0; i < count; i++)
+	{
+		std::size_t player = (first + i) % count;
+		if (colliders[player].m_enabled == true)
+		{
+			x = players.Get<Transform>()[player].m_position.x + colliders[player].m_size.x / 2;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void Simulation::HandleGameOver()
+{
+	TRACE_ZONE("Simulation::HandleGameOver");
+	// Wave cleared ?
+	int count = 0;
+	auto countEnabled = [&count](std::size_t, const Collider& collider) {
+		count += collider.m_enabled == true ? 1 : 0;
+	};
+	m_EntityManager.Get<EntityType::enemy>().ForEach<Collider>(countEnabled);
+	m_EntityManager.Get<EntityType::enemyMaster>().ForEach<Collider>(countEnabled);
+
+	if (count == 0 && IsAnyPlayerAlive() == true)
+	{
+		LoadLevel(m_LevelIndex + 1);
+		return;
+	}
+
+	if (IsAnyPlayerAlive() == false)
+	{
+		m_IsGameOver = true;
+		return;
+	}
+
+	// Invaders reached the shields: the wave starts over.
+	if (m_IsInvaded == true)
+	{
+		ResetSprites();
+	}
+}
+
+void Simulation::SaveState(std::vector<unsigned char>& state) const
+{
+	state.resize(sizeof(GameStateHeader));
+	StateWriter writer(state);
+
+	unsigned char flags = (m_IsGameOver ? 1 : 0) | (m_IsInvaded ? 2 : 0) | (m_IsLevelStartPending ? 4 : 0);
+	writer.Write(m_Tick);
+	writer.Write(static_cast<std::uint32_t>(m_LevelIndex));
+	writer.Write(flags);
+	for (int i = 0; i < MAX_PLAYERS; i++)
+	{
+		writer.Write(static_cast<std::int32_t>(m_Lives[i]));
+		writer.Write(static_cast<std::int32_t>(m_Score[i]));
+		writer.Write(static_cast<std::int32_t>(m_PlayerCooldown[i]));
+	}
+	writer.Write(static_cast<std::int32_t>(m_EnemyCooldown));
+	writer.Write(static_cast<std::int32_t>(m_EnemyMasterCooldown));
+	writer.Write(m_Random.m_state);
+
+	// Types and sizes come from Init().
+	writer.Write(static_cast<std::uint32_t>(m_EntityManager.GetCount()));
+	SaveEntities(writer, m_EntityManager.Get<EntityType::player>());
+	SaveEntities(writer, m_EntityManager.Get<EntityType::enemyMaster>());
+	SaveEntities(writer, m_EntityManager.Get<EntityType::enemy>());
+	SaveEntities(writer, m_EntityManager.Get<EntityType::block>());
+
+	m_PlayerWeapons.Save(writer);
+	m_EnemyWeapons.Save(writer);
+	m_EnemyMasterWeapons.Save(writer);
+
+	for (std::size_t i = 0; i < m_ShieldCount; i++)
+	{
+		m_Shields[i].Save(writer);
+	}
+
+	GameStateFile::Seal(state);
+}
+
+bool Simulation::CheckState(StateReader reader, std::size_t levelIndex) const
+{
+	reader.Skip(m_EntityManager.GetCount() * EntityStateSize);
+	m_PlayerWeapons.Check(reader);
+	m_EnemyWeapons.Check(reader);
+	m_EnemyMasterWeapons.Check(reader);
+
+	// Shields are all made from the same image.
+	std::size_t shields = m_Levels->Get(levelIndex).m_shields.size();
+	reader.Skip(shields * (m_Shields.empty() ? 0 : m_Shields[0].GetStateSize()));
+	return reader.IsOk() == true && reader.IsAtEnd() == true;
+}
+
+bool Simulation::LoadState(const std::vector<unsigned char>& state)
+{
+	const unsigned char* payload;
+	std::size_t size;
+	if (GameStateFile::Open(state.data(), state.size(), payload, size) == false)
+	{
+		return false;
+	}
+
+	StateReader reader(payload, size);
+
+	std::uint64_t tick;
+	std::uint32_t levelIndex, entityCount;
+	unsigned char flags;
+	std::int32_t lives[MAX_PLAYERS], score[MAX_PLAYERS], playerCooldown[MAX_PLAYERS];
+	std::int32_t enemyCooldown, enemyMasterCooldown;
+	std::uint64_t random;
+
+	reader.Read(tick);
+	reader.Read(levelIndex);
+	reader.Read(flags);
+	for (int i = 0; i < MAX_PLAYERS; i++)
+	{
+		reader.Read(lives[i]);
+		reader.Read(score[i]);
+		reader.Read(playerCooldown[i]);
+	}
+	reader.Read(enemyCooldown);
+	reader.Read(enemyMasterCooldown);
+	reader.Read(random);
+	reader.Read(entityCount);
+
+	// States only apply to the level set they were saved with.
+	if (reader.IsOk() == false || levelIndex >= m_Levels->GetCount() || entityCount != m_EntityManager.GetCount())
+	{
+		return false;
+	}
+
+	// Nothing changes unless the whole payload fits: a rejected state leaves
+	// the game as it was.
+	if (CheckState(reader, levelIndex) == false)
+	{
+		return false;
+	}
+
+	if (levelIndex != m_LevelIndex)
+	{
+		LoadLevel(levelIndex);
+	}
+
+	LoadEntities(reader, m_EntityManager.Get<EntityType::player>());
+	LoadEntities(reader, m_EntityManager.Get<EntityType::enemyMaster>());
+	LoadEntities(reader, m_EntityManager.Get<EntityType::enemy>());
+	LoadEntities(reader, m_EntityManager.Get<EntityType::block>());
+	m_Formation.Rebuild(m_EntityManager.Get<EntityType::enemy>().Get<Collider>());
+
+	m_PlayerWeapons.Load(reader);
+	m_EnemyWeapons.Load(reader);
+	m_EnemyMasterWeapons.Load(reader);
+
+	for (std::size_t i = 0; i < m_ShieldCount; i++)
+	{
+		m_Shields[i].Load(reader);
+	}
+
+	m_Tick = tick;
+	m_IsGameOver = (flags & 1) != 0;
+	m_IsInvaded = (flags & 2) != 0;
+	m_IsLevelStartPending = (flags & 4) != 0;
+	for (int i = 0; i < MAX_PLAYERS; i++)
+	{
+		m_Lives[i] = lives[i];
+		m_Score[i] = score[i];
+		m_PlayerCooldown[i] = playerCooldown[i];
+	}
+	m_EnemyCooldown = enemyCooldown;
+	m_EnemyMasterCooldown = enemyMasterCooldown;
+	m_Random.m_state = random;
+	return true;
+}
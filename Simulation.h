@@ -0,0 +1,176 @@
+#pragma once
+#include "EntityManager.h"
+#include "ProjectilePool.h"
+#include "Shield.h"
+#include "GameSettings.h"
+#include "Level.h"
+#include "Random.h"
+#include "GameEvent.h"
+#include "CollisionRules.h"
+#include "Formation.h"
+
+class AssetBundle;
+class StateReader;
+
+#define MAX_PLAYERS 2
+
+// Buttons of one player for one tick. Directions are held states, Fire is
+// set when the button went down since the previous tick.
+struct PlayerInput
+{
+	enum Button
+	{
+		Left = 1,
+		Right = 2,
+		Up = 4,
+		Down = 8,
+		Fire = 16
+	};
+
+	unsigned char m_buttons = 0;
+
+	bool IsDown(Button button) const { return (m_buttons & button) != 0; }
+	bool operator==(const PlayerInput& other) const { return m_buttons == other.m_buttons; }
+	bool operator!=(const PlayerInput& other) const { return m_buttons != other.m_buttons; }
+};
+
+// What the rules need from the media: sprite sizes and the shield image.
+// Game fills it from its textures; headless runs load it from the bundle.
+struct SimulationAssets
+{
+	sf::Vector2u m_player;
+	sf::Vector2u m_enemy;
+	sf::Vector2u m_enemyMaster;
+	sf::Vector2u m_weapon;
+	sf::Vector2u m_enemyWeapon;
+	sf::Vector2u m_enemyMasterWeapon;
+	sf::Image m_block;
+
+	bool Load(const AssetBundle& assets);
+};
+
+//
+// The game rules and everything they change, without window, textures or
+// clock. The state only moves forward through Step(), one fixed tick per
+// call, from the inputs of every player; two simulations fed the same
+// inputs stay bit-identical, which is what rollback netplay relies on.
+//
+
+class Simulation
+{
+public:
+	Simulation();
+	~Simulation();
+
+public:
+	static const int		TicksPerSecond;
+	static const float		PlayerSpeed;
+
+	// Logical playfield, in the pixels of the original 840 x 600 window.
+	// Every position of the rules is in these units; Game scales them.
+	static const float		FieldWidth;
+	static const float		FieldHeight;
+
+	// Allocates the entity table, pools and shields for the largest level of
+	// the set, then loads the first level. The level set must outlive this.
+	void Init(const GameSettings& settings, const LevelSet& levels, const SimulationAssets& assets);
+
+	// Advances one tick; inputs holds one entry per player.
+	void Step(const PlayerInput* inputs);
+
+	// Binary snapshot of the whole simulation, see GameState.h.
+	void SaveState(std::vector<unsigned char>& state) const;
+	bool LoadState(const std::vector<unsigned char>& state);
+
+	// Restarts the random generator, e.g. to play a new game from a loaded
+	// state; the generator is part of the state, so load first.
+	void Reseed(std::uint64_t seed) { m_Random.Seed(seed); }
+
+	const EntityManager& GetEntities() const { return m_EntityManager; }
+	const ProjectilePool& GetPlayerWeapons() const { return m_PlayerWeapons; }
+	const ProjectilePool& GetEnemyWeapons() const { return m_EnemyWeapons; }
+	const ProjectilePool& GetEnemyMasterWeapons() const { return m_EnemyMasterWeapons; }
+	std::size_t GetShieldCount() const { return m_ShieldCount; }
+	Shield& GetShield(std::size_t index) { return m_Shields[index]; }
+	const LevelSet& GetLevels() const { return *m_Levels; }
+
+	int GetPlayerCount() const { return m_Settings.m_players; }
+	int GetLives(int player) const { return m_Lives[player]; }
+	int GetScore(int player) const { return m_Score[player]; }
+	bool IsGameOver() const { return m_IsGameOver; }
+	std::uint64_t GetTick() const { return m_Tick; }
+	std::size_t GetLevel() const { return m_LevelIndex; }
+
+	// Events of the last Step() that took effect, see GameEvent.h.
+	const GameEventBuffer& GetEvents() const { return m_Events; }
+
+private:
+	// Walks the rest of a payload without applying it: true when it holds
+	// the tables of the given level, and nothing more.
+	bool CheckState(StateReader reader, std::size_t levelIndex) const;
+
+	void LoadLevel(std::size_t index);
+	void ResetSprites();
+
+	void HandlePlayerInput(const PlayerInput* inputs);
+	void HanldeEnemyMasterWeaponMoves();
+	void HandleEnemyMasterWeaponFiring();
+	void HandleEnemyMasterMove();
+	void HanldeEnemyWeaponMoves();
+	void HandleEnemyWeaponFiring();
+	void HandleEnemyMoves();
+	void HanldeWeaponMoves();
+
+	// Collision detection, one instance per pair of CollisionMatrix: const,
+	// the results only go to the event buffer.
+	template <EntityType A, EntityType B> void DetectCollisions(GameEventBuffer& events) const;
+	template <EntityType A, EntityType B> void DetectCollisions(GameEventBuffer& events, std::integral_constant<CollisionTest, collisionBounds>) const;
+	template <EntityType A, EntityType B> void DetectCollisions(GameEventBuffer& events, std::integral_constant<CollisionTest, collisionShield>) const;
+	template <EntityType A, EntityType B> void DetectCollisions(GameEventBuffer& events, std::integral_constant<CollisionTest, collisionInvasion>) const;
+	const ProjectilePool& GetProjectiles(EntityType type) const;
+	void SortEventsByTime();
+	void ResolveEvents();
+
+	void HandlePlayerHit(std::size_t row);
+	void HandleWeaponCooldowns();
+	void HandleGameOver();
+	bool IsAnyPlayerAlive() const;
+	bool GetTargetX(float& x) const;
+
+private:
+	GameSettings	m_Settings;
+	const LevelSet*	m_Levels = nullptr;
+
+	EntityManager	m_EntityManager;
+	std::vector<Shield>	m_Shields;
+	std::size_t		m_ShieldCount = 0;
+	ProjectilePool	m_PlayerWeapons;
+	ProjectilePool	m_EnemyWeapons;
+	ProjectilePool	m_EnemyMasterWeapons;
+	WeaponSettings	m_PlayerFire;
+	WeaponSettings	m_EnemyFire;
+	WeaponSettings	m_EnemyMasterFire;
+
+	// Per tick, not saved
+	GameEventBuffer	m_Events;
+	std::vector<unsigned char>	m_Spent[3];	// projectiles used up this tick, by pool
+
+	// Derived from the enemies, rebuilt rather than saved
+	Formation		m_Formation;
+
+	//
+	// Saved by SaveState()
+	//
+
+	std::uint64_t	m_Tick = 0;
+	std::size_t		m_LevelIndex = 0;
+	int				m_Lives[MAX_PLAYERS];
+	int				m_Score[MAX_PLAYERS];
+	int				m_PlayerCooldown[MAX_PLAYERS];
+	int				m_EnemyCooldown = 0;
+	int				m_EnemyMasterCooldown = 0;
+	bool			m_IsInvaded = false;
+	bool			m_IsLevelStartPending = false;	// levelStarted goes out with the next Step()
+	bool			m_IsGameOver = false;
+	Random			m_Random;
+};
@@ -0,0 +1,257 @@
+#include "pch.h"
+#include "SoakTest.h"
+#include "AssetBundle.h"
+#include "MemoryTracker.h"
+
+#ifdef _WIN32
+#include <windows.h>
+// GetProcessMemoryInfo is K32GetProcessMemoryInfo of kernel32 since Windows 7.
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+// Index of the highest bit set.
+static int GetLog2(std::uint64_t value)
+{
+	int log2 = 0;
+	while ((value >>= 1) != 0)
+	{
+		log2++;
+	}
+	return log2;
+}
+
+bool SoakTest::Run(const GameSettings& settings, double minutes, double threshold, double interval)
+{
+	AssetBundle assets;
+	assets.Open("Media.bundle");
+
+	LevelSet levels;
+	levels.Load(assets, settings.m_levelFile);
+
+	SimulationAssets media;
+	if (media.Load(assets) == false)
+	{
+		std::cerr << "Soak: missing textures" << std::endl;
+		return false;
+	}
+
+	GameSettings game = settings;
+	game.m_players = 1;
+	game.m_netplay = false;
+	game.m_invulnerable = true;
+
+	std::unique_ptr<SoakTest> soak(new SoakTest());
+	std::unique_ptr<BotEnvironment> environment(new BotEnvironment());
+	environment->Init(game, levels, media);
+
+	std::cout << "Soak: " << minutes << " minutes, a sample every " << interval << "s, failing past " << threshold << "% of drift" << std::endl;
+
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point start = Clock::now();
+	Clock::time_point end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::ratio<60>>(minutes));
+	Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(interval));
+	Clock::time_point nextSample = start + period;
+
+	BotObservation observation;
+	environment->Observe(observation);
+
+	Clock::time_point now = start;
+	while (now < end)
+	{
+		PlayerInput action = BotEnvironment::ScriptedPolicy(observation);
+		Clock::time_point begin = Clock::now();
+		environment->Step(action);
+		now = Clock::now();
+
+		std::uint64_t nanoseconds = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - begin).count());
+		soak->m_Histogram[GetBucket(nanoseconds)]++;
+		soak->m_Ticks++;
+		soak->m_Max = std::max(soak->m_Max, nanoseconds);
+
+		const GameEventBuffer& events = environment->GetSimulation().GetEvents();
+		for (std::size_t i = 0; i < events.GetCount(); i++)
+		{
+			soak->m_Waves += events[i].m_type == GameEventType::invaded ? 1 : 0;
+		}
+		environment->Observe(observation);
+
+		if (now >= nextSample)
+		{
+			nextSample += period;
+			soak->Sample(std::chrono::duration<double, std::ratio<60>>(now - start).count(), *environment);
+		}
+	}
+
+	// The first sample holds the warm-up, a line needs two more.
+	if (soak->m_Samples.size() < 3)
+	{
+		std::cout << "Soak: " << soak->m_Samples.size() << " samples, too few to measure a drift" << std::endl;
+		return MemoryTracker::IsOverBudget() == false;
+	}
+
+	struct Check
+	{
+		const char* m_name;
+		double m_drift;
+	};
+	Check checks[] = {
+		{ "tick median", soak->GetDrift(&SoakSample::m_median) },
+		{ "tick p99", soak->GetDrift(&SoakSample::m_p99) },
+		{ "resident set", soak->GetDrift(&SoakSample::m_resident) },
+		{ "tracked memory", soak->GetDrift(&SoakSample::m_tracked) },
+		{ "entity rows", soak->GetDrift(&SoakSample::m_entities) }
+	};
+
+	bool ok = true;
+	std::cout << "Soak: drift over the run";
+	for (const Check& check : checks)
+	{
+		double percent = std::round(check.m_drift * 1000.0) / 10.0 + 0.0;		// + 0.0: no -0
+		bool isDrifting = percent > threshold;
+		std::cout << (&check == checks ? ": " : ", ") << check.m_name << ' ' << (percent >= 0.0 ? "+" : "") << percent << '%'
+			<< (isDrifting ? " (FAIL)" : "");
+		ok = ok && isDrifting == false;
+	}
+	std::cout << std::endl;
+
+	if (MemoryTracker::IsOverBudget() == true)
+	{
+		MemoryTracker::Report(std::cout);
+		ok = false;
+	}
+
+	std::cout << "Soak: " << (ok ? "passed" : "failed") << std::endl;
+	return ok;
+}
+
+std::size_t SoakTest::GetBucket(std::uint64_t nanoseconds)
+{
+	if (nanoseconds < 2 * SOAK_SUBBUCKETS)
+	{
+		return static_cast<std::size_t>(nanoseconds);
+	}
+
+	// The top bits under the highest one pick the bucket within its power of two.
+	int shift = GetLog2(nanoseconds) - GetLog2(SOAK_SUBBUCKETS);
+	std::size_t bucket = 2 * SOAK_SUBBUCKETS + (shift - 1) * SOAK_SUBBUCKETS + static_cast<std::size_t>((nanoseconds >> shift) - SOAK_SUBBUCKETS);
+	return std::min<std::size_t>(bucket, SOAK_BUCKETS - 1);
+}
+
+std::uint64_t SoakTest::GetBucketStart(std::size_t bucket)
+{
+	if (bucket < 2 * SOAK_SUBBUCKETS)
+	{
+		return bucket;
+	}
+
+	std::size_t shift = (bucket - 2 * SOAK_SUBBUCKETS) / SOAK_SUBBUCKETS + 1;
+	std::uint64_t top = SOAK_SUBBUCKETS + (bucket - 2 * SOAK_SUBBUCKETS) % SOAK_SUBBUCKETS;
+	return top << shift;
+}
+
+double SoakTest::GetPercentile(double fraction) const
+{
+	std::uint64_t rank = static_cast<std::uint64_t>(std::ceil(fraction * m_Ticks));
+	std::uint64_t count = 0;
+	for (std::size_t bucket = 0; bucket < SOAK_BUCKETS; bucket++)
+	{
+		count += m_Histogram[bucket];
+		if (count >= rank && count > 0)
+		{
+			// Middle of the bucket
+			return (GetBucketStart(bucket) + GetBucketStart(bucket + 1)) / 2000.0;
+		}
+	}
+	return 0.0;
+}
+
+void SoakTest::Sample(double minutes, const BotEnvironment& environment)
+{
+	const Simulation& simulation = environment.GetSimulation();
+
+	SoakSample sample;
+	sample.m_minutes = minutes;
+	sample.m_median = GetPercentile(0.5);
+	sample.m_p99 = GetPercentile(0.99);
+	sample.m_max = m_Max / 1000.0;
+	sample.m_ticks = m_Ticks;
+	sample.m_resident = GetResidentBytes();
+	sample.m_tracked = MemoryTracker::GetTotal();
+	sample.m_entities = simulation.GetEntities().GetCount();
+	simulation.GetEntities().ForEach([&sample](std::size_t, const Transform&, const Collider& collider, const Renderable&) {
+		sample.m_enabled += collider.m_enabled == true ? 1 : 0;
+	});
+	sample.m_projectiles = simulation.GetPlayerWeapons().GetCount() + simulation.GetEnemyWeapons().GetCount() + simulation.GetEnemyMasterWeapons().GetCount();
+	sample.m_levels = environment.GetLevelsCleared();
+	sample.m_waves = m_Waves + sample.m_levels;
+	m_Samples.push_back(sample);
+
+	std::cout << "minute " << std::round(minutes * 10.0) / 10.0 << ": " << sample.m_ticks << " ticks, median " << sample.m_median << "us, p99 " << sample.m_p99
+		<< "us, max " << sample.m_max << "us; resident " << sample.m_resident / 1024 << " KiB, tracked " << sample.m_tracked / 1024
+		<< " KiB; entities " << sample.m_enabled << " of " << sample.m_entities << ", projectiles " << sample.m_projectiles
+		<< "; " << sample.m_waves << " waves, " << sample.m_levels << " cleared" << std::endl;
+
+	std::fill(std::begin(m_Histogram), std::end(m_Histogram), 0);
+	m_Ticks = 0;
+	m_Max = 0;
+}
+
+template <typename T>
+double SoakTest::GetDrift(T SoakSample::*field) const
+{
+	// Least squares over the samples after the first
+	double n = static_cast<double>(m_Samples.size() - 1);
+	double sumX = 0.0;
+	double sumY = 0.0;
+	double sumXX = 0.0;
+	double sumXY = 0.0;
+	for (std::size_t i = 1; i < m_Samples.size(); i++)
+	{
+		double x = m_Samples[i].m_minutes;
+		double y = static_cast<double>(m_Samples[i].*field);
+		sumX += x;
+		sumY += y;
+		sumXX += x * x;
+		sumXY += x * y;
+	}
+
+	double denominator = n * sumXX - sumX * sumX;
+	if (denominator <= 0.0)
+	{
+		return 0.0;
+	}
+
+	double slope = (n * sumXY - sumX * sumY) / denominator;
+	double intercept = (sumY - slope * sumX) / n;
+	double first = intercept + slope * m_Samples[1].m_minutes;
+	double last = intercept + slope * m_Samples.back().m_minutes;
+	return first > 0.0 ? (last - first) / first : 0.0;
+}
+
+#ifdef _WIN32
+
+std::size_t SoakTest::GetResidentBytes()
+{
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) == FALSE)
+	{
+		return 0;
+	}
+	return counters.WorkingSetSize;
+}
+
+#else
+
+std::size_t SoakTest::GetResidentBytes()
+{
+	// Pages: total program size, then resident
+	std::ifstream statm("/proc/self/statm");
+	std::size_t size = 0;
+	std::size_t resident = 0;
+	statm >> size >> resident;
+	return statm.fail() == true ? 0 : resident * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+}
+
+#endif
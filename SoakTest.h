@@ -0,0 +1,71 @@
+#pragma once
+#include "Bot.h"
+
+//
+// Soak test: the scripted bot plays headless, as fast as it can, for
+// hours, and the run fails when the cost of a tick or the memory drifts
+// upwards. Meant for a nightly job; the exit code is the verdict.
+//
+// The player is invulnerable, so the game goes on: a cleared wave
+// loads the next level, a wave that reaches the shields starts over, and
+// the bot cycles through waves for as long as the run lasts. Every
+// interval a sample is printed and kept: tick time percentiles, the
+// resident set of the process, the bytes of MemoryTracker and the entity
+// and projectile counts.
+//
+// Drift is the growth of the least-squares line through the samples over
+// the run, relative to where the line starts. The first sample is left
+// out, it holds the warm-up. The run fails when the tick time median or
+// 99th percentile, the resident set, the tracked bytes or the entity rows
+// grow by more than the threshold, or when a memory budget is exceeded.
+//
+
+#define SOAK_SUBBUCKETS 16		// per power of two of the tick time histogram
+#define SOAK_BUCKETS (SOAK_SUBBUCKETS * 2 + SOAK_SUBBUCKETS * 40)
+
+struct SoakSample
+{
+	double m_minutes = 0.0;			// since the start
+	double m_median = 0.0;			// tick time, microseconds
+	double m_p99 = 0.0;
+	double m_max = 0.0;
+	std::uint64_t m_ticks = 0;		// in the interval
+	std::size_t m_resident = 0;		// bytes
+	std::size_t m_tracked = 0;		// bytes, MemoryTracker
+	std::size_t m_entities = 0;		// rows of the entity tables
+	std::size_t m_enabled = 0;		// of them in the game
+	std::size_t m_projectiles = 0;	// live
+	std::size_t m_waves = 0;		// played since the start
+	std::size_t m_levels = 0;		// of them cleared
+};
+
+class SoakTest
+{
+public:
+	// SpaceInvaders1978 [options] --soak [minutes] [threshold %] [interval s]
+	static bool Run(const GameSettings& settings, double minutes, double threshold, double interval);
+
+private:
+	// Log-linear: exact below 2 * SOAK_SUBBUCKETS nanoseconds, then
+	// SOAK_SUBBUCKETS buckets per power of two, about 6% wide.
+	static std::size_t GetBucket(std::uint64_t nanoseconds);
+	static std::uint64_t GetBucketStart(std::size_t bucket);
+
+	// Microseconds below which fraction of the ticks of the histogram took.
+	double GetPercentile(double fraction) const;
+
+	void Sample(double minutes, const BotEnvironment& environment);
+
+	// Relative growth of the fitted line of one field over the samples.
+	template <typename T>
+	double GetDrift(T SoakSample::*field) const;
+
+	static std::size_t GetResidentBytes();
+
+private:
+	std::uint64_t m_Histogram[SOAK_BUCKETS] = {};
+	std::uint64_t m_Ticks = 0;
+	std::uint64_t m_Max = 0;		// nanoseconds
+	std::size_t m_Waves = 0;
+	std::vector<SoakSample> m_Samples;
+};
@@ -0,0 +1,99 @@
+#include "pch.h"
+#include "SpriteAtlas.h"
+
+// Between frames, so filtering never bleeds a neighbour in.
+static const unsigned AtlasPadding = 1;
+
+int SpriteAtlas::Add(const std::vector<const sf::Image*>& frames, int ticksPerFrame)
+{
+	Animation animation;
+	animation.m_first = static_cast<int>(m_frames.size());
+	animation.m_count = static_cast<int>(frames.size());
+	animation.m_ticksPerFrame = std::max(ticksPerFrame, 1);
+	animation.m_current = animation.m_first;
+
+	for (const sf::Image* image : frames)
+	{
+		m_images.push_back(image);
+		m_frames.push_back(sf::IntRect(0, 0, image->getSize().x, image->getSize().y));
+	}
+
+	m_animations.push_back(animation);
+	return static_cast<int>(m_animations.size()) - 1;
+}
+
+bool SpriteAtlas::Build()
+{
+	// One row, left to right
+	unsigned width = 0;
+	unsigned height = 0;
+	for (sf::IntRect& frame : m_frames)
+	{
+		frame.left = static_cast<int>(width);
+		width += frame.width + AtlasPadding;
+		height = std::max(height, static_cast<unsigned>(frame.height));
+	}
+
+	sf::Image atlas;
+	atlas.create(std::max(width, 1u), std::max(height, 1u), sf::Color::Transparent);
+	for (std::size_t i = 0; i < m_frames.size(); i++)
+	{
+		atlas.copy(*m_images[i], m_frames[i].left, 0);
+	}
+
+	// The images may go away now
+	m_images.clear();
+	return m_texture.loadFromImage(atlas);
+}
+
+void SpriteAtlas::Advance()
+{
+	m_counter++;
+	for (Animation& animation : m_animations)
+	{
+		animation.m_current = animation.m_first + static_cast<int>((m_counter / animation.m_ticksPerFrame) % animation.m_count);
+	}
+}
+
+void SpriteAtlas::WriteQuad(sf::Vertex* quad, int animation, const sf::Vector2f& position, sf::Color color) const
+{
+	const sf::IntRect& frame = GetFrame(animation);
+	float left = static_cast<float>(frame.left);
+	float top = static_cast<float>(frame.top);
+	float width = static_cast<float>(frame.width);
+	float height = static_cast<float>(frame.height);
+
+	quad[0].position = position;
+	quad[1].position = sf::Vector2f(position.x + width, position.y);
+	quad[2].position = sf::Vector2f(position.x + width, position.y + height);
+	quad[3].position = sf::Vector2f(position.x, position.y + height);
+
+	quad[0].texCoords = sf::Vector2f(left, top);
+	quad[1].texCoords = sf::Vector2f(left + width, top);
+	quad[2].texCoords = sf::Vector2f(left + width, top + height);
+	quad[3].texCoords = sf::Vector2f(left, top + height);
+
+	quad[0].color = color;
+	quad[1].color = color;
+	quad[2].color = color;
+	quad[3].color = color;
+}
+
+void SpriteAtlas::MakeMarchFrame(const sf::Image& image, sf::Image& frame)
+{
+	sf::Vector2u size = image.getSize();
+	frame = image;
+
+	unsigned shift = std::max(1u, size.x / 12);
+	unsigned middle = size.x / 2;
+	for (unsigned y = size.y - size.y / 4; y < size.y; y++)
+	{
+		for (unsigned x = 0; x < size.x; x++)
+		{
+			// Left half reads from further out on the left, right half on the right
+			int source = x < middle ? static_cast<int>(x) - static_cast<int>(shift) : static_cast<int>(x + shift);
+			bool inside = source >= 0 && source < static_cast<int>(size.x) && (x < middle) == (static_cast<unsigned>(source) < middle);
+			frame.setPixel(x, y, inside ? image.getPixel(source, y) : sf::Color::Transparent);
+		}
+	}
+}
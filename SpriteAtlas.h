@@ -0,0 +1,47 @@
+#pragma once
+
+//
+// All entity images packed side by side in one texture, with a shared
+// table of frames. An animation is a run of frames in the table played at
+// a fixed rate from one global counter: Advance() bumps the counter and
+// refreshes the current frame of every animation, so drawing an entity is
+// a table lookup and a quad, and all entities go out in one draw call.
+//
+
+class SpriteAtlas
+{
+public:
+	// Appends an animation of one or more frames of the same size and
+	// returns its index. Call before Build().
+	int Add(const std::vector<const sf::Image*>& frames, int ticksPerFrame);
+
+	bool Build();
+
+	// Once per tick.
+	void Advance();
+
+	const sf::Texture& GetTexture() const { return m_texture; }
+	const sf::IntRect& GetFrame(int animation) const { return m_frames[m_animations[animation].m_current]; }
+
+	// Writes the quad of an animation at a position into four vertices.
+	void WriteQuad(sf::Vertex* quad, int animation, const sf::Vector2f& position, sf::Color color) const;
+
+	// The second frame of the march when the media has none: the bottom
+	// rows, the legs, pulled in toward the middle.
+	static void MakeMarchFrame(const sf::Image& image, sf::Image& frame);
+
+private:
+	struct Animation
+	{
+		int m_first = 0;
+		int m_count = 1;
+		int m_ticksPerFrame = 1;
+		int m_current = 0;
+	};
+
+	std::vector<const sf::Image*> m_images;
+	std::vector<sf::IntRect> m_frames;
+	std::vector<Animation> m_animations;
+	std::uint64_t m_counter = 0;
+	sf::Texture m_texture;
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+//
+// Bounded single-producer / single-consumer queue. Slots are reused in
+// place: the producer fills the slot returned by BeginPush() and publishes
+// it with EndPush(), the consumer mirrors that with BeginPop() / EndPop().
+// Neither side blocks, and nothing is allocated after construction, so a
+// slot type owning buffers keeps their capacity from one use to the next.
+//
+
+template <typename T>
+class SpscQueue
+{
+public:
+	// The capacity is rounded up to a power of two.
+	explicit SpscQueue(std::size_t capacity)
+	{
+		std::size_t size = 1;
+		while (size < capacity)
+		{
+			size <<= 1;
+		}
+
+		m_slots.resize(size);
+		m_mask = size - 1;
+	}
+
+	std::size_t GetCapacity() const { return m_slots.size(); }
+
+	// Setup only, before the queue is shared between threads.
+	T& GetSlot(std::size_t index) { return m_slots[index]; }
+
+	//
+	// Producer
+	//
+
+	// nullptr when full.
+	T* BeginPush()
+	{
+		std::size_t head = m_head.load(std::memory_order_relaxed);
+		if (head - m_tail.load(std::memory_order_acquire) == m_slots.size())
+		{
+			return nullptr;
+		}
+		return &m_slots[head & m_mask];
+	}
+
+	void EndPush()
+	{
+		m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	bool TryPush(const T& value)
+	{
+		T* slot = BeginPush();
+		if (slot == nullptr)
+		{
+			return false;
+		}
+
+		*slot = value;
+		EndPush();
+		return true;
+	}
+
+	//
+	// Consumer
+	//
+
+	// nullptr when empty.
+	T* BeginPop()
+	{
+		std::size_t tail = m_tail.load(std::memory_order_relaxed);
+		if (tail == m_head.load(std::memory_order_acquire))
+		{
+			return nullptr;
+		}
+		return &m_slots[tail & m_mask];
+	}
+
+	void EndPop()
+	{
+		m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	bool TryPop(T& value)
+	{
+		T* slot = BeginPop();
+		if (slot == nullptr)
+		{
+			return false;
+		}
+
+		value = *slot;
+		EndPop();
+		return true;
+	}
+
+private:
+	std::vector<T> m_slots;
+	std::size_t m_mask = 0;
+
+	// Each index on its own cache line, so the two threads do not share one.
+	char m_padding0[64];
+	std::atomic<std::size_t> m_head{ 0 };
+	char m_padding1[64];
+	std::atomic<std::size_t> m_tail{ 0 };
+	char m_padding2[64];
+};
@@ -0,0 +1,368 @@
+#include "pch.h"
+#include "Telemetry.h"
+#include "Simulation.h"
+
+#define TELEMETRY_QUEUE_FRAMES 256
+#define TELEMETRY_MAX_RECORDS 0xFFFF	// per list, the range of its u16 count
+
+template <typename T>
+static void Put(std::vector<unsigned char>& buffer, T value)
+{
+	unsigned char bytes[sizeof(T)];
+	std::memcpy(bytes, &value, sizeof(T));
+	buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+static short ToShort(float value)
+{
+	return static_cast<short>(std::max(-32768.f, std::min(32767.f, value)));
+}
+
+static void PutPool(std::vector<unsigned char>& buffer, const ProjectilePool& pool)
+{
+	Put(buffer, static_cast<std::uint16_t>(std::min<std::size_t>(pool.GetCount(), TELEMETRY_MAX_RECORDS)));
+	for (std::size_t i = 0; i < pool.GetCount() && i < TELEMETRY_MAX_RECORDS; i++)
+	{
+		Put(buffer, ToShort(pool.GetX(i)));
+		Put(buffer, ToShort(pool.GetY(i)));
+	}
+}
+
+// Bounds-checked reads from a frame; once one fails all following fail.
+class FrameReader
+{
+public:
+	FrameReader(const unsigned char* data, std::size_t size) : m_data(data), m_size(size) { }
+
+	template <typename T>
+	T Get()
+	{
+		T value = T();
+		if (m_ok == false || sizeof(T) > m_size - m_offset)
+		{
+			m_ok = false;
+			return value;
+		}
+		std::memcpy(&value, m_data + m_offset, sizeof(T));
+		m_offset += sizeof(T);
+		return value;
+	}
+
+	bool IsOk() const { return m_ok; }
+	bool IsAtEnd() const { return m_offset == m_size; }
+
+private:
+	const unsigned char* m_data;
+	std::size_t m_size;
+	std::size_t m_offset = 0;
+	bool m_ok = true;
+};
+
+//
+// TelemetryFrame
+//
+
+bool TelemetryFrame::Decode(const unsigned char* data, std::size_t size)
+{
+	FrameReader reader(data, size);
+
+	m_tick = reader.Get<std::uint32_t>();
+	m_level = reader.Get<unsigned char>();
+	m_players = std::min<int>(reader.Get<unsigned char>(), 2);
+	m_gameOver = (reader.Get<unsigned char>() & 1) != 0;
+	for (int i = 0; i < m_players; i++)
+	{
+		m_lives[i] = reader.Get<unsigned char>();
+		m_score[i] = reader.Get<std::int32_t>();
+	}
+
+	m_entities.resize(reader.Get<std::uint16_t>());
+	for (TelemetryEntity& entity : m_entities)
+	{
+		entity.m_type = reader.Get<unsigned char>();
+		entity.m_index = reader.Get<unsigned char>();
+		entity.m_x = reader.Get<short>();
+		entity.m_y = reader.Get<short>();
+	}
+
+	for (std::vector<TelemetryPoint>& projectiles : m_projectiles)
+	{
+		projectiles.resize(reader.Get<std::uint16_t>());
+		for (TelemetryPoint& point : projectiles)
+		{
+			point.m_x = reader.Get<short>();
+			point.m_y = reader.Get<short>();
+		}
+	}
+
+	m_events.resize(reader.Get<std::uint16_t>());
+	for (TelemetryEvent& event : m_events)
+	{
+		event.m_kind = reader.Get<unsigned char>();
+		event.m_index = reader.Get<unsigned char>();
+		event.m_x = reader.Get<short>();
+		event.m_y = reader.Get<short>();
+	}
+
+	return reader.IsOk() && reader.IsAtEnd();
+}
+
+//
+// TelemetryPublisher
+//
+
+TelemetryPublisher::TelemetryPublisher()
+	: m_queue(TELEMETRY_QUEUE_FRAMES)
+{
+}
+
+TelemetryPublisher::~TelemetryPublisher()
+{
+	Stop();
+}
+
+// Bytes of the largest frame the simulation can produce, size prefix included.
+static std::size_t GetMaxFrameSize(const Simulation& simulation)
+{
+	std::size_t size = 4 + 4 + 3 + MAX_PLAYERS * 5;
+	size += 2 + std::min<std::size_t>(simulation.GetEntities().GetCount(), TELEMETRY_MAX_RECORDS) * 6;
+	const ProjectilePool* pools[] = { &simulation.GetPlayerWeapons(), &simulation.GetEnemyWeapons(), &simulation.GetEnemyMasterWeapons() };
+	for (const ProjectilePool* pool : pools)
+	{
+		size += 2 + std::min<std::size_t>(pool->GetCapacity(), TELEMETRY_MAX_RECORDS) * 4;
+	}
+	size += 2 + std::min<std::size_t>(simulation.GetEvents().GetCapacity(), TELEMETRY_MAX_RECORDS) * 6;
+	return size;
+}
+
+bool TelemetryPublisher::Start(unsigned short port, const Simulation& simulation)
+{
+	if (m_listener.listen(port, sf::IpAddress::LocalHost) != sf::Socket::Done)
+	{
+		std::cerr << "Telemetry: cannot listen on port " << port << std::endl;
+		return false;
+	}
+
+	// Frames are built in place; reserving the largest one now keeps
+	// Publish() allocation free.
+	std::size_t frameSize = GetMaxFrameSize(simulation);
+	for (std::size_t i = 0; i < m_queue.GetCapacity(); i++)
+	{
+		m_queue.GetSlot(i).reserve(frameSize);
+	}
+
+	m_listener.setBlocking(false);
+	m_running = true;
+	m_thread = std::thread(&TelemetryPublisher::SenderLoop, this);
+	return true;
+}
+
+void TelemetryPublisher::Stop()
+{
+	if (IsRunning() == false)
+	{
+		return;
+	}
+
+	m_running = false;
+	m_thread.join();
+	m_listener.close();
+}
+
+void TelemetryPublisher::Publish(const Simulation& simulation)
+{
+	if (IsRunning() == false)
+	{
+		return;
+	}
+
+	std::vector<unsigned char>* frame = m_queue.BeginPush();
+	if (frame == nullptr)
+	{
+		m_dropped++;
+		return;
+	}
+
+	const EntityManager& entities = simulation.GetEntities();
+	int players = simulation.GetPlayerCount();
+	int level = static_cast<int>(simulation.GetLevel());
+
+	frame->clear();
+	Put(*frame, std::uint32_t(0));
+	Put(*frame, static_cast<std::uint32_t>(simulation.GetTick()));
+	Put(*frame, static_cast<unsigned char>(level));
+	Put(*frame, static_cast<unsigned char>(players));
+	Put(*frame, static_cast<unsigned char>(simulation.IsGameOver() ? 1 : 0));
+	for (int i = 0; i < players; i++)
+	{
+		Put(*frame, static_cast<unsigned char>(simulation.GetLives(i)));
+		Put(*frame, static_cast<std::int32_t>(simulation.GetScore(i)));
+	}
+
+	std::uint16_t count = 0;
+	std::size_t countOffset = frame->size();
+	Put(*frame, count);
+	entities.ForEach([frame, &count](std::size_t, const Transform& transform, const Collider& collider, const Renderable& renderable) {
+		if (collider.m_enabled == true && count < TELEMETRY_MAX_RECORDS)
+		{
+			Put(*frame, static_cast<unsigned char>(renderable.m_type));
+			Put(*frame, static_cast<unsigned char>(renderable.m_index));
+			Put(*frame, ToShort(transform.m_position.x));
+			Put(*frame, ToShort(transform.m_position.y));
+			count++;
+		}
+	});
+	std::memcpy(&(*frame)[countOffset], &count, sizeof(count));
+
+	PutPool(*frame, simulation.GetPlayerWeapons());
+	PutPool(*frame, simulation.GetEnemyWeapons());
+	PutPool(*frame, simulation.GetEnemyMasterWeapons());
+
+	//
+	// Events of the tick
+	//
+
+	count = 0;
+	countOffset = frame->size();
+	Put(*frame, count);
+	for (const GameEvent& event : simulation.GetEvents())
+	{
+		if (count == TELEMETRY_MAX_RECORDS)
+		{
+			break;
+		}
+
+		int index = event.m_target;
+		if (event.m_type == GameEventType::enemyKilled)
+		{
+			index = entities.Get<EntityType::enemy>().Get<Renderable>()[event.m_target].m_index;
+		}
+		else if (event.m_type == GameEventType::playerHit)
+		{
+			index = entities.Get<EntityType::player>().Get<Renderable>()[event.m_target].m_index;
+		}
+
+		Put(*frame, static_cast<unsigned char>(event.m_type));
+		Put(*frame, static_cast<unsigned char>(std::max(index, 0)));
+		Put(*frame, ToShort(event.m_position.x));
+		Put(*frame, ToShort(event.m_position.y));
+		count++;
+	}
+	std::memcpy(&(*frame)[countOffset], &count, sizeof(count));
+
+	std::uint32_t size = static_cast<std::uint32_t>(frame->size() - sizeof(std::uint32_t));
+	std::memcpy(frame->data(), &size, sizeof(size));
+	m_queue.EndPush();
+}
+
+void TelemetryPublisher::SenderLoop()
+{
+	std::vector<std::unique_ptr<sf::TcpSocket>> clients;
+	std::unique_ptr<sf::TcpSocket> pending(new sf::TcpSocket());
+
+	while (m_running == true)
+	{
+		if (m_listener.accept(*pending) == sf::Socket::Done)
+		{
+			clients.push_back(std::move(pending));
+			pending.reset(new sf::TcpSocket());
+		}
+
+		std::vector<unsigned char>* frame = m_queue.BeginPop();
+		if (frame == nullptr)
+		{
+			sf::sleep(sf::milliseconds(1));
+			continue;
+		}
+
+		// Blocking sends: a slow spectator holds this thread up, never the game.
+		std::size_t i = 0;
+		while (i < clients.size())
+		{
+			if (clients[i]->send(frame->data(), frame->size()) != sf::Socket::Done)
+			{
+				clients.erase(clients.begin() + i);
+				continue;
+			}
+			i++;
+		}
+
+		m_queue.EndPop();
+	}
+}
+
+static bool ReceiveAll(sf::TcpSocket& socket, void* data, std::size_t size)
+{
+	char* bytes = static_cast<char*>(data);
+	while (size > 0)
+	{
+		std::size_t received = 0;
+		if (socket.receive(bytes, size, received) != sf::Socket::Done)
+		{
+			return false;
+		}
+		bytes += received;
+		size -= received;
+	}
+	return true;
+}
+
+bool TelemetryPublisher::Watch(const std::string& address, unsigned short port)
+{
+	sf::TcpSocket socket;
+	if (socket.connect(sf::IpAddress(address), port, sf::seconds(5.f)) != sf::Socket::Done)
+	{
+		std::cerr << "Telemetry: cannot connect to " << address << ":" << port << std::endl;
+		return false;
+	}
+
+	static const char* EventNames[] = { "enemy killed", "master killed", "player hit", "shield hit", "invaded", "level started", "player fired" };
+
+	std::vector<unsigned char> buffer;
+	TelemetryFrame frame;
+	std::size_t frames = 0;
+
+	for (;;)
+	{
+		std::uint32_t size = 0;
+		if (ReceiveAll(socket, &size, sizeof(size)) == false)
+		{
+			break;
+		}
+
+		buffer.resize(size);
+		if (ReceiveAll(socket, buffer.data(), size) == false)
+		{
+			break;
+		}
+
+		if (frame.Decode(buffer.data(), buffer.size()) == false)
+		{
+			std::cerr << "Telemetry: malformed frame" << std::endl;
+			return false;
+		}
+
+		frames++;
+		for (const TelemetryEvent& event : frame.m_events)
+		{
+			std::cout << "tick " << frame.m_tick << "  " << (event.m_kind < 7 ? EventNames[event.m_kind] : "?")
+				<< " (" << int(event.m_index) << ") at " << event.m_x << "," << event.m_y << std::endl;
+		}
+
+		// About one summary a second
+		if (frame.m_tick % 150 == 0 || frame.m_gameOver == true)
+		{
+			std::cout << "tick " << frame.m_tick << "  level " << frame.m_level;
+			for (int i = 0; i < frame.m_players; i++)
+			{
+				std::cout << "  P" << i + 1 << " lives " << frame.m_lives[i] << " score " << frame.m_score[i];
+			}
+			std::cout << "  entities " << frame.m_entities.size()
+				<< "  projectiles " << frame.m_projectiles[0].size() << "/" << frame.m_projectiles[1].size() << "/" << frame.m_projectiles[2].size()
+				<< (frame.m_gameOver ? "  GAME OVER" : "") << std::endl;
+		}
+	}
+
+	std::cout << frames << " frames" << std::endl;
+	return true;
+}
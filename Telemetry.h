@@ -0,0 +1,95 @@
+#pragma once
+#include "SpscQueue.h"
+
+class Simulation;
+
+//
+// Per-tick telemetry stream over TCP on localhost.
+//
+// The game thread encodes one frame per tick into a slot of a lock-free
+// queue and never waits: when the queue is full the frame is dropped and
+// counted. A sender thread accepts spectators and writes every frame to
+// each of them. Frames are a u32 size followed by (native byte order):
+//
+//   u32 tick, u8 level, u8 players, u8 flags (1 = game over)
+//   per player: u8 lives, i32 score
+//   u16 count, then per enabled entity: u8 type, u8 index, i16 x, i16 y
+//   3 x (u16 count, then per projectile: i16 x, i16 y)   player, enemy, master
+//   u16 count, then per event: u8 kind (GameEventType), u8 index, i16 x, i16 y
+//
+// Each list stops at 65535 records, the most its count can say.
+//
+// The index of an event is the enemy type of a kill, the player of a hit,
+// the shield of a shield hit and the level of a level start.
+//
+
+struct TelemetryEntity
+{
+	unsigned char m_type;
+	unsigned char m_index;
+	short m_x;
+	short m_y;
+};
+
+struct TelemetryEvent
+{
+	unsigned char m_kind;
+	unsigned char m_index;
+	short m_x;
+	short m_y;
+};
+
+struct TelemetryPoint
+{
+	short m_x;
+	short m_y;
+};
+
+// A decoded frame, for consumers.
+struct TelemetryFrame
+{
+	std::uint32_t m_tick = 0;
+	int m_level = 0;
+	int m_players = 0;
+	bool m_gameOver = false;
+	int m_lives[2];
+	int m_score[2];
+	std::vector<TelemetryEntity> m_entities;
+	std::vector<TelemetryPoint> m_projectiles[3];
+	std::vector<TelemetryEvent> m_events;
+
+	bool Decode(const unsigned char* data, std::size_t size);
+};
+
+class TelemetryPublisher
+{
+public:
+	TelemetryPublisher();
+	~TelemetryPublisher();
+
+public:
+	// Listens on localhost and starts the sender thread. The frames are
+	// sized for the tables of the simulation, which must be initialized.
+	bool Start(unsigned short port, const Simulation& simulation);
+	void Stop();
+	bool IsRunning() const { return m_thread.joinable(); }
+
+	// Game thread, once per tick.
+	void Publish(const Simulation& simulation);
+
+	std::size_t GetDropped() const { return m_dropped; }
+
+	// Sample consumer: connects to a publisher and prints what it decodes.
+	static bool Watch(const std::string& address, unsigned short port);
+
+private:
+	void SenderLoop();
+
+private:
+	SpscQueue<std::vector<unsigned char>> m_queue;
+	std::thread m_thread;
+	std::atomic<bool> m_running{ false };
+	sf::TcpListener m_listener;
+	std::size_t m_dropped = 0;
+
+};
@@ -0,0 +1,190 @@
+#include "pch.h"
+#include "Trace.h"
+
+std::atomic<bool> Tracer::s_running{ false };
+std::atomic<std::size_t> Tracer::s_ringCount{ 0 };
+Tracer::Ring Tracer::s_rings[TRACE_MAX_THREADS];
+thread_local bool Tracer::t_hasRing = false;
+thread_local Tracer::Ring* Tracer::t_ring = nullptr;
+
+// Writer state, owned by Start() and Stop().
+static std::ofstream s_file;
+static std::thread s_writer;
+static bool s_isFirstEvent = true;
+static std::size_t s_written = 0;
+static std::chrono::steady_clock::time_point s_origin;
+
+// Trace-event timestamps are microseconds; the nanoseconds go after the point.
+static void WriteMicroseconds(std::ostream& stream, std::uint64_t nanoseconds)
+{
+	unsigned fraction = static_cast<unsigned>(nanoseconds % 1000);
+	char digits[4] = { static_cast<char>('0' + fraction / 100), static_cast<char>('0' + fraction / 10 % 10), static_cast<char>('0' + fraction % 10), 0 };
+	stream << nanoseconds / 1000 << '.' << digits;
+}
+
+bool Tracer::Start(const std::string& path)
+{
+#if TRACE_ENABLED == 0
+	// No zone would ever reach the file.
+	std::cerr << "Trace: compiled out, use a Debug or Profile build for " << path << std::endl;
+	return false;
+#endif
+
+	if (s_writer.joinable() == true)
+	{
+		return false;
+	}
+
+	s_file.open(path, std::ios::trunc);
+	if (s_file.is_open() == false)
+	{
+		std::cerr << "Trace: cannot create " << path << std::endl;
+		return false;
+	}
+
+	s_file << "{\"traceEvents\":[\n";
+	s_isFirstEvent = true;
+	s_written = 0;
+	for (Ring& ring : s_rings)
+	{
+		ring.m_dropped = 0;
+	}
+
+	s_origin = std::chrono::steady_clock::now();
+	s_running = true;
+	s_writer = std::thread(&Tracer::WriterLoop);
+	return true;
+}
+
+void Tracer::Stop()
+{
+	if (s_writer.joinable() == false)
+	{
+		return;
+	}
+
+	s_running = false;
+	s_writer.join();
+
+	// Thread names, as metadata events
+	std::size_t dropped = 0;
+	std::size_t count = std::min<std::size_t>(s_ringCount, TRACE_MAX_THREADS);
+	for (std::size_t i = 0; i < count; i++)
+	{
+		dropped += s_rings[i].m_dropped;
+		const char* name = s_rings[i].m_name;
+		if (name != nullptr)
+		{
+			s_file << (s_isFirstEvent ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i + 1
+				<< ",\"args\":{\"name\":\"" << name << "\"}}";
+			s_isFirstEvent = false;
+		}
+	}
+
+	s_file << "\n]}\n";
+	s_file.close();
+	std::cout << "Trace: " << s_written << " zones written, " << dropped << " dropped" << std::endl;
+}
+
+void Tracer::SetThreadName(const char* name)
+{
+	Ring* ring = GetRing();
+	if (ring != nullptr)
+	{
+		ring->m_name = name;
+	}
+}
+
+std::uint64_t Tracer::Now()
+{
+	return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_origin).count());
+}
+
+void Tracer::Record(const char* name, std::uint64_t begin, std::uint64_t end)
+{
+	// A zone still open at Stop() would otherwise land in the next trace.
+	Ring* ring = GetRing();
+	if (ring == nullptr || IsRunning() == false)
+	{
+		return;
+	}
+
+	TraceEvent* event = ring->m_events->BeginPush();
+	if (event == nullptr)
+	{
+		ring->m_dropped++;
+		return;
+	}
+
+	event->m_name = name;
+	event->m_begin = begin;
+	event->m_end = end;
+	ring->m_events->EndPush();
+}
+
+Tracer::Ring* Tracer::GetRing()
+{
+	if (t_hasRing == true)
+	{
+		return t_ring;
+	}
+
+	t_hasRing = true;
+	std::size_t index = s_ringCount.fetch_add(1);
+	if (index >= TRACE_MAX_THREADS)
+	{
+		return nullptr;
+	}
+
+	Ring& ring = s_rings[index];
+	ring.m_events.reset(new SpscQueue<TraceEvent>(TRACE_RING_EVENTS));
+	ring.m_isReady.store(true, std::memory_order_release);
+	t_ring = &ring;
+	return t_ring;
+}
+
+void Tracer::WriterLoop()
+{
+	while (s_running == true)
+	{
+		if (Flush() == 0)
+		{
+			sf::sleep(sf::milliseconds(1));
+		}
+	}
+
+	// Zones that closed after the last pass
+	Flush();
+}
+
+std::size_t Tracer::Flush()
+{
+	std::size_t written = 0;
+	std::size_t count = std::min<std::size_t>(s_ringCount, TRACE_MAX_THREADS);
+	for (std::size_t i = 0; i < count; i++)
+	{
+		Ring& ring = s_rings[i];
+		if (ring.m_isReady.load(std::memory_order_acquire) == false)
+		{
+			continue;
+		}
+
+		const TraceEvent* event;
+		while ((event = ring.m_events->BeginPop()) != nullptr)
+		{
+			// Complete events: a begin and a duration, nested by time
+			s_file << (s_isFirstEvent ? "" : ",\n") << "{\"name\":\"" << event->m_name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << i + 1 << ",\"ts\":";
+			WriteMicroseconds(s_file, event->m_begin);
+			s_file << ",\"dur\":";
+			WriteMicroseconds(s_file, event->m_end - event->m_begin);
+			s_file << "}";
+			s_isFirstEvent = false;
+
+			ring.m_events->EndPop();
+			written++;
+		}
+	}
+
+	s_written += written;
+	return written;
+}
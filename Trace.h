@@ -0,0 +1,106 @@
+#pragma once
+#include "SpscQueue.h"
+
+//
+// Trace zones of the game loop, written as Chrome trace-event JSON that
+// chrome://tracing, Perfetto or speedscope show as timelines and flame
+// graphs.
+//
+// TRACE_ZONE(name) times the rest of its scope. Each thread records its
+// zones into a ring of its own, without locks or allocation; a writer
+// thread drains every ring into the file. A zone closing while its ring is
+// full is dropped and counted. Zones are only recorded between Start() and
+// Stop(), and compile to nothing unless TRACE_ENABLED is 1 (the Debug and
+// Profile configurations define it, Profile being Release with tracing),
+// so release builds carry no trace code.
+//
+
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 0
+#endif
+
+#define TRACE_MAX_THREADS 16
+#define TRACE_RING_EVENTS 16384
+
+struct TraceEvent
+{
+	const char* m_name;			// a literal, the string must outlive the trace
+	std::uint64_t m_begin;		// nanoseconds since Start()
+	std::uint64_t m_end;
+};
+
+class Tracer
+{
+public:
+	// Starts the writer thread. Fails when a trace is already running, the
+	// file cannot be created or tracing is compiled out.
+	static bool Start(const std::string& path);
+	static void Stop();
+	static bool IsRunning() { return s_running.load(std::memory_order_relaxed); }
+
+	// Names the calling thread in the trace, once, before its first zone.
+	static void SetThreadName(const char* name);
+
+	static std::uint64_t Now();
+	static void Record(const char* name, std::uint64_t begin, std::uint64_t end);
+
+private:
+	// Allocated by the first zone of its thread, published by m_isReady.
+	struct Ring
+	{
+		std::unique_ptr<SpscQueue<TraceEvent>> m_events;
+		std::atomic<bool> m_isReady{ false };
+		std::atomic<const char*> m_name{ nullptr };
+		std::atomic<std::size_t> m_dropped{ 0 };
+	};
+
+	// nullptr once every ring is taken.
+	static Ring* GetRing();
+	static void WriterLoop();
+
+	// Writes out what the rings hold; returns the number of zones.
+	static std::size_t Flush();
+
+	static std::atomic<bool> s_running;
+	static std::atomic<std::size_t> s_ringCount;
+	static Ring s_rings[TRACE_MAX_THREADS];
+
+	// The ring of the calling thread, once it has asked for one.
+	static thread_local bool t_hasRing;
+	static thread_local Ring* t_ring;
+};
+
+class TraceZone
+{
+public:
+	explicit TraceZone(const char* name)
+		: m_name(Tracer::IsRunning() ? name : nullptr)
+		, m_begin(m_name != nullptr ? Tracer::Now() : 0)
+	{
+	}
+
+	~TraceZone()
+	{
+		if (m_name != nullptr)
+		{
+			Tracer::Record(m_name, m_begin, Tracer::Now());
+		}
+	}
+
+private:
+	TraceZone(const TraceZone&) = delete;
+	TraceZone& operator=(const TraceZone&) = delete;
+
+	const char* m_name;
+	std::uint64_t m_begin;
+};
+
+#if TRACE_ENABLED
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_ZONE(name) TraceZone TRACE_CONCAT(traceZone, __LINE__)(name)
+#define TRACE_THREAD(name) Tracer::SetThreadName(name)
+#else
+#define TRACE_ZONE(name)
+#define TRACE_THREAD(name)
+#endif
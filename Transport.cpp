@@ -0,0 +1,133 @@
+#include "pch.h"
+#include "Transport.h"
+
+//
+// UdpTransport
+//
+
+UdpTransport::UdpTransport()
+	: m_buffer(sf::UdpSocket::MaxDatagramSize)
+{
+	m_socket.setBlocking(false);
+}
+
+UdpTransport::~UdpTransport()
+{
+}
+
+bool UdpTransport::Bind(unsigned short port)
+{
+	if (m_socket.bind(port == 0 ? static_cast<unsigned short>(sf::Socket::AnyPort) : port) != sf::Socket::Done)
+	{
+		std::cerr << "Netplay: cannot bind UDP port " << port << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+void UdpTransport::SetRemote(const sf::IpAddress& address, unsigned short port)
+{
+	m_remoteAddress = address;
+	m_remotePort = port;
+}
+
+void UdpTransport::Send(const void* data, std::size_t size)
+{
+	if (HasRemote() == false)
+	{
+		return;
+	}
+
+	// Non-blocking: a full send buffer drops the datagram, like the network would.
+	m_socket.send(data, size, m_remoteAddress, m_remotePort);
+}
+
+bool UdpTransport::Receive(std::vector<unsigned char>& datagram)
+{
+	for (;;)
+	{
+		std::size_t received = 0;
+		sf::IpAddress sender;
+		unsigned short port = 0;
+		if (m_socket.receive(m_buffer.data(), m_buffer.size(), received, sender, port) != sf::Socket::Done)
+		{
+			return false;
+		}
+
+		if (HasRemote() == false)
+		{
+			SetRemote(sender, port);
+		}
+		else if (sender != m_remoteAddress || port != m_remotePort)
+		{
+			continue;
+		}
+
+		datagram.assign(m_buffer.data(), m_buffer.data() + received);
+		return true;
+	}
+}
+
+//
+// LoopbackTransport
+//
+
+void LoopbackTransport::Send(const void* data, std::size_t size)
+{
+	m_link->Send(1 - m_side, data, size);
+}
+
+bool LoopbackTransport::Receive(std::vector<unsigned char>& datagram)
+{
+	return m_link->Receive(m_side, datagram);
+}
+
+//
+// LoopbackLink
+//
+
+LoopbackLink::LoopbackLink(int latency, int jitter, int lossPercent, std::uint64_t seed)
+	: m_latency(latency)
+	, m_jitter(jitter)
+	, m_lossPercent(lossPercent)
+	, m_random(seed)
+{
+	for (int i = 0; i < 2; i++)
+	{
+		m_ends[i].m_link = this;
+		m_ends[i].m_side = i;
+	}
+}
+
+void LoopbackLink::Send(int to, const void* data, std::size_t size)
+{
+	m_sent++;
+	if (m_lossPercent > 0 && m_random.NextInt(100) < m_lossPercent)
+	{
+		m_lost++;
+		return;
+	}
+
+	Datagram datagram;
+	datagram.m_deliverAt = m_time + m_latency + (m_jitter > 0 ? m_random.NextInt(m_jitter + 1) : 0);
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	datagram.m_data.assign(bytes, bytes + size);
+	m_queues[to].push_back(std::move(datagram));
+}
+
+bool LoopbackLink::Receive(int side, std::vector<unsigned char>& datagram)
+{
+	std::vector<Datagram>& queue = m_queues[side];
+	for (std::size_t i = 0; i < queue.size(); i++)
+	{
+		if (queue[i].m_deliverAt <= m_time)
+		{
+			datagram.swap(queue[i].m_data);
+			queue.erase(queue.begin() + i);
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include "Random.h"
+
+//
+// Unreliable datagram transports for netplay. Datagrams may be lost,
+// duplicated or reordered; the rollback session copes with all three.
+//
+
+class Transport
+{
+public:
+	virtual ~Transport() { }
+
+	// Fire and forget.
+	virtual void Send(const void* data, std::size_t size) = 0;
+
+	// Returns false when no datagram is waiting. Never blocks.
+	virtual bool Receive(std::vector<unsigned char>& datagram) = 0;
+};
+
+// sf::UdpSocket in non-blocking mode. Without a remote address the first
+// peer that sends a datagram becomes the remote.
+class UdpTransport : public Transport
+{
+public:
+	UdpTransport();
+	~UdpTransport();
+
+public:
+	bool Bind(unsigned short port);
+	void SetRemote(const sf::IpAddress& address, unsigned short port);
+	bool HasRemote() const { return m_remotePort != 0; }
+
+	void Send(const void* data, std::size_t size) override;
+	bool Receive(std::vector<unsigned char>& datagram) override;
+
+private:
+	sf::UdpSocket m_socket;
+	sf::IpAddress m_remoteAddress;
+	unsigned short m_remotePort = 0;
+	std::vector<char> m_buffer;
+};
+
+class LoopbackLink;
+
+// One end of a LoopbackLink.
+class LoopbackTransport : public Transport
+{
+public:
+	void Send(const void* data, std::size_t size) override;
+	bool Receive(std::vector<unsigned char>& datagram) override;
+
+private:
+	friend class LoopbackLink;
+	LoopbackLink* m_link = nullptr;
+	int m_side = 0;
+};
+
+//
+// In-process pair of transports with injected latency, jitter and loss.
+// Time is counted in calls to Advance(), so runs are reproducible from
+// the seed; jitter larger than the send interval reorders datagrams.
+//
+
+class LoopbackLink
+{
+public:
+	LoopbackLink(int latency, int jitter, int lossPercent, std::uint64_t seed);
+
+	Transport& GetEnd(int side) { return m_ends[side]; }
+	void Advance() { m_time++; }
+
+	std::size_t GetSent() const { return m_sent; }
+	std::size_t GetLost() const { return m_lost; }
+
+private:
+	friend class LoopbackTransport;
+
+	struct Datagram
+	{
+		std::uint64_t m_deliverAt;
+		std::vector<unsigned char> m_data;
+	};
+
+	void Send(int to, const void* data, std::size_t size);
+	bool Receive(int side, std::vector<unsigned char>& datagram);
+
+private:
+	int m_latency;
+	int m_jitter;
+	int m_lossPercent;
+	Random m_random;
+	std::uint64_t m_time = 0;
+	std::size_t m_sent = 0;
+	std::size_t m_lost = 0;
+	LoopbackTransport m_ends[2];
+	std::vector<Datagram> m_queues[2];
+};
@@ -1,12 +0,0 @@
-#include "pch.h"
-#include "Weapon.h"
-
-
-Weapon::Weapon()
-{
-}
-
-
-Weapon::~Weapon()
-{
-}